@@ -43,8 +43,9 @@ typedef struct dg_cpu_info_s {
 	char     vendor[32]; /*< CPU vendor name */
 	uint32_t num_physical_processors; /*< num physical processors */
 	uint32_t num_logical_processors; /*< num logical processors */
-	uint32_t features0; /*< feature flags set 0 */
-	uint32_t features1; /*< feature flags set 1 */
+	uint32_t features0; /*< raw CPUID leaf 1 EDX */
+	uint32_t features1; /*< raw CPUID leaf 1 ECX */
+	uint64_t features; /*< DGCPU_* flags */
 } dg_cpu_info_t;
 
 /**
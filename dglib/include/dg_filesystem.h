@@ -416,6 +416,29 @@ DG_API int fs_touch(dg_pathid_t pathid, const dg_wchar_t* ppath);
 */
 DG_API int fs_remove(dg_pathid_t pathid, const dg_wchar_t* ppath);
 
+typedef dg_voidptr_t dg_hfmap_t; /*< read-only file mapping handle type */
+
+/**
+* @brief map whole file into memory for reading
+* @param pdst - address of dg_hfmap_t var for store mapping handle
+* @param ppdata - address of pointer var for store start address of mapped file data
+* @param psize - address of var for store size of mapped data in bytes
+* @param pathid - valid path id handle or DG_INVALID_HANDLE, if needed path relative executable path
+* @param ppath - path relative of pathid
+* @return 0 - success
+* @return DGERR_NOT_FOUND - file not found
+* @return DGERR_INVALID_PARAM - file is empty
+* @note pages are loaded on first access, the view stays valid until fs_unmap_file
+*/
+DG_API int fs_map_file(dg_hfmap_t* pdst, const void** ppdata, size_t* psize, dg_pathid_t pathid, const dg_wchar_t* ppath);
+
+/**
+* @brief unmap file mapped by fs_map_file
+* @param hfmap - valid mapping handle
+* @return 0 - success
+*/
+DG_API int fs_unmap_file(dg_hfmap_t hfmap);
+
 typedef dg_handle_t dg_hstor_t; /*< storage handle type */
 
 /**
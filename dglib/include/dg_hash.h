@@ -0,0 +1,67 @@
+#pragma once
+#include "dg_libcommon.h"
+
+/**
+* Byte hash with runtime selected implementation.
+*
+* hash_bytes() uses the fastest variant the CPU supports (chosen on first use
+* from cpu_get_info() feature flags). Keys up to 32 bytes hash identically in
+* all variants; longer keys do not, so values from the CRC32/AES variants must
+* not be persisted or exchanged between machines. Use dg_hash_bytes() from
+* dg_map.h (the same as DGHASH_IMPL_PORTABLE) for anything stored.
+*/
+
+/**
+* @brief hash implementations
+*/
+enum DGHASH_IMPL {
+	DGHASH_IMPL_PORTABLE = 0, /*< 64x64->128 multiply, 32-byte stride (dg_hash_bytes) */
+	DGHASH_IMPL_CRC32, /*< 4 SSE4.2 CRC32 streams, 32-byte stride */
+	DGHASH_IMPL_AES, /*< 2 AES-NI round lanes, 32-byte stride */
+	DGHASH_IMPL_AUTO, /*< best supported */
+	DGHASH_IMPL_COUNT
+};
+
+/**
+* @brief hash byte string with the selected implementation
+* @param pdata - key bytes
+* @param len - key length in bytes
+* @param seed - seed value
+* @return 64-bit hash
+*/
+DG_API uint64_t hash_bytes_seed(const void* pdata, size_t len, uint64_t seed);
+
+/**
+* @brief hash byte string with the selected implementation and zero seed
+*/
+DG_API uint64_t hash_bytes(const void* pdata, size_t len);
+
+/**
+* @brief select hash implementation for the whole process
+* @note Not synchronized with concurrent hash_bytes calls: select before tables are filled.
+* @param impl - DGHASH_IMPL value
+* @return DGERR_SUCCESS if implementation selected
+* @return DGERR_UNIMPLEMENTED if CPU or build does not support it
+* @return DGERR_INVALID_PARAM if impl is out of range
+*/
+DG_API int hash_select_impl(int impl);
+
+/**
+* @brief check if hash implementation is available on this CPU
+* @param impl - DGHASH_IMPL value
+* @return true if hash_select_impl(impl) would succeed
+*/
+DG_API bool hash_impl_supported(int impl);
+
+/**
+* @brief get selected hash implementation
+* @return DGHASH_IMPL value (never DGHASH_IMPL_AUTO)
+*/
+DG_API int hash_get_impl();
+
+/**
+* @brief get implementation name
+* @param impl - DGHASH_IMPL value
+* @return static string
+*/
+DG_API const char* hash_impl_name(int impl);
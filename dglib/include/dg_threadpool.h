@@ -110,6 +110,31 @@ DG_API int tp_task_add(dg_threadpool_t* ptp,
 	void *puserdata,
 	double timeout);
 
+/**
+* @brief Range proc pointer for tp_parallel_for
+*/
+typedef void (*dg_tp_range_proc)(void* puserdata, size_t begin, size_t end);
+
+/**
+* @brief Splits [0, count) into nparts contiguous ranges, runs them on the pool and waits for all of them
+* @note  The calling thread runs the first range itself and any range the full queue did not accept.
+*        Must not be called from a task of the same pool: the wait could starve the workers.
+*
+* @param ptp - address of thread pool structure
+* @param count - number of items
+* @param nparts - number of ranges (clamped to [1, count])
+* @param proc - range procedure
+* @param puserdata - address of user data passed to proc
+* @return DGERR_SUCCESS if all ranges are completed
+* @return DGERR_INVALID_PARAM if ptp or proc is NULL
+* @return DGERR_OUT_OF_MEMORY if no enough RAM space
+*/
+DG_API int tp_parallel_for(dg_threadpool_t* ptp,
+	size_t count,
+	size_t nparts,
+	dg_tp_range_proc proc,
+	void* puserdata);
+
 /**
 * @brief Waits for all worker threads to complete
 * 
@@ -47,6 +47,55 @@ int cpu_get_info(dg_cpu_info_t* pdst)
     pdst->num_logical_processors = 1;
   }
 
+  // DGCPU_* flags from leaves 1, 7 and 0x80000001
+  pdst->features = 0;
+  if (pdst->features0 & (1u << 23)) pdst->features |= DGCPU_MMX;
+  if (pdst->features0 & (1u << 25)) pdst->features |= DGCPU_SSE;
+  if (pdst->features0 & (1u << 26)) pdst->features |= DGCPU_SSE2;
+  if (pdst->features1 & (1u << 0))  pdst->features |= DGCPU_SSE3;
+  if (pdst->features1 & (1u << 9))  pdst->features |= DGCPU_SSSE3;
+  if (pdst->features1 & (1u << 19)) pdst->features |= DGCPU_SSE4_1;
+  if (pdst->features1 & (1u << 20)) pdst->features |= DGCPU_SSE4_2;
+  if (pdst->features1 & (1u << 23)) pdst->features |= DGCPU_POPCNT;
+  if (pdst->features1 & (1u << 25)) pdst->features |= DGCPU_AES;
+  if (pdst->features1 & (1u << 30)) pdst->features |= DGCPU_RDRAND;
+
+  // AVX family needs OS support for the YMM state (OSXSAVE + XCR0 bits 1,2)
+  int os_avx = (pdst->features1 & (1u << 27)) && ((_xgetbv(0) & 6) == 6);
+  if (os_avx && (pdst->features1 & (1u << 28))) pdst->features |= DGCPU_AVX;
+  if (os_avx && (pdst->features1 & (1u << 12))) pdst->features |= DGCPU_FMA3;
+
+  if (maxStdLeaf >= 7) {
+    __cpuidex(regs, 7, 0);
+    uint32_t ebx = (uint32_t)regs[1], ecx = (uint32_t)regs[2];
+    int os_avx512 = os_avx && ((_xgetbv(0) & 0xE0) == 0xE0);
+    if (ebx & (1u << 3))  pdst->features |= DGCPU_BMI1;
+    if (os_avx && (ebx & (1u << 5))) pdst->features |= DGCPU_AVX2;
+    if (ebx & (1u << 8))  pdst->features |= DGCPU_BMI2;
+    if (ebx & (1u << 11)) pdst->features |= DGCPU_TSX;
+    if (ebx & (1u << 18)) pdst->features |= DGCPU_RDSEED;
+    if (ebx & (1u << 29)) pdst->features |= DGCPU_SHA;
+    if (ecx & (1u << 0))  pdst->features |= DGCPU_PREFETCHWT1;
+    if (os_avx512) {
+      if (ebx & (1u << 16)) pdst->features |= DGCPU_AVX512_F;
+      if (ebx & (1u << 17)) pdst->features |= DGCPU_AVX512_DQ;
+      if (ebx & (1u << 21)) pdst->features |= DGCPU_AVX512_IFMA;
+      if (ebx & (1u << 26)) pdst->features |= DGCPU_AVX512_PF;
+      if (ebx & (1u << 27)) pdst->features |= DGCPU_AVX512_ER;
+      if (ebx & (1u << 28)) pdst->features |= DGCPU_AVX512_CD;
+      if (ebx & (1u << 30)) pdst->features |= DGCPU_AVX512_BW;
+      if (ebx & (1u << 31)) pdst->features |= DGCPU_AVX512_VL;
+      if (ecx & (1u << 1))  pdst->features |= DGCPU_AVX512_VBMI;
+      if (ecx & (1u << 11)) pdst->features |= DGCPU_AVX512_VNNI;
+      if (ecx & (1u << 12)) pdst->features |= DGCPU_AVX512_BITALG;
+      if (ecx & (1u << 14)) pdst->features |= DGCPU_AVX512_VPOPCNTDQ;
+    }
+  }
+  if (maxExtLeaf >= 0x80000001) {
+    __cpuid(regs, 0x80000001);
+    if ((uint32_t)regs[2] & (1u << 5)) pdst->features |= DGCPU_LZCNT;
+  }
+
   // Number of physical cores: leaf 4, subleaf 0: EAX[31:26] + 1
   if (maxStdLeaf >= 4) {
     // __cpuidex available for subleaf
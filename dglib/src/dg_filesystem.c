@@ -283,6 +283,11 @@ int win32_write_u64(struct dg_io_handle_data_s* phd, uint64_t src, int endian)
 
 #else
 //TODO: K.D. add here includes for linux
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <errno.h>
 #endif
 
 static dg_io_dt_t glob_file_iodt = {
@@ -1153,6 +1158,136 @@ int fs_remove(dg_pathid_t pathid, const dg_wchar_t* ppath)
 #endif
 }
 
+typedef struct fmapdata_s {
+	const void* pview;
+	size_t      size;
+} fmapdata_t;
+
+int fs_map_file(dg_hfmap_t* pdst, const void** ppdata, size_t* psize, dg_pathid_t pathid, const dg_wchar_t* ppath)
+{
+	if (!pdst || !ppdata || !psize)
+		return DGERR_INVALID_PARAM;
+
+#ifdef _WIN32
+	DWORD         dwerror;
+	LARGE_INTEGER filesize;
+	dg_wchar_t    fullpath[DGFS_MAX_LONG_PATH];
+	dg_wchar_t*   p = fs_build_path(fullpath, DG_ARRSIZE(fullpath), pathid, ppath);
+
+	HANDLE h_file = CreateFileW(p, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (h_file == INVALID_HANDLE_VALUE) {
+		dwerror = GetLastError();
+		if (dwerror == ERROR_FILE_NOT_FOUND || dwerror == ERROR_PATH_NOT_FOUND)
+			return DGERR_NOT_FOUND;
+
+		DG_ERROR("fs_map_file(): CreateFileW() failed! GetLastError()=%d (0x%x)", dwerror, dwerror);
+		return DGERR_INTERNAL_ERROR;
+	}
+
+	if (!GetFileSizeEx(h_file, &filesize) || filesize.QuadPart == 0 || (uint64_t)filesize.QuadPart > SIZE_MAX) {
+		CloseHandle(h_file);
+		return DGERR_INVALID_PARAM;
+	}
+
+	/* the view keeps the section alive, both handles can be closed right away */
+	HANDLE h_mapping = CreateFileMappingW(h_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(h_file);
+	if (!h_mapping) {
+		dwerror = GetLastError();
+		DG_ERROR("fs_map_file(): CreateFileMappingW() failed! GetLastError()=%d (0x%x)", dwerror, dwerror);
+		return DGERR_INTERNAL_ERROR;
+	}
+
+	const void* pview = MapViewOfFile(h_mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(h_mapping);
+	if (!pview) {
+		dwerror = GetLastError();
+		DG_ERROR("fs_map_file(): MapViewOfFile() failed! GetLastError()=%d (0x%x)", dwerror, dwerror);
+		return DGERR_INTERNAL_ERROR;
+	}
+
+	fmapdata_t* pfmap = DG_NEW(fmapdata_t);
+	if (!pfmap) {
+		DG_ERROR("fmapdata_t allocation failed!");
+		UnmapViewOfFile(pview);
+		return DGERR_OUT_OF_MEMORY;
+	}
+	pfmap->pview = pview;
+	pfmap->size = (size_t)filesize.QuadPart;
+	*ppdata = pview;
+	*psize = pfmap->size;
+	*pdst = pfmap;
+	return DGERR_SUCCESS;
+#else
+	struct stat st;
+	char        fullpath[DGFS_MAX_LONG_PATH];
+	size_t      len = 0;
+	searchpathinf_t* pspinfo = ha_get_handle_data(&glob_search_pathes, pathid);
+	if (pspinfo) {
+		int n = wide_to_ansi(fullpath, sizeof(fullpath) - 1, path_get_string(&pspinfo->path));
+		if (n < 0)
+			return DGERR_INVALID_PARAM;
+		len = (size_t)n;
+		fullpath[len++] = '/';
+	}
+	if (wide_to_ansi(fullpath + len, sizeof(fullpath) - len, ppath) < 0)
+		return DGERR_INVALID_PARAM;
+
+	int fd = open(fullpath, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		if (errno == ENOENT || errno == ENOTDIR)
+			return DGERR_NOT_FOUND;
+
+		DG_ERROR("fs_map_file(): open() failed! errno=%d", errno);
+		return DGERR_INTERNAL_ERROR;
+	}
+
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0 || (uint64_t)st.st_size > SIZE_MAX) {
+		close(fd);
+		return DGERR_INVALID_PARAM;
+	}
+
+	/* the mapping holds its own reference to the file, the descriptor can be closed right away */
+	void* pview = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (pview == MAP_FAILED) {
+		DG_ERROR("fs_map_file(): mmap() failed! errno=%d", errno);
+		return DGERR_INTERNAL_ERROR;
+	}
+
+	fmapdata_t* pfmap = DG_NEW(fmapdata_t);
+	if (!pfmap) {
+		DG_ERROR("fmapdata_t allocation failed!");
+		munmap(pview, (size_t)st.st_size);
+		return DGERR_OUT_OF_MEMORY;
+	}
+	pfmap->pview = pview;
+	pfmap->size = (size_t)st.st_size;
+	*ppdata = pview;
+	*psize = pfmap->size;
+	*pdst = pfmap;
+	return DGERR_SUCCESS;
+#endif
+}
+
+int fs_unmap_file(dg_hfmap_t hfmap)
+{
+	if (!hfmap)
+		return DGERR_INVALID_HANDLE;
+
+#ifdef _WIN32
+	fmapdata_t* pfmap = (fmapdata_t*)hfmap;
+	UnmapViewOfFile(pfmap->pview);
+	DG_FREE(pfmap);
+	return DGERR_SUCCESS;
+#else
+	fmapdata_t* pfmap = (fmapdata_t*)hfmap;
+	munmap((void*)pfmap->pview, pfmap->size);
+	DG_FREE(pfmap);
+	return DGERR_SUCCESS;
+#endif
+}
+
 int fs_stor_open(dg_hstor_t* pdst, dg_pathid_t pathid, const char* pstrorname)
 {
 #ifdef _WIN32
@@ -0,0 +1,171 @@
+#include "dg_hash.h"
+#include "dg_cpuinfo.h"
+#include "dg_map.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DGHASH_X86 1
+#include <emmintrin.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define DGHASH_TARGET(x) __attribute__((target(x)))
+#else
+#define DGHASH_TARGET(x)
+#endif
+#endif
+
+typedef uint64_t (*hash_impl_proc)(const void* pdata, size_t len, uint64_t seed);
+
+static uint64_t hash_portable_impl(const void* pdata, size_t len, uint64_t seed)
+{
+	return dg_hash_bytes_seed(pdata, len, seed);
+}
+
+#if defined(DGHASH_X86) && (defined(_M_X64) || defined(__x86_64__))
+#define DGHASH_HAVE_CRC32 1
+/* 4 independent CRC32-C streams over 32-byte blocks, folded by the portable finalizer */
+DGHASH_TARGET("sse4.2")
+static uint64_t hash_crc32_impl(const void* pdata, size_t len, uint64_t seed)
+{
+	const uint8_t* p = (const uint8_t*)pdata;
+	if (len <= 32)
+		return dg_hash_bytes_seed(pdata, len, seed);
+
+	seed ^= dg__mum_(seed ^ DG__HS0, DG__HS1);
+	uint64_t c0 = (uint32_t)seed, c1 = seed >> 32, c2 = (uint32_t)~seed, c3 = ~seed >> 32;
+	size_t i = len;
+	while (i > 32) {
+		c0 = _mm_crc32_u64(c0, dg__rd8_(p));
+		c1 = _mm_crc32_u64(c1, dg__rd8_(p + 8));
+		c2 = _mm_crc32_u64(c2, dg__rd8_(p + 16));
+		c3 = _mm_crc32_u64(c3, dg__rd8_(p + 24));
+		p += 32; i -= 32;
+	}
+	/* last 32 bytes of the key, may overlap the ones already consumed */
+	p += i;
+	c0 = _mm_crc32_u64(c0, dg__rd8_(p - 32));
+	c1 = _mm_crc32_u64(c1, dg__rd8_(p - 24));
+	seed = dg__mum_(((c1 << 32) | c0) ^ DG__HS1, ((c3 << 32) | c2) ^ seed);
+	return dg__hash_final_(dg__rd8_(p - 16), dg__rd8_(p - 8), seed, len);
+}
+#endif
+
+#if defined(DGHASH_X86)
+#define DGHASH_HAVE_AES 1
+/* 2 lanes of one AES round per 16-byte block (block as round key), 3 rounds to merge */
+DGHASH_TARGET("aes,sse2")
+static uint64_t hash_aes_impl(const void* pdata, size_t len, uint64_t seed)
+{
+	const uint8_t* p = (const uint8_t*)pdata;
+	uint64_t w[2];
+	if (len <= 32)
+		return dg_hash_bytes_seed(pdata, len, seed);
+
+	seed ^= dg__mum_(seed ^ DG__HS0, DG__HS1);
+	__m128i k = _mm_set_epi64x((long long)(DG__HS2 ^ seed), (long long)(DG__HS3 ^ (uint64_t)len));
+	__m128i s0 = _mm_xor_si128(k, _mm_set_epi64x((long long)DG__HS0, (long long)DG__HS1));
+	__m128i s1 = k;
+	size_t i = len;
+	while (i > 32) {
+		s0 = _mm_aesenc_si128(s0, _mm_loadu_si128((const __m128i*)p));
+		s1 = _mm_aesenc_si128(s1, _mm_loadu_si128((const __m128i*)(p + 16)));
+		p += 32; i -= 32;
+	}
+	/* last 32 bytes of the key, may overlap the ones already consumed */
+	p += i;
+	s0 = _mm_aesenc_si128(s0, _mm_loadu_si128((const __m128i*)(p - 32)));
+	s1 = _mm_aesenc_si128(s1, _mm_loadu_si128((const __m128i*)(p - 16)));
+	__m128i s = _mm_aesenc_si128(s0, s1);
+	s = _mm_aesenc_si128(s, k);
+	s = _mm_aesenc_si128(s, s1);
+	_mm_storeu_si128((__m128i*)w, s);
+	return dg__mum_(w[0] ^ DG__HS1, w[1] ^ seed);
+}
+#endif
+
+static uint64_t hash_resolve_impl(const void* pdata, size_t len, uint64_t seed);
+
+static const hash_impl_proc glob_hash_procs[DGHASH_IMPL_AUTO] = {
+	hash_portable_impl,
+#ifdef DGHASH_HAVE_CRC32
+	hash_crc32_impl,
+#else
+	NULL,
+#endif
+#ifdef DGHASH_HAVE_AES
+	hash_aes_impl
+#else
+	NULL
+#endif
+};
+
+static const char* glob_hash_names[DGHASH_IMPL_COUNT] = { "portable", "crc32", "aes", "auto" };
+
+static hash_impl_proc glob_hash_proc = hash_resolve_impl; /* first call picks the implementation */
+static int            glob_hash_impl = DGHASH_IMPL_AUTO;
+
+static uint64_t hash_resolve_impl(const void* pdata, size_t len, uint64_t seed)
+{
+	hash_select_impl(DGHASH_IMPL_AUTO);
+	return glob_hash_proc(pdata, len, seed);
+}
+
+bool hash_impl_supported(int impl)
+{
+	dg_cpu_info_t cpuinfo;
+	if (impl == DGHASH_IMPL_PORTABLE || impl == DGHASH_IMPL_AUTO)
+		return true;
+	if (impl < 0 || impl >= DGHASH_IMPL_AUTO || !glob_hash_procs[impl])
+		return false;
+	if (cpu_get_info(&cpuinfo) != DGERR_SUCCESS)
+		return false;
+	if (impl == DGHASH_IMPL_CRC32)
+		return (cpuinfo.features & DGCPU_SSE4_2) != 0;
+	return (cpuinfo.features & (DGCPU_AES | DGCPU_SSE2)) == (DGCPU_AES | DGCPU_SSE2);
+}
+
+int hash_select_impl(int impl)
+{
+	if (impl < 0 || impl >= DGHASH_IMPL_COUNT)
+		return DGERR_INVALID_PARAM;
+
+	if (impl == DGHASH_IMPL_AUTO) {
+		/* ordered by long-key throughput */
+		if (hash_impl_supported(DGHASH_IMPL_AES))
+			impl = DGHASH_IMPL_AES;
+		else if (hash_impl_supported(DGHASH_IMPL_CRC32))
+			impl = DGHASH_IMPL_CRC32;
+		else
+			impl = DGHASH_IMPL_PORTABLE;
+	}
+	else if (!hash_impl_supported(impl)) {
+		return DGERR_UNIMPLEMENTED;
+	}
+	glob_hash_impl = impl;
+	glob_hash_proc = glob_hash_procs[impl];
+	return DGERR_SUCCESS;
+}
+
+int hash_get_impl()
+{
+	if (glob_hash_impl == DGHASH_IMPL_AUTO)
+		hash_select_impl(DGHASH_IMPL_AUTO);
+	return glob_hash_impl;
+}
+
+const char* hash_impl_name(int impl)
+{
+	if (impl < 0 || impl >= DGHASH_IMPL_COUNT)
+		return "unknown";
+	return glob_hash_names[impl];
+}
+
+uint64_t hash_bytes_seed(const void* pdata, size_t len, uint64_t seed)
+{
+	return glob_hash_proc(pdata, len, seed);
+}
+
+uint64_t hash_bytes(const void* pdata, size_t len)
+{
+	return glob_hash_proc(pdata, len, 0);
+}
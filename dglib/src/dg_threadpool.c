@@ -10,16 +10,17 @@ int thread_pool_workers_entry(struct dg_thrd_data_s* ptinfo)
   dg_threadpool_t* pthreadpool = pworker->ptpool;
   setjmp(pworker->start_context);//TODO: K.D. use this later
   while (dg_atomic_load(&pthreadpool->status) == DGTPSTATUS_RUNNING) {
-    printf("thread_pool_workers_entry() thread %u start execution\n", get_curr_thread_id());
-    dg_task_t *ptask = (dg_task_t*)mtqueue_get_front(&pthreadpool->tasks);
-    ptask->pworker = pworker;
-    ptask->tstart = 0.; //TODO: K.D. use this later
+    /* copy out: the queue slot is reused by producers as soon as it is taken */
+    dg_task_t task;
+    mtqueue_get_front_copy(&task, &pthreadpool->tasks);
+    task.pworker = pworker;
+    task.tstart = 0.; //TODO: K.D. use this later
 
     /* check special termination marker in task */
-    if (!ptask->ptaskproc)
+    if (!task.ptaskproc)
       break; //break cycle
     
-    ptask->ptaskproc(ptask);
+    task.ptaskproc(&task);
   }
   semaphore_post(pthreadpool->pfinish_sem);
   return 0;
@@ -113,6 +114,76 @@ int tp_task_add(dg_threadpool_t* ptp,
   return DGERR_SUCCESS;
 }
 
+typedef struct tp_range_s {
+  dg_tp_range_proc proc;
+  void*            puserdata;
+  size_t           begin;
+  size_t           end;
+  dg_semaphore_t   done_sem;
+} tp_range_t;
+
+static void tp_range_task_proc(dg_task_t* ptask)
+{
+  tp_range_t* prange = (tp_range_t*)ptask->puserdata;
+  prange->proc(prange->puserdata, prange->begin, prange->end);
+  semaphore_post(prange->done_sem);
+}
+
+int tp_parallel_for(dg_threadpool_t* ptp,
+  size_t count,
+  size_t nparts,
+  dg_tp_range_proc proc,
+  void* puserdata)
+{
+  if (!ptp || !proc)
+    return DGERR_INVALID_PARAM;
+  if (!count)
+    return DGERR_SUCCESS;
+  if (nparts < 1)
+    nparts = 1;
+  if (nparts > count)
+    nparts = count;
+
+  tp_range_t* pranges = DG_ALLOC(tp_range_t, nparts);
+  if (!pranges) {
+    DG_ERROR("tp_parallel_for(): ranges allocation failed");
+    return DGERR_OUT_OF_MEMORY;
+  }
+  dg_semaphore_t done_sem = NULL;
+  if (nparts > 1) {
+    done_sem = semaphore_alloc(0, (int)nparts, "dg_threadpool_t:parallel_for_sem");
+    if (!done_sem) {
+      DG_ERROR("tp_parallel_for(): semaphore_alloc() failed");
+      DG_FREE(pranges);
+      return DGERR_OUT_OF_MEMORY;
+    }
+  }
+
+  /* ranges differ in size by one item at most */
+  size_t nqueued = 0;
+  for (size_t i = 0; i < nparts; i++) {
+    pranges[i].proc = proc;
+    pranges[i].puserdata = puserdata;
+    pranges[i].begin = count * i / nparts;
+    pranges[i].end = count * (i + 1) / nparts;
+    pranges[i].done_sem = done_sem;
+    if (i == 0)
+      continue;
+    if (tp_task_add(ptp, tp_range_task_proc, NULL, DGTASKPRIOR_MIDDLE, &pranges[i], 0.) == DGERR_SUCCESS)
+      nqueued++;
+    else
+      proc(puserdata, pranges[i].begin, pranges[i].end);
+  }
+  proc(puserdata, pranges[0].begin, pranges[0].end);
+  while (nqueued--)
+    semaphore_wait(done_sem);
+
+  if (done_sem)
+    semaphore_free(done_sem);
+  DG_FREE(pranges);
+  return DGERR_SUCCESS;
+}
+
 void tp_join(dg_threadpool_t* ptp)
 {
   assert(ptp->pfinish_sem && "ptp->pfinish_sem is NULL");
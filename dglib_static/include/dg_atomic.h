@@ -1,4 +1,5 @@
 #pragma once
+#include <stddef.h>
 
 #if defined(_M_X64) || defined(_M_ARM64)
 typedef volatile long long atomic_size_t;
@@ -14,4 +15,12 @@ size_t dg_atomic_load(atomic_size_t *ptr);
 size_t dg_atomic_store(atomic_size_t* ptr, atomic_size_t val);
 size_t dg_atomic_exchange(atomic_size_t* ptr, atomic_size_t val);
 size_t dg_atomic_fetch_add(atomic_size_t* ptr, atomic_size_t val);
-size_t dg_atomic_fetch_sub(atomic_size_t* ptr, atomic_size_t val);
\ No newline at end of file
+size_t dg_atomic_fetch_sub(atomic_size_t* ptr, atomic_size_t val);
+
+/* ordered variants for lock-free structures, plain loads/stores on x86 */
+size_t dg_atomic_load_acquire(atomic_size_t* ptr);
+void   dg_atomic_store_release(atomic_size_t* ptr, atomic_size_t val);
+/* returns the previous value, the exchange happened if it equals expected */
+size_t dg_atomic_compare_exchange(atomic_size_t* ptr, atomic_size_t expected, atomic_size_t desired);
+/* full barrier: orders earlier stores before later loads, which release/acquire do not */
+void   dg_atomic_fence(void);
\ No newline at end of file
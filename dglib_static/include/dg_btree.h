@@ -0,0 +1,394 @@
+// dg_btree.h - header-only C99 ordered map based on a B+tree
+// Public Domain / Unlicense. Same API shape as DG_TMAP (dg_treemap.h).
+//
+// Goals vs red-black tree:
+// - Many keys per node: a lookup touches height (~log_16 N) nodes instead of log_2 N
+// - Nodes are DG_BTREE_NODE_BYTES wide (a few cache lines), keys of a node are contiguous
+//   and searched with a branchless lower bound
+// - Values live only in the leaves, leaves are linked both ways, so range scans and
+//   iteration walk whole leaves sequentially
+// - Leaves and inner nodes live in two per-map arrays and link by 32-bit index (0 = none),
+//   erased nodes are reused through free lists
+// - Inserting past the last key keeps the split leaf full, so ascending bulk inserts
+//   produce densely packed leaves
+//
+// API is macro-generated per (K,V) pair with a user-supplied comparator CMP(a,b):
+//   <0 if a<b, 0 if equal, >0 if a>b.
+// Optional KEYFREE/VALFREE hooks via _EX variant.
+//
+// Example:
+//   static int u64_cmp(uint64_t a, uint64_t b){ return (a>b)-(a<b); }
+//   DG_BTREE_DECL(u64bt, uint64_t, uint64_t);
+//   DG_BTREE_IMPL(u64bt, uint64_t, uint64_t, u64_cmp);
+//
+//   u64bt m; u64bt_init(&m);
+//   uint64_t v = 1; u64bt_insert(&m, 42, &v, NULL);
+//   for (u64bt_it it = u64bt_lower_bound(&m, 40); it; it = u64bt_iter_next(&m, it)) {
+//       if (*u64bt_iter_key(&m, it) >= 50) break;
+//       /* use *u64bt_iter_val(&m, it) */
+//   }
+//   u64bt_destroy(&m);
+//
+// Notes:
+// - Iterators are (leaf index, slot) pairs, 0 = end. Insert and erase move entries inside
+//   and between leaves, so they invalidate iterators (use the one NAME_erase_at returns)
+//   and pointers from NAME_get_ref/NAME_iter_key/NAME_iter_val.
+// - Keys and values are copied with assignment.
+//
+#ifndef DG_BTREE_H
+#define DG_BTREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef DG_BTREE_REALLOC
+#  define DG_BTREE_REALLOC(p,sz) realloc(p,sz)
+#endif
+#ifndef DG_BTREE_FREE
+#  define DG_BTREE_FREE(p) free(p)
+#endif
+
+// Target node size in bytes; fan-out is derived from it and the key/value sizes.
+// Read where DG_BTREE_DECL expands.
+#ifndef DG_BTREE_NODE_BYTES
+#  define DG_BTREE_NODE_BYTES 512
+#endif
+
+#define DG__BTREE_NOOP_FREE(p) ((void)0)
+#define DG__BTREE_MAX_HEIGHT 32          /* inner levels; fan-out is at least 2 */
+#define DG__BTREE_MAX_NODES  0xFFFFFFFFu /* per node array, slot 0 is "none" */
+#define DG__BTREE_CAP_(x) ((x) < 4 ? 4 : (x))
+#define DG__BTREE_IT_(leaf, slot) (((uint64_t)(leaf) << 32) | (uint32_t)(slot))
+
+// grows a node array geometrically to at least want elements
+static inline int dg__btree_grow_(void** parr, uint32_t* pcap, size_t elem, size_t want) {
+	if (want <= *pcap) return 1;
+	if (want > DG__BTREE_MAX_NODES) return 0;
+	size_t ncap = *pcap ? *pcap : 4;
+	while (ncap < want) ncap *= 2;
+	if (ncap > DG__BTREE_MAX_NODES) ncap = DG__BTREE_MAX_NODES;
+	void* p = DG_BTREE_REALLOC(*parr, ncap * elem);
+	if (!p) return 0;
+	*parr = p; *pcap = (uint32_t)ncap;
+	return 1;
+}
+
+// Declarations generator
+#define DG_BTREE_DECL(NAME, K, V) \
+    typedef uint64_t NAME##_it; /* leaf index << 32 | slot, 0 = end */ \
+    enum { \
+        NAME##_LEAF_CAP = (int)DG__BTREE_CAP_((DG_BTREE_NODE_BYTES - 3 * sizeof(uint32_t)) / (sizeof(K) + sizeof(V))), \
+        NAME##_INNER_CAP = (int)DG__BTREE_CAP_((DG_BTREE_NODE_BYTES - 2 * sizeof(uint32_t)) / (sizeof(K) + sizeof(uint32_t))) \
+    }; \
+    typedef struct NAME##_leaf { \
+        K keys[NAME##_LEAF_CAP]; \
+        V vals[NAME##_LEAF_CAP]; \
+        uint32_t n, next, prev; /* next also links free leaves */ \
+    } NAME##_leaf; \
+    typedef struct NAME##_inner { \
+        K keys[NAME##_INNER_CAP]; /* keys[i]: lower bound of subtree child[i + 1] */ \
+        uint32_t child[NAME##_INNER_CAP + 1]; /* child[0] also links free inner nodes */ \
+        uint32_t n; /* keys, n + 1 children */ \
+    } NAME##_inner; \
+    typedef struct NAME { \
+        NAME##_leaf  *leaves; \
+        NAME##_inner *inners; \
+        uint32_t nleaves, leaf_cap, leaf_free; \
+        uint32_t ninners, inner_cap, inner_free; \
+        uint32_t root; /* leaf when height == 0, 0 when empty */ \
+        uint32_t height; /* inner levels */ \
+        uint32_t first, last; /* leftmost / rightmost leaf */ \
+        size_t size; \
+    } NAME; \
+    /* basic ops */ \
+    int  NAME##_init(NAME* m); \
+    void NAME##_clear(NAME* m); \
+    void NAME##_destroy(NAME* m); \
+    size_t NAME##_size(const NAME* m); \
+    /* CRUD */ \
+    int  NAME##_insert(NAME* m, K key, const V* val, int* replaced); \
+    int  NAME##_get(const NAME* m, K key, V* out); \
+    V*   NAME##_get_ref(NAME* m, K key); \
+    int  NAME##_erase(NAME* m, K key); \
+    /* iterators (in-order) */ \
+    NAME##_it NAME##_iter_begin(const NAME* m); \
+    NAME##_it NAME##_iter_end(const NAME* m); \
+    NAME##_it NAME##_iter_next(const NAME* m, NAME##_it it); \
+    NAME##_it NAME##_iter_prev(const NAME* m, NAME##_it it); \
+    K* NAME##_iter_key(const NAME* m, NAME##_it it); \
+    V* NAME##_iter_val(const NAME* m, NAME##_it it); \
+    NAME##_it NAME##_erase_at(NAME* m, NAME##_it it); \
+    /* bounds */ \
+    NAME##_it NAME##_lower_bound(const NAME* m, K key); \
+    NAME##_it NAME##_upper_bound(const NAME* m, K key);
+
+// Implementation generator (default free hooks = no-op)
+#define DG_BTREE_IMPL(NAME, K, V, CMPFN) \
+    DG_BTREE_IMPL_EX(NAME, K, V, CMPFN, DG__BTREE_NOOP_FREE, DG__BTREE_NOOP_FREE)
+
+#define DG_BTREE_IMPL_EX(NAME, K, V, CMPFN, KEYFREE, VALFREE) \
+    /* first slot with keys[i] >= key (branchless, the compiler emits cmov) */ \
+    static inline uint32_t NAME##__lb_(const K* keys, uint32_t n, K key){ \
+        if(!n) return 0; \
+        const K* base=keys; \
+        while(n > 1){ uint32_t half=n >> 1; base = (CMPFN(base[half], key) < 0) ? base + half : base; n -= half; } \
+        return (uint32_t)(base - keys) + (CMPFN(*base, key) < 0); \
+    } \
+    /* first slot with keys[i] > key */ \
+    static inline uint32_t NAME##__ub_(const K* keys, uint32_t n, K key){ \
+        if(!n) return 0; \
+        const K* base=keys; \
+        while(n > 1){ uint32_t half=n >> 1; base = (CMPFN(base[half], key) <= 0) ? base + half : base; n -= half; } \
+        return (uint32_t)(base - keys) + (CMPFN(*base, key) <= 0); \
+    } \
+    static inline uint32_t NAME##__find_leaf_(const NAME* m, K key){ \
+        uint32_t n=m->root; \
+        for(uint32_t h=m->height; h; --h){ const NAME##_inner* in=&m->inners[n]; n=in->child[NAME##__ub_(in->keys,in->n,key)]; } \
+        return n; \
+    } \
+    /* makes room for one leaf and height + 1 inner nodes, so a split cannot fail halfway */ \
+    static int NAME##__reserve_split_(NAME* m){ \
+        void* p=m->leaves; int ok=m->leaf_free || dg__btree_grow_(&p,&m->leaf_cap,sizeof(NAME##_leaf),(size_t)m->nleaves + 1); \
+        m->leaves=(NAME##_leaf*)p; \
+        p=m->inners; ok = ok && dg__btree_grow_(&p,&m->inner_cap,sizeof(NAME##_inner),(size_t)m->ninners + m->height + 1); \
+        m->inners=(NAME##_inner*)p; \
+        return ok; \
+    } \
+    static uint32_t NAME##__new_leaf_(NAME* m){ \
+        uint32_t l; \
+        if(m->leaf_free){ l=m->leaf_free; m->leaf_free=m->leaves[l].next; } \
+        else { \
+            void* p=m->leaves; \
+            if(!dg__btree_grow_(&p,&m->leaf_cap,sizeof(NAME##_leaf),(size_t)m->nleaves + 1)) return 0; \
+            m->leaves=(NAME##_leaf*)p; l=m->nleaves++; \
+        } \
+        m->leaves[l].n=0; m->leaves[l].next=m->leaves[l].prev=0; \
+        return l; \
+    } \
+    /* only called after NAME##__reserve_split_ */ \
+    static uint32_t NAME##__new_inner_(NAME* m){ \
+        uint32_t i; \
+        if(m->inner_free){ i=m->inner_free; m->inner_free=m->inners[i].child[0]; } \
+        else i=m->ninners++; \
+        m->inners[i].n=0; \
+        return i; \
+    } \
+    static inline void NAME##__free_leaf_(NAME* m, uint32_t l){ m->leaves[l].n=0; m->leaves[l].next=m->leaf_free; m->leaf_free=l; } \
+    static inline void NAME##__free_inner_(NAME* m, uint32_t i){ m->inners[i].child[0]=m->inner_free; m->inner_free=i; } \
+    int NAME##_init(NAME* m){ if(!m) return 0; memset(m,0,sizeof(*m)); m->nleaves=1; m->ninners=1; return 1; } \
+    void NAME##_clear(NAME* m){ if(!m) return; \
+        for(uint32_t l=m->size ? m->first : 0; l; l=m->leaves[l].next){ \
+            NAME##_leaf* lf=&m->leaves[l]; \
+            for(uint32_t s=0; s<lf->n; ++s){ KEYFREE(&lf->keys[s]); VALFREE(&lf->vals[s]); } \
+        } \
+        m->nleaves=1; m->ninners=1; m->leaf_free=m->inner_free=0; \
+        m->root=m->height=m->first=m->last=0; m->size=0; \
+    } \
+    void NAME##_destroy(NAME* m){ if(!m) return; NAME##_clear(m); \
+        DG_BTREE_FREE(m->leaves); DG_BTREE_FREE(m->inners); m->leaves=NULL; m->inners=NULL; m->leaf_cap=m->inner_cap=0; } \
+    size_t NAME##_size(const NAME* m){ return m?m->size:0; } \
+    int NAME##_get(const NAME* m, K key, V* out){ \
+        if(!m || !m->size) return 0; \
+        const NAME##_leaf* lf=&m->leaves[NAME##__find_leaf_(m,key)]; \
+        uint32_t s=NAME##__lb_(lf->keys,lf->n,key); \
+        if(s == lf->n || CMPFN(lf->keys[s],key) != 0) return 0; \
+        if(out) *out=lf->vals[s]; \
+        return 1; \
+    } \
+    V* NAME##_get_ref(NAME* m, K key){ \
+        if(!m || !m->size) return NULL; \
+        NAME##_leaf* lf=&m->leaves[NAME##__find_leaf_(m,key)]; \
+        uint32_t s=NAME##__lb_(lf->keys,lf->n,key); \
+        return (s < lf->n && CMPFN(lf->keys[s],key) == 0) ? &lf->vals[s] : NULL; \
+    } \
+    int NAME##_insert(NAME* m, K key, const V* val, int* replaced){ \
+        uint32_t path[DG__BTREE_MAX_HEIGHT], slot[DG__BTREE_MAX_HEIGHT]; \
+        if(!m) return 0; \
+        if(!m->root){ uint32_t l=NAME##__new_leaf_(m); if(!l) return 0; m->root=m->first=m->last=l; m->height=0; } \
+        uint32_t n=m->root, h; \
+        for(h=0; h<m->height; ++h){ const NAME##_inner* in=&m->inners[n]; path[h]=n; slot[h]=NAME##__ub_(in->keys,in->n,key); n=in->child[slot[h]]; } \
+        NAME##_leaf* lf=&m->leaves[n]; \
+        uint32_t s=NAME##__lb_(lf->keys,lf->n,key); \
+        if(s < lf->n && CMPFN(lf->keys[s],key) == 0){ if(replaced) *replaced=1; VALFREE(&lf->vals[s]); lf->vals[s]=*val; return 1; } \
+        if(lf->n < NAME##_LEAF_CAP){ \
+            memmove(&lf->keys[s+1],&lf->keys[s],(lf->n - s)*sizeof(K)); memmove(&lf->vals[s+1],&lf->vals[s],(lf->n - s)*sizeof(V)); \
+            lf->keys[s]=key; lf->vals[s]=*val; lf->n++; \
+            m->size++; if(replaced) *replaced=0; return 1; \
+        } \
+        if(!NAME##__reserve_split_(m)) return 0; \
+        /* leaf split: past the last key the old leaf stays full, otherwise halves */ \
+        uint32_t r=NAME##__new_leaf_(m); \
+        lf=&m->leaves[n]; NAME##_leaf* rl=&m->leaves[r]; \
+        uint32_t keep=(s == NAME##_LEAF_CAP && !lf->next) ? NAME##_LEAF_CAP : (NAME##_LEAF_CAP + 1) / 2; \
+        if(s < keep){ \
+            uint32_t mv=NAME##_LEAF_CAP - (keep - 1); \
+            memcpy(rl->keys,&lf->keys[keep-1],mv*sizeof(K)); memcpy(rl->vals,&lf->vals[keep-1],mv*sizeof(V)); \
+            rl->n=mv; lf->n=keep - 1; \
+            memmove(&lf->keys[s+1],&lf->keys[s],(lf->n - s)*sizeof(K)); memmove(&lf->vals[s+1],&lf->vals[s],(lf->n - s)*sizeof(V)); \
+            lf->keys[s]=key; lf->vals[s]=*val; lf->n++; \
+        } else { \
+            uint32_t mv=NAME##_LEAF_CAP - keep, rs=s - keep; \
+            memcpy(rl->keys,&lf->keys[keep],rs*sizeof(K)); memcpy(rl->vals,&lf->vals[keep],rs*sizeof(V)); \
+            rl->keys[rs]=key; rl->vals[rs]=*val; \
+            memcpy(&rl->keys[rs+1],&lf->keys[s],(mv - rs)*sizeof(K)); memcpy(&rl->vals[rs+1],&lf->vals[s],(mv - rs)*sizeof(V)); \
+            rl->n=mv + 1; lf->n=keep; \
+        } \
+        rl->next=lf->next; rl->prev=n; \
+        if(lf->next) m->leaves[lf->next].prev=r; else m->last=r; \
+        lf->next=r; \
+        m->size++; if(replaced) *replaced=0; \
+        /* push (separator, right node) up, splitting full inner nodes */ \
+        K sep=rl->keys[0]; uint32_t child=r; \
+        while(h-- > 0){ \
+            NAME##_inner* in=&m->inners[path[h]]; uint32_t at=slot[h]; \
+            if(in->n < NAME##_INNER_CAP){ \
+                memmove(&in->keys[at+1],&in->keys[at],(in->n - at)*sizeof(K)); \
+                memmove(&in->child[at+2],&in->child[at+1],(in->n - at)*sizeof(uint32_t)); \
+                in->keys[at]=sep; in->child[at+1]=child; in->n++; \
+                return 1; \
+            } \
+            K tk[NAME##_INNER_CAP + 1]; uint32_t tc[NAME##_INNER_CAP + 2]; \
+            memcpy(tk,in->keys,at*sizeof(K)); tk[at]=sep; memcpy(&tk[at+1],&in->keys[at],(NAME##_INNER_CAP - at)*sizeof(K)); \
+            memcpy(tc,in->child,(at+1)*sizeof(uint32_t)); tc[at+1]=child; memcpy(&tc[at+2],&in->child[at+1],(NAME##_INNER_CAP - at)*sizeof(uint32_t)); \
+            uint32_t ri=NAME##__new_inner_(m), mid=(NAME##_INNER_CAP + 1) / 2; \
+            NAME##_inner* rn=&m->inners[ri]; in=&m->inners[path[h]]; \
+            memcpy(in->keys,tk,mid*sizeof(K)); memcpy(in->child,tc,(mid+1)*sizeof(uint32_t)); in->n=mid; \
+            rn->n=NAME##_INNER_CAP - mid; \
+            memcpy(rn->keys,&tk[mid+1],rn->n*sizeof(K)); memcpy(rn->child,&tc[mid+1],(rn->n+1)*sizeof(uint32_t)); \
+            sep=tk[mid]; child=ri; \
+        } \
+        uint32_t nr=NAME##__new_inner_(m); \
+        NAME##_inner* root=&m->inners[nr]; \
+        root->n=1; root->keys[0]=sep; root->child[0]=m->root; root->child[1]=child; \
+        m->root=nr; m->height++; \
+        return 1; \
+    } \
+    /* removes entry s of the leaf at the end of path; *pmoved is set when other entries moved */ \
+    static void NAME##__erase_slot_(NAME* m, const uint32_t* path, const uint32_t* slot, uint32_t l, uint32_t s, int* pmoved){ \
+        NAME##_leaf* lf=&m->leaves[l]; \
+        const uint32_t lmin=NAME##_LEAF_CAP / 2, imin=NAME##_INNER_CAP / 2; \
+        KEYFREE(&lf->keys[s]); VALFREE(&lf->vals[s]); \
+        memmove(&lf->keys[s],&lf->keys[s+1],(lf->n - s - 1)*sizeof(K)); memmove(&lf->vals[s],&lf->vals[s+1],(lf->n - s - 1)*sizeof(V)); \
+        lf->n--; m->size--; \
+        if(!m->height){ \
+            if(!lf->n){ NAME##__free_leaf_(m,l); m->root=m->first=m->last=0; } \
+            return; \
+        } \
+        if(lf->n >= lmin) return; \
+        if(pmoved) *pmoved=1; \
+        uint32_t h=m->height - 1; \
+        NAME##_inner* p=&m->inners[path[h]]; uint32_t i=slot[h]; \
+        NAME##_leaf* ls=i ? &m->leaves[p->child[i-1]] : NULL; \
+        NAME##_leaf* rs=i < p->n ? &m->leaves[p->child[i+1]] : NULL; \
+        if(ls && ls->n > lmin){ \
+            memmove(&lf->keys[1],lf->keys,lf->n*sizeof(K)); memmove(&lf->vals[1],lf->vals,lf->n*sizeof(V)); \
+            lf->keys[0]=ls->keys[ls->n-1]; lf->vals[0]=ls->vals[ls->n-1]; lf->n++; ls->n--; \
+            p->keys[i-1]=lf->keys[0]; \
+            return; \
+        } \
+        if(rs && rs->n > lmin){ \
+            lf->keys[lf->n]=rs->keys[0]; lf->vals[lf->n]=rs->vals[0]; lf->n++; \
+            memmove(rs->keys,&rs->keys[1],(rs->n - 1)*sizeof(K)); memmove(rs->vals,&rs->vals[1],(rs->n - 1)*sizeof(V)); rs->n--; \
+            p->keys[i]=rs->keys[0]; \
+            return; \
+        } \
+        /* merge with a sibling, the parent loses key k and child k + 1 */ \
+        uint32_t k=ls ? i - 1 : i; \
+        NAME##_leaf* L=ls ? ls : lf; NAME##_leaf* R=ls ? lf : rs; uint32_t ri=p->child[k+1]; \
+        memcpy(&L->keys[L->n],R->keys,R->n*sizeof(K)); memcpy(&L->vals[L->n],R->vals,R->n*sizeof(V)); L->n+=R->n; \
+        L->next=R->next; \
+        if(R->next) m->leaves[R->next].prev=p->child[k]; else m->last=p->child[k]; \
+        NAME##__free_leaf_(m,ri); \
+        for(;;){ \
+            memmove(&p->keys[k],&p->keys[k+1],(p->n - k - 1)*sizeof(K)); \
+            memmove(&p->child[k+1],&p->child[k+2],(p->n - k - 1)*sizeof(uint32_t)); \
+            p->n--; \
+            if(!h){ \
+                if(!p->n){ m->root=p->child[0]; NAME##__free_inner_(m,path[0]); m->height--; } \
+                return; \
+            } \
+            if(p->n >= imin) return; \
+            NAME##_inner* in=p; \
+            h--; p=&m->inners[path[h]]; i=slot[h]; \
+            NAME##_inner* li=i ? &m->inners[p->child[i-1]] : NULL; \
+            NAME##_inner* rn=i < p->n ? &m->inners[p->child[i+1]] : NULL; \
+            if(li && li->n > imin){ \
+                memmove(&in->keys[1],in->keys,in->n*sizeof(K)); memmove(&in->child[1],in->child,(in->n+1)*sizeof(uint32_t)); \
+                in->keys[0]=p->keys[i-1]; in->child[0]=li->child[li->n]; in->n++; \
+                p->keys[i-1]=li->keys[li->n-1]; li->n--; \
+                return; \
+            } \
+            if(rn && rn->n > imin){ \
+                in->keys[in->n]=p->keys[i]; in->child[in->n+1]=rn->child[0]; in->n++; \
+                p->keys[i]=rn->keys[0]; \
+                memmove(rn->keys,&rn->keys[1],(rn->n - 1)*sizeof(K)); memmove(rn->child,&rn->child[1],rn->n*sizeof(uint32_t)); rn->n--; \
+                return; \
+            } \
+            k=li ? i - 1 : i; \
+            NAME##_inner* LI=li ? li : in; NAME##_inner* RI=li ? in : rn; \
+            LI->keys[LI->n]=p->keys[k]; \
+            memcpy(&LI->keys[LI->n+1],RI->keys,RI->n*sizeof(K)); memcpy(&LI->child[LI->n+1],RI->child,(RI->n+1)*sizeof(uint32_t)); \
+            LI->n+=RI->n + 1; \
+            NAME##__free_inner_(m,p->child[k+1]); \
+        } \
+    } \
+    static int NAME##__erase_key_(NAME* m, K key, int* pmoved){ \
+        uint32_t path[DG__BTREE_MAX_HEIGHT], slot[DG__BTREE_MAX_HEIGHT]; \
+        if(!m || !m->size) return 0; \
+        uint32_t n=m->root; \
+        for(uint32_t h=0; h<m->height; ++h){ const NAME##_inner* in=&m->inners[n]; path[h]=n; slot[h]=NAME##__ub_(in->keys,in->n,key); n=in->child[slot[h]]; } \
+        const NAME##_leaf* lf=&m->leaves[n]; \
+        uint32_t s=NAME##__lb_(lf->keys,lf->n,key); \
+        if(s == lf->n || CMPFN(lf->keys[s],key) != 0) return 0; \
+        NAME##__erase_slot_(m,path,slot,n,s,pmoved); \
+        return 1; \
+    } \
+    int NAME##_erase(NAME* m, K key){ return NAME##__erase_key_(m,key,NULL); } \
+    NAME##_it NAME##_iter_begin(const NAME* m){ return (m && m->size) ? DG__BTREE_IT_(m->first,0) : 0; } \
+    NAME##_it NAME##_iter_end(const NAME* m){ (void)m; return 0; } \
+    NAME##_it NAME##_iter_next(const NAME* m, NAME##_it it){ \
+        if(!it) return 0; \
+        uint32_t l=(uint32_t)(it >> 32), s=(uint32_t)it + 1; \
+        if(s < m->leaves[l].n) return DG__BTREE_IT_(l,s); \
+        l=m->leaves[l].next; \
+        return l ? DG__BTREE_IT_(l,0) : 0; \
+    } \
+    NAME##_it NAME##_iter_prev(const NAME* m, NAME##_it it){ \
+        if(!it) return 0; \
+        uint32_t l=(uint32_t)(it >> 32), s=(uint32_t)it; \
+        if(s) return DG__BTREE_IT_(l,s - 1); \
+        l=m->leaves[l].prev; \
+        return l ? DG__BTREE_IT_(l,m->leaves[l].n - 1) : 0; \
+    } \
+    K* NAME##_iter_key(const NAME* m, NAME##_it it){ return it ? &m->leaves[it >> 32].keys[(uint32_t)it] : NULL; } \
+    V* NAME##_iter_val(const NAME* m, NAME##_it it){ return it ? &m->leaves[it >> 32].vals[(uint32_t)it] : NULL; } \
+    NAME##_it NAME##_erase_at(NAME* m, NAME##_it it){ \
+        if(!m || !it) return 0; \
+        NAME##_it nxt=NAME##_iter_next(m,it); \
+        K key=*NAME##_iter_key(m,it), nkey; \
+        int moved=0; \
+        if(nxt) nkey=*NAME##_iter_key(m,nxt); else memset(&nkey,0,sizeof(nkey)); \
+        NAME##__erase_key_(m,key,&moved); \
+        if(!nxt) return 0; \
+        if(moved) return NAME##_lower_bound(m,nkey); \
+        /* nothing moved between leaves: the next entry shifted into this slot or starts the next leaf */ \
+        return ((uint64_t)nxt >> 32) == (it >> 32) ? it : nxt; \
+    } \
+    NAME##_it NAME##_lower_bound(const NAME* m, K key){ \
+        if(!m || !m->size) return 0; \
+        uint32_t l=NAME##__find_leaf_(m,key); const NAME##_leaf* lf=&m->leaves[l]; \
+        uint32_t s=NAME##__lb_(lf->keys,lf->n,key); \
+        if(s < lf->n) return DG__BTREE_IT_(l,s); \
+        return lf->next ? DG__BTREE_IT_(lf->next,0) : 0; \
+    } \
+    NAME##_it NAME##_upper_bound(const NAME* m, K key){ \
+        if(!m || !m->size) return 0; \
+        uint32_t l=NAME##__find_leaf_(m,key); const NAME##_leaf* lf=&m->leaves[l]; \
+        uint32_t s=NAME##__ub_(lf->keys,lf->n,key); \
+        if(s < lf->n) return DG__BTREE_IT_(l,s); \
+        return lf->next ? DG__BTREE_IT_(lf->next,0) : 0; \
+    }
+
+#endif /* DG_BTREE_H */
@@ -0,0 +1,230 @@
+// dg_cmap.h - sharded concurrent hash map generator on top of dg_map.h
+// Public Domain / Unlicense. Header-only, same DECL/IMPL split as dg_map.h.
+//
+// The key space is split into N power-of-two shards selected by the hash bits
+// right below the 7-bit control tag. Each shard is a plain DG_MAP instance with
+// its own ctrl/hash/keys/vals arrays and its own dg_rwlock_t, padded to a cache
+// line so shards never false-share. Readers of different shards never touch a
+// common cache line; writers only serialize with operations on the same shard.
+//
+// Usage example (u64 -> u64):
+//   #define ccount_smap_KEY_FREE(k) ((void)0)   /* hooks of the shard maps */
+//   #define ccount_smap_VAL_FREE(v) ((void)0)
+//   DG_CMAP_DECL(ccount, uint64_t, uint64_t)
+//   DG_CMAP_IMPL(ccount, uint64_t, uint64_t, my_u64_hash, my_u64_eq)
+//
+//   ccount m; ccount_init(&m, 64, 0);
+//   uint64_t one = 1; ccount_set(&m, &key, &one, NULL);
+//   ccount_upsert_with(&m, &key, add_one_proc, NULL);
+//   ccount_destroy(&m);
+//
+// Notes:
+// - HASHFN is evaluated once per call; the shard map reuses that hash.
+// - _get copies the value out under the shard read lock; there is no _get_ref,
+//   a pointer into a shard would outlive the lock. Use _upsert_with to mutate.
+// - Statistics counters are maintained under the shard write lock, contention
+//   counters are bumped only on the slow path (try-lock failed).
+
+#ifndef DG_CMAP_H
+#define DG_CMAP_H
+
+#include "dg_map.h"
+#include "dg_sync.h"
+#include "dg_atomic.h"
+
+#define DG_CMAP_MAX_SHARDS 4096
+
+/**
+* @brief Per-shard statistics snapshot
+*/
+typedef struct dg_cmap_stats_s {
+	size_t size; /*< live entries */
+	size_t capacity; /*< buckets */
+	size_t tombs; /*< tombstones */
+	size_t nsets; /*< inserts and replaces */
+	size_t nerases; /*< successful erases */
+	size_t nrd_contended; /*< read locks that had to wait */
+	size_t nwr_contended; /*< write locks that had to wait */
+} dg_cmap_stats_t;
+
+#define DG_CMAP_DECL(NAME, K, V) \
+    DG_MAP_DECL(NAME##_smap, K, V) \
+    typedef struct NAME##_shard_data { \
+        dg_rwlock_t   lock; \
+        NAME##_smap   map; \
+        size_t        nsets; \
+        size_t        nerases; \
+        atomic_size_t nrd_contended; \
+        atomic_size_t nwr_contended; \
+    } NAME##_shard_data; \
+    typedef union NAME##_shard { \
+        NAME##_shard_data d; \
+        char pad[DG_ALIGN_UP(sizeof(NAME##_shard_data), DG_CACHE_LINE_SIZE)]; \
+    } NAME##_shard; \
+    typedef struct NAME { \
+        size_t        nshards; \
+        unsigned      shift; \
+        NAME##_shard *shards; \
+        void         *pmem; \
+    } NAME; \
+    /* fn receives the current value (existed=1) or a zeroed one (existed=0) */ \
+    typedef void (*NAME##_upsert_proc)(V *val, int existed, void *puserdata); \
+    int  NAME##_init(NAME *m, size_t nshards, size_t initial_capacity); \
+    void NAME##_destroy(NAME *m); \
+    void NAME##_clear(NAME *m); \
+    size_t NAME##_size(NAME *m); \
+    int  NAME##_set(NAME *m, const K *key, const V *val, int *replaced); \
+    int  NAME##_get(NAME *m, const K *key, V *out_val); \
+    int  NAME##_erase(NAME *m, const K *key); \
+    int  NAME##_upsert_with(NAME *m, const K *key, NAME##_upsert_proc fn, void *puserdata); \
+    int  NAME##_shard_stats(NAME *m, size_t shard, dg_cmap_stats_t *pdst);
+
+#define DG_CMAP_IMPL(NAME, K, V, HASHFN, EQFN) \
+    DG_MAP_IMPL(NAME##_smap, K, V, HASHFN, EQFN) \
+    static inline NAME##_shard_data* NAME##__shard_(const NAME *m, uint64_t h) { \
+        /* bits [57-shift, 57): independent of the ctrl tag and of the bucket index bits */ \
+        return &m->shards[(size_t)(h >> (57 - m->shift)) & (m->nshards - 1)].d; \
+    } \
+    static inline void NAME##__rdlock_(NAME##_shard_data *s) { \
+        if (rwlock_try_rdlock(s->lock) != 0) { \
+            dg_atomic_fetch_add(&s->nrd_contended, 1); \
+            rwlock_rdlock(s->lock); \
+        } \
+    } \
+    static inline void NAME##__wrlock_(NAME##_shard_data *s) { \
+        if (rwlock_try_wrlock(s->lock) != 0) { \
+            dg_atomic_fetch_add(&s->nwr_contended, 1); \
+            rwlock_wrlock(s->lock); \
+        } \
+    } \
+    int NAME##_init(NAME *m, size_t nshards, size_t initial_capacity) { \
+        if (!m) return 0; \
+        if (nshards < 1) nshards = 1; \
+        if (nshards > DG_CMAP_MAX_SHARDS) nshards = DG_CMAP_MAX_SHARDS; \
+        m->nshards = 1; m->shift = 0; \
+        while (m->nshards < nshards) { m->nshards <<= 1; m->shift++; } \
+        m->pmem = DG_MAP_MALLOC(m->nshards * sizeof(NAME##_shard) + DG_CACHE_LINE_SIZE); \
+        if (!m->pmem) return 0; \
+        m->shards = (NAME##_shard*)DG_ALIGN_UP((uintptr_t)m->pmem, DG_CACHE_LINE_SIZE); \
+        memset(m->shards, 0, m->nshards * sizeof(NAME##_shard)); \
+        size_t per_shard = initial_capacity ? initial_capacity / m->nshards + 1 : 0; \
+        for (size_t i = 0; i < m->nshards; ++i) { \
+            NAME##_shard_data *s = &m->shards[i].d; \
+            s->lock = rwlock_alloc("dg_cmap:shard_lock"); \
+            if (!s->lock || !NAME##_smap_init(&s->map, per_shard)) { \
+                m->nshards = i + 1; \
+                NAME##_destroy(m); \
+                return 0; \
+            } \
+        } \
+        return 1; \
+    } \
+    void NAME##_destroy(NAME *m) { \
+        if (!m || !m->shards) return; \
+        for (size_t i = 0; i < m->nshards; ++i) { \
+            NAME##_shard_data *s = &m->shards[i].d; \
+            NAME##_smap_destroy(&s->map); \
+            if (s->lock) rwlock_free(s->lock); \
+        } \
+        DG_MAP_FREE(m->pmem); \
+        m->pmem = NULL; m->shards = NULL; \
+        m->nshards = 0; m->shift = 0; \
+    } \
+    void NAME##_clear(NAME *m) { \
+        if (!m) return; \
+        for (size_t i = 0; i < m->nshards; ++i) { \
+            NAME##_shard_data *s = &m->shards[i].d; \
+            rwlock_wrlock(s->lock); \
+            NAME##_smap_clear(&s->map); \
+            rwlock_wrunlock(s->lock); \
+        } \
+    } \
+    size_t NAME##_size(NAME *m) { \
+        size_t total = 0; \
+        if (!m) return 0; \
+        for (size_t i = 0; i < m->nshards; ++i) { \
+            NAME##_shard_data *s = &m->shards[i].d; \
+            rwlock_rdlock(s->lock); \
+            total += s->map.size; \
+            rwlock_rdunlock(s->lock); \
+        } \
+        return total; \
+    } \
+    int NAME##_set(NAME *m, const K *key, const V *val, int *replaced) { \
+        if (!m) return 0; \
+        uint64_t h = (uint64_t)HASHFN(*key); \
+        NAME##_shard_data *s = NAME##__shard_(m, h); \
+        NAME##__wrlock_(s); \
+        int ok = NAME##_smap__insert_(&s->map, h, key, val, replaced); \
+        s->nsets += (size_t)ok; \
+        rwlock_wrunlock(s->lock); \
+        return ok; \
+    } \
+    int NAME##_get(NAME *m, const K *key, V *out_val) { \
+        if (!m) return 0; \
+        uint64_t h = (uint64_t)HASHFN(*key); \
+        NAME##_shard_data *s = NAME##__shard_(m, h); \
+        int found = 0; \
+        NAME##__rdlock_(s); \
+        if (s->map.cap) { \
+            size_t idx = NAME##_smap__find_(&s->map, h, key); \
+            if (idx != (size_t)-1) { \
+                if (out_val) *out_val = *NAME##_smap__val_at_(&s->map, idx); \
+                found = 1; \
+            } \
+        } \
+        rwlock_rdunlock(s->lock); \
+        return found; \
+    } \
+    int NAME##_erase(NAME *m, const K *key) { \
+        if (!m) return 0; \
+        uint64_t h = (uint64_t)HASHFN(*key); \
+        NAME##_shard_data *s = NAME##__shard_(m, h); \
+        int found = 0; \
+        NAME##__wrlock_(s); \
+        if (s->map.cap) { \
+            size_t idx = NAME##_smap__find_(&s->map, h, key); \
+            if (idx != (size_t)-1) { \
+                NAME##_smap__remove_(&s->map, idx); \
+                s->nerases++; \
+                found = 1; \
+            } \
+        } \
+        rwlock_wrunlock(s->lock); \
+        return found; \
+    } \
+    int NAME##_upsert_with(NAME *m, const K *key, NAME##_upsert_proc fn, void *puserdata) { \
+        if (!m || !fn) return 0; \
+        uint64_t h = (uint64_t)HASHFN(*key); \
+        NAME##_shard_data *s = NAME##__shard_(m, h); \
+        int ok = 1; \
+        NAME##__wrlock_(s); \
+        size_t idx = s->map.cap ? NAME##_smap__find_(&s->map, h, key) : (size_t)-1; \
+        if (idx != (size_t)-1) { \
+            fn(NAME##_smap__val_at_(&s->map, idx), 1, puserdata); \
+        } else { \
+            V tmp; \
+            memset(&tmp, 0, sizeof(tmp)); \
+            fn(&tmp, 0, puserdata); \
+            ok = NAME##_smap__insert_(&s->map, h, key, &tmp, NULL); \
+        } \
+        s->nsets += (size_t)ok; \
+        rwlock_wrunlock(s->lock); \
+        return ok; \
+    } \
+    int NAME##_shard_stats(NAME *m, size_t shard, dg_cmap_stats_t *pdst) { \
+        if (!m || !pdst || shard >= m->nshards) return 0; \
+        NAME##_shard_data *s = &m->shards[shard].d; \
+        rwlock_rdlock(s->lock); \
+        pdst->size = s->map.size; \
+        pdst->capacity = s->map.cap; \
+        pdst->tombs = s->map.tombs; \
+        pdst->nsets = s->nsets; \
+        pdst->nerases = s->nerases; \
+        rwlock_rdunlock(s->lock); \
+        pdst->nrd_contended = dg_atomic_load(&s->nrd_contended); \
+        pdst->nwr_contended = dg_atomic_load(&s->nwr_contended); \
+        return 1; \
+    }
+
+#endif /* DG_CMAP_H */
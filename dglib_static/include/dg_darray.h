@@ -1,6 +1,36 @@
 #pragma once
 #include "dg_alloc.h"
 
+/**
+ * @brief Capacity growth policies
+ * @details Applied when an insertion needs more room than the capacity.
+ * Geometric policies make a push loop amortized O(1).
+ */
+enum DGDARRAY_GROW {
+  DGDARRAY_GROW_2X = 0,  /**< double the capacity (default) */
+  DGDARRAY_GROW_1_5X,    /**< grow by half of the capacity, less slack, more reallocs */
+  DGDARRAY_GROW_CHUNK,   /**< needed size + reserve elements, O(n) reallocs in a push loop */
+  DGDARRAY_GROW_CALLBACK /**< capacity returned by pgrow */
+};
+
+struct dg_darray_s;
+
+/**
+ * @brief Growth callback for DGDARRAY_GROW_CALLBACK
+ * @param pd Pointer to array (capacity is the current one)
+ * @param mincap Capacity needed by the insertion
+ * @return New capacity, values below mincap are raised to mincap
+ */
+typedef size_t (*dg_darray_grow_proc)(const struct dg_darray_s* pd, size_t mincap);
+
+/**
+ * @brief Element predicate for darray_remove_if
+ * @param pelem Pointer to element
+ * @param puserdata User data passed to darray_remove_if
+ * @return true to remove the element
+ */
+typedef bool (*dg_darray_pred_proc)(const void* pelem, void* puserdata);
+
 /**
  * @brief Dynamic array structure (1D)
  * @details Stores metadata and pointer to data for a dynamic array.
@@ -8,9 +38,11 @@
 typedef struct dg_darray_s {
   size_t   elemsize;   /**< Size of one element in bytes */
   size_t   capacity;   /**< Allocated capacity (number of elements) */
-  size_t   reserve;    /**< Reserved minimum capacity */
+  size_t   reserve;    /**< Reserved minimum capacity, chunk size for DGDARRAY_GROW_CHUNK */
   size_t   size;       /**< Current number of elements */
   uint8_t* pdata;      /**< Pointer to data buffer */
+  uint32_t growth;     /**< Growth policy (DGDARRAY_GROW) */
+  dg_darray_grow_proc pgrow; /**< Growth callback for DGDARRAY_GROW_CALLBACK */
 } dg_darray_t;
 
 /**
@@ -47,6 +79,9 @@ typedef struct dg_darray_s {
 #define darray_get_reserve(p)        ((p)->reserve)         /**< Get reserved capacity */
 #define darray_get_elemsize(p)       ((p)->elemsize)        /**< Get element size */
 #define darray_set_reserve(p, newr)  assert((newr)!=0), (p)->reserve = (newr) /**< Set reserved capacity */
+#define darray_get_growth(p)         ((p)->growth)          /**< Get growth policy */
+#define darray_set_growth(p, g)      ((p)->growth = (g))    /**< Set growth policy (DGDARRAY_GROW) */
+#define darray_set_growth_proc(p, f) ((p)->growth = DGDARRAY_GROW_CALLBACK, (p)->pgrow = (f)) /**< Set growth callback */
 ///@}
 
 /**
@@ -87,11 +122,21 @@ void* darray_get_ex(dg_darray_t* pdarray, size_t idx);
 int     darray_resize(dg_darray_t* pdarray, size_t newsize);
 /**
  * @brief Reallocate array to new capacity
+ * @details Grows by the growth policy, so the capacity may end up larger than newcap.
  * @param pdarray Pointer to array
  * @param newcap New capacity
  * @return 0 on success, -1 on failure
  */
 int     darray_realloc(dg_darray_t* pdarray, size_t newcap);
+/**
+ * @brief Make room for at least count elements without growth slack
+ * @details Reallocates to exactly count elements if the capacity is smaller,
+ * for arrays whose final size is known up front.
+ * @param pdarray Pointer to array
+ * @param count Number of elements
+ * @return 0 on success, -1 on failure
+ */
+int     darray_reserve_exact(dg_darray_t* pdarray, size_t count);
 /**
  * @brief Shrink array capacity to fit size
  * @param pdarray Pointer to array
@@ -113,17 +158,46 @@ void    darray_move(dg_darray_t* pdst, dg_darray_t* psrc);
 int     darray_copy(dg_darray_t* pdst, const dg_darray_t* psrc);
 
 /**
- * @brief Remove elements from index to end
+ * @brief Remove element at index, shifting the tail down
  * @param pdarray Pointer to array
- * @param idxfrom Index to start removing
+ * @param idxfrom Index of the element
  */
 void    darray_remove_from(dg_darray_t* pdarray, size_t idxfrom);
 /**
- * @brief Remove elements from index to end (fast, does not preserve order)
+ * @brief Remove element at index (fast, moves the last element into its place)
  * @param pdarray Pointer to array
- * @param idxfrom Index to start removing
+ * @param idxfrom Index of the element
  */
 void    darray_remove_from_fast(dg_darray_t* pdarray, size_t idxfrom);
+/**
+ * @brief Remove count elements starting at index, keeping the order of the rest
+ * @details The tail is moved once, O(size - from) regardless of count.
+ * @param pdarray Pointer to array
+ * @param from Index of the first element
+ * @param count Number of elements
+ */
+void    darray_erase_range(dg_darray_t* pdarray, size_t from, size_t count);
+/**
+ * @brief Insert count elements before index
+ * @details The tail is moved once. psrc may point into the array itself;
+ * with psrc NULL the new elements are left for the caller to fill.
+ * @param pdarray Pointer to array
+ * @param at Insert position (0..size)
+ * @param psrc Pointer to count source elements or NULL
+ * @param count Number of elements
+ * @return DGERR_SUCCESS, DGERR_OUT_OF_MEMORY or DGERR_OVERFLOWED
+ */
+int     darray_insert_range(dg_darray_t* pdarray, size_t at, const void* psrc, size_t count);
+/**
+ * @brief Remove all elements matching pred, keeping the order of the rest
+ * @details One pass, pred is called once per element in index order and
+ * each run of kept elements is moved with a single memmove.
+ * @param pdarray Pointer to array
+ * @param pred Predicate, true removes the element
+ * @param puserdata User data passed to pred
+ * @return Number of removed elements
+ */
+size_t  darray_remove_if(dg_darray_t* pdarray, dg_darray_pred_proc pred, void* puserdata);
 
 /**
  * @brief Insert elements from another array
@@ -228,6 +302,21 @@ static inline size_t darray_get_remaining_size(const dg_darray_t* pd) {
  */
 #define darray_is_empty(p) (!((p)->size))
 
+/**
+ * @brief Element layouts of 2D/3D arrays
+ * @details The layout is chosen before allocation and is transparent to the
+ * get accessors. Tiled arrays store square (2D) or cubic (3D) tiles of
+ * 2^tileshift elements per axis, tiles and the elements inside a tile in
+ * row-major order, so a small neighborhood spans a few tiles instead of
+ * rows or planes far apart. Dimensions are padded to whole tiles.
+ */
+enum DGDARRAY_LAYOUT {
+  DGDARRAY_LAYOUT_ROWMAJOR = 0, /**< last index contiguous (default) */
+  DGDARRAY_LAYOUT_TILED         /**< 2^tileshift tiles per axis */
+};
+
+#define DGDARRAY_TILE_SHIFT 3 /**< Default tile edge of 8: 8x8 tiles, 8x8x8 bricks */
+
 /** @defgroup darray2d 2D dynamic array
  *  @{
  */
@@ -238,6 +327,8 @@ typedef struct dg_darray2d_s {
   size_t rows, cols;      /**< Number of rows and columns */
   size_t elemsize;        /**< Size of one element in bytes */
   uint8_t* pdata;         /**< Pointer to data buffer */
+  uint32_t layout;        /**< Element layout (DGDARRAY_LAYOUT) */
+  uint32_t tileshift;     /**< log2 of the tile edge for DGDARRAY_LAYOUT_TILED */
 } dg_darray2d_t;
 
 /**
@@ -252,6 +343,34 @@ typedef struct dg_darray2d_s {
     .pdata = NULL                  \
 }
 
+/**
+ * @brief Tiled 2D array initializer
+ * @param _rows Number of rows
+ * @param _cols Number of columns
+ * @param type Element type
+ * @param shift log2 of the tile edge (DGDARRAY_TILE_SHIFT for 8x8)
+ */
+#define darray2d_init_tiled(_rows,_cols,type,shift) { \
+    .rows = (_rows), .cols = (_cols),      \
+    .elemsize = sizeof(type),      \
+    .pdata = NULL,                 \
+    .layout = DGDARRAY_LAYOUT_TILED, \
+    .tileshift = (shift)           \
+}
+
+/**
+ * @brief Get number of allocated elements (dimensions padded to whole tiles)
+ * @param pd Pointer to 2D array
+ * @return Element count
+ */
+static inline size_t darray2d_get_alloc_count(const dg_darray2d_t* pd) {
+  if (pd->layout == DGDARRAY_LAYOUT_TILED) {
+    size_t m = ((size_t)1 << pd->tileshift) - 1;
+    return ((pd->rows + m) & ~m) * ((pd->cols + m) & ~m);
+  }
+  return pd->rows * pd->cols;
+}
+
 /**
  * @brief Allocate memory for 2D array
  * @param pd Pointer to 2D array
@@ -260,7 +379,7 @@ typedef struct dg_darray2d_s {
  */
 static inline bool darray2d_alloc(dg_darray2d_t* pd, bool clear) {
   assert(pd);
-  size_t total = pd->rows * pd->cols;
+  size_t total = darray2d_get_alloc_count(pd);
   pd->pdata = malloc(total * pd->elemsize);
   if (!pd->pdata)
     return false;
@@ -299,6 +418,11 @@ static inline void* darray2d_get_ex(
 {
   assert(pd && pd->pdata);
   assert(i < pd->rows && j < pd->cols);
+  if (pd->layout == DGDARRAY_LAYOUT_TILED) {
+    size_t s = pd->tileshift, m = ((size_t)1 << s) - 1;
+    size_t tile = (i >> s) * ((pd->cols + m) >> s) + (j >> s);
+    return pd->pdata + ((((tile << s) | (i & m)) << s) | (j & m)) * pd->elemsize;
+  }
   return pd->pdata + ((i * pd->cols) + j) * pd->elemsize;
 }
 /**
@@ -309,6 +433,64 @@ static inline void* darray2d_get_ex(
  * @param type Element type
  */
 #define darray2d_get(pd,i,j,type) (*((type*)darray2d_get_ex((pd),(i),(j))))
+
+/**
+ * @brief Contiguous-strided block of a 2D array, see darray2d_tile_first()
+ */
+typedef struct dg_darray2d_tile_s {
+  size_t i0, j0;   /**< Index of the first element */
+  size_t n0, n1;   /**< Tile extents, clipped at the array edges */
+  size_t stride0;  /**< Element stride of the row index, columns are contiguous */
+  uint8_t* pdata;  /**< Pointer to element (i0, j0) */
+} dg_darray2d_tile_t;
+
+static inline void darray2d__tile_set(const dg_darray2d_t* pd, dg_darray2d_tile_t* pt) {
+  size_t e = (size_t)1 << (pd->layout == DGDARRAY_LAYOUT_TILED ? pd->tileshift : DGDARRAY_TILE_SHIFT);
+  pt->n0 = (pd->rows - pt->i0 < e) ? pd->rows - pt->i0 : e;
+  pt->n1 = (pd->cols - pt->j0 < e) ? pd->cols - pt->j0 : e;
+  pt->stride0 = (pd->layout == DGDARRAY_LAYOUT_TILED) ? e : pd->cols;
+  pt->pdata = (uint8_t*)darray2d_get_ex(pd, pt->i0, pt->j0);
+}
+
+/**
+ * @brief Start walking the array a tile at a time
+ * @details Tiles follow the storage order. Row-major arrays are walked in
+ * DGDARRAY_TILE_SHIFT tiles, so a kernel written against tiles runs on both layouts.
+ * @param pd Pointer to 2D array
+ * @param pt Receives the first tile
+ * @return false if the array is empty
+ */
+static inline bool darray2d_tile_first(const dg_darray2d_t* pd, dg_darray2d_tile_t* pt) {
+  if (!pd->rows || !pd->cols)
+    return false;
+  pt->i0 = pt->j0 = 0;
+  darray2d__tile_set(pd, pt);
+  return true;
+}
+
+/**
+ * @brief Advance to the next tile
+ * @param pd Pointer to 2D array
+ * @param pt Tile from darray2d_tile_first()/darray2d_tile_next()
+ * @return false after the last tile
+ */
+static inline bool darray2d_tile_next(const dg_darray2d_t* pd, dg_darray2d_tile_t* pt) {
+  size_t e = (size_t)1 << (pd->layout == DGDARRAY_LAYOUT_TILED ? pd->tileshift : DGDARRAY_TILE_SHIFT);
+  pt->j0 += e;
+  if (pt->j0 >= pd->cols) {
+    pt->j0 = 0;
+    pt->i0 += e;
+    if (pt->i0 >= pd->rows)
+      return false;
+  }
+  darray2d__tile_set(pd, pt);
+  return true;
+}
+
+/**
+ * @brief Get element (a, b) of a tile (typed), a < n0, b < n1
+ */
+#define darray2d_tile_get(pt,a,b,type) (((type*)(pt)->pdata)[(a) * (pt)->stride0 + (b)])
 /** @} */
 
 /** @defgroup darray3d 3D dynamic array
@@ -321,6 +503,8 @@ typedef struct dg_darray3d_s {
   size_t dim0, dim1, dim2; /**< Dimensions */
   size_t elemsize;         /**< Size of one element in bytes */
   uint8_t* pdata;          /**< Pointer to data buffer */
+  uint32_t layout;         /**< Element layout (DGDARRAY_LAYOUT) */
+  uint32_t tileshift;      /**< log2 of the brick edge for DGDARRAY_LAYOUT_TILED */
 } dg_darray3d_t;
 
 /**
@@ -336,6 +520,35 @@ typedef struct dg_darray3d_s {
     .pdata = NULL                               \
 }
 
+/**
+ * @brief Tiled 3D array initializer
+ * @param d0 First dimension
+ * @param d1 Second dimension
+ * @param d2 Third dimension
+ * @param type Element type
+ * @param shift log2 of the brick edge (DGDARRAY_TILE_SHIFT for 8x8x8)
+ */
+#define darray3d_init_tiled(d0,d1,d2,type,shift) { \
+    .dim0 = (d0), .dim1 = (d1), .dim2 = (d2), \
+    .elemsize = sizeof(type),                   \
+    .pdata = NULL,                              \
+    .layout = DGDARRAY_LAYOUT_TILED,            \
+    .tileshift = (shift)                        \
+}
+
+/**
+ * @brief Get number of allocated elements (dimensions padded to whole bricks)
+ * @param pd Pointer to 3D array
+ * @return Element count
+ */
+static inline size_t darray3d_get_alloc_count(const dg_darray3d_t* pd) {
+  if (pd->layout == DGDARRAY_LAYOUT_TILED) {
+    size_t m = ((size_t)1 << pd->tileshift) - 1;
+    return ((pd->dim0 + m) & ~m) * ((pd->dim1 + m) & ~m) * ((pd->dim2 + m) & ~m);
+  }
+  return pd->dim0 * pd->dim1 * pd->dim2;
+}
+
 /**
  * @brief Allocate memory for 3D array
  * @param pd Pointer to 3D array
@@ -344,7 +557,7 @@ typedef struct dg_darray3d_s {
  */
 static inline bool darray3d_alloc(dg_darray3d_t* pd, bool clear) {
   assert(pd);
-  size_t total = pd->dim0 * pd->dim1 * pd->dim2;
+  size_t total = darray3d_get_alloc_count(pd);
   pd->pdata = malloc(total * pd->elemsize);
   if (!pd->pdata)
     return false;
@@ -382,6 +595,12 @@ static inline void* darray3d_get_ex(
   size_t i, size_t j, size_t k) {
   assert(pd && pd->pdata);
   assert(i < pd->dim0 && j < pd->dim1 && k < pd->dim2);
+  if (pd->layout == DGDARRAY_LAYOUT_TILED) {
+    size_t s = pd->tileshift, m = ((size_t)1 << s) - 1;
+    size_t brick = ((i >> s) * ((pd->dim1 + m) >> s) + (j >> s)) * ((pd->dim2 + m) >> s) + (k >> s);
+    size_t idx = ((((((brick << s) | (i & m)) << s) | (j & m)) << s) | (k & m));
+    return pd->pdata + idx * pd->elemsize;
+  }
   size_t idx = ((i * pd->dim1 + j) * pd->dim2 + k);
   return pd->pdata + idx * pd->elemsize;
 }
@@ -394,6 +613,79 @@ static inline void* darray3d_get_ex(
  * @param type Element type
  */
 #define darray3d_get(pd,i,j,k,type) (*((type*)darray3d_get_ex((pd),(i),(j),(k))))
+
+/**
+ * @brief Strided brick of a 3D array, see darray3d_brick_first()
+ */
+typedef struct dg_darray3d_brick_s {
+  size_t i0, j0, k0;  /**< Index of the first element */
+  size_t n0, n1, n2;  /**< Brick extents, clipped at the array edges */
+  size_t stride0;     /**< Element stride of the first index */
+  size_t stride1;     /**< Element stride of the second index, the third is contiguous */
+  uint8_t* pdata;     /**< Pointer to element (i0, j0, k0) */
+} dg_darray3d_brick_t;
+
+static inline void darray3d__brick_set(const dg_darray3d_t* pd, dg_darray3d_brick_t* pb) {
+  size_t e = (size_t)1 << (pd->layout == DGDARRAY_LAYOUT_TILED ? pd->tileshift : DGDARRAY_TILE_SHIFT);
+  pb->n0 = (pd->dim0 - pb->i0 < e) ? pd->dim0 - pb->i0 : e;
+  pb->n1 = (pd->dim1 - pb->j0 < e) ? pd->dim1 - pb->j0 : e;
+  pb->n2 = (pd->dim2 - pb->k0 < e) ? pd->dim2 - pb->k0 : e;
+  if (pd->layout == DGDARRAY_LAYOUT_TILED) {
+    pb->stride1 = e;
+    pb->stride0 = e * e;
+  }
+  else {
+    pb->stride1 = pd->dim2;
+    pb->stride0 = pd->dim1 * pd->dim2;
+  }
+  pb->pdata = (uint8_t*)darray3d_get_ex(pd, pb->i0, pb->j0, pb->k0);
+}
+
+/**
+ * @brief Start walking the array a brick at a time
+ * @details Bricks follow the storage order; inside a brick, neighbors along each
+ * axis are stride0/stride1/1 elements apart. Row-major arrays are walked in
+ * DGDARRAY_TILE_SHIFT bricks, so a kernel written against bricks runs on both layouts.
+ * @param pd Pointer to 3D array
+ * @param pb Receives the first brick
+ * @return false if the array is empty
+ */
+static inline bool darray3d_brick_first(const dg_darray3d_t* pd, dg_darray3d_brick_t* pb) {
+  if (!pd->dim0 || !pd->dim1 || !pd->dim2)
+    return false;
+  pb->i0 = pb->j0 = pb->k0 = 0;
+  darray3d__brick_set(pd, pb);
+  return true;
+}
+
+/**
+ * @brief Advance to the next brick
+ * @param pd Pointer to 3D array
+ * @param pb Brick from darray3d_brick_first()/darray3d_brick_next()
+ * @return false after the last brick
+ */
+static inline bool darray3d_brick_next(const dg_darray3d_t* pd, dg_darray3d_brick_t* pb) {
+  size_t e = (size_t)1 << (pd->layout == DGDARRAY_LAYOUT_TILED ? pd->tileshift : DGDARRAY_TILE_SHIFT);
+  pb->k0 += e;
+  if (pb->k0 >= pd->dim2) {
+    pb->k0 = 0;
+    pb->j0 += e;
+    if (pb->j0 >= pd->dim1) {
+      pb->j0 = 0;
+      pb->i0 += e;
+      if (pb->i0 >= pd->dim0)
+        return false;
+    }
+  }
+  darray3d__brick_set(pd, pb);
+  return true;
+}
+
+/**
+ * @brief Get element (a, b, c) of a brick (typed), a < n0, b < n1, c < n2
+ */
+#define darray3d_brick_get(pb,a,b,c,type) \
+  (((type*)(pb)->pdata)[(a) * (pb)->stride0 + (b) * (pb)->stride1 + (c)])
 /** @} */
 
 /**
@@ -0,0 +1,266 @@
+#pragma once
+#include "dg_darray.h"
+#include "dg_threadpool.h"
+
+/**
+ * @brief Element comparator, qsort convention
+ * @return <0 if a < b, 0 if equal, >0 if a > b
+ */
+typedef int (*dg_darray_cmp_proc)(const void* pa, const void* pb);
+
+/**
+ * @brief Radix sort key types
+ * @details Signed keys sort numerically, float keys in IEEE total order
+ * (-NaN < -inf < ... < -0 < +0 < ... < +inf < +NaN).
+ */
+enum DGDARRAY_KEY {
+  DGDARRAY_KEY_U32 = 0,
+  DGDARRAY_KEY_U64,
+  DGDARRAY_KEY_I32,
+  DGDARRAY_KEY_I64,
+  DGDARRAY_KEY_F32,
+  DGDARRAY_KEY_F64
+};
+
+#define DGDARRAY_SORT_MIN_PART 16384 /**< Elements per task of darray_sort_par, at least */
+
+/**
+ * @brief Sort array (not stable)
+ * @param pdarray Pointer to array
+ * @param cmp Comparator
+ */
+void    darray_sort(dg_darray_t* pdarray, dg_darray_cmp_proc cmp);
+/**
+ * @brief Sort array on a thread pool (not stable)
+ * @details Parts are sorted by the workers, then merged pairwise in log2(parts)
+ * rounds. Every round splits each merge into equal output pieces (merge path),
+ * so the last rounds keep all workers busy as well. Needs a scratch buffer of
+ * the array size. With ptp NULL or a small array it runs darray_sort(), and
+ * so does a round the pool fails to run (the array still ends up sorted).
+ * @param pdarray Pointer to array
+ * @param cmp Comparator
+ * @param ptp Thread pool or NULL
+ * @return DGERR_SUCCESS or DGERR_OUT_OF_MEMORY (array unchanged)
+ */
+int     darray_sort_par(dg_darray_t* pdarray, dg_darray_cmp_proc cmp, dg_threadpool_t* ptp);
+/**
+ * @brief Stable LSD radix sort by an integer or float key inside the element
+ * @details 8-bit digits, digits equal in all keys are skipped. Needs a scratch
+ * buffer of the array size.
+ * @param pdarray Pointer to array
+ * @param keyoffset Byte offset of the key in the element
+ * @param keytype Key type (DGDARRAY_KEY)
+ * @return DGERR_SUCCESS, DGERR_INVALID_PARAM or DGERR_OUT_OF_MEMORY (array unchanged)
+ */
+int     darray_radix_sort(dg_darray_t* pdarray, size_t keyoffset, uint32_t keytype);
+/**
+ * @brief Remove consecutive duplicates, keeping the first of each run
+ * @param pdarray Pointer to (sorted) array
+ * @param cmp Comparator, 0 means duplicate
+ * @return New size
+ */
+size_t  darray_unique(dg_darray_t* pdarray, dg_darray_cmp_proc cmp);
+/**
+ * @brief Find the first element not less than key
+ * @param pdarray Pointer to sorted array
+ * @param pkey Pointer to key element
+ * @param cmp Comparator
+ * @return Index of the element, size if all elements are less than key
+ */
+size_t  darray_lower_bound(const dg_darray_t* pdarray, const void* pkey, dg_darray_cmp_proc cmp);
+/**
+ * @brief Merge two sorted arrays into pdst (stable, pa first on ties)
+ * @param pdst Destination array, replaced; must not be pa or pb
+ * @param pa First sorted array
+ * @param pb Second sorted array
+ * @param cmp Comparator
+ * @return DGERR_SUCCESS, DGERR_INVALID_PARAM or DGERR_OUT_OF_MEMORY
+ */
+int     darray_merge(dg_darray_t* pdst, const dg_darray_t* pa, const dg_darray_t* pb, dg_darray_cmp_proc cmp);
+
+/**
+ * @brief Typed variants with an inlined comparison
+ * @details DG_DARRAY_SORT_IMPL(NAME, T, LESS) generates static functions over
+ * arrays of T, LESS(a, b) is an expression true if a < b:
+ *
+ *   void   NAME_sort(dg_darray_t* pd)                       introsort, not stable
+ *   int    NAME_sort_par(dg_darray_t* pd, dg_threadpool_t* ptp)
+ *   size_t NAME_lower_bound(const dg_darray_t* pd, T key)    branchless
+ *   size_t NAME_unique(dg_darray_t* pd)
+ *   int    NAME_merge(dg_darray_t* pdst, const dg_darray_t* pa, const dg_darray_t* pb)
+ *
+ * Example:
+ *   #define U64_LESS(a, b) ((a) < (b))
+ *   DG_DARRAY_SORT_IMPL(u64arr, uint64_t, U64_LESS)
+ *   u64arr_sort_par(&arr, &pool);
+ */
+#define DG_DARRAY_SORT_IMPL(NAME, T, LESS) \
+  static inline void NAME##__insertion_(T* a, size_t n) { \
+    for (size_t i = 1; i < n; i++) { \
+      T x = a[i]; \
+      size_t j = i; \
+      for (; j > 0 && LESS(x, a[j - 1]); j--) \
+        a[j] = a[j - 1]; \
+      a[j] = x; \
+    } \
+  } \
+  static inline void NAME##__sift_(T* a, size_t i, size_t n) { \
+    T x = a[i]; \
+    for (size_t c; (c = 2 * i + 1) < n; i = c) { \
+      if (c + 1 < n && LESS(a[c], a[c + 1])) c++; \
+      if (!LESS(x, a[c])) break; \
+      a[i] = a[c]; \
+    } \
+    a[i] = x; \
+  } \
+  static inline void NAME##__heapsort_(T* a, size_t n) { \
+    for (size_t i = n / 2; i-- > 0;) \
+      NAME##__sift_(a, i, n); \
+    while (n > 1) { \
+      T x = a[0]; a[0] = a[--n]; a[n] = x; \
+      NAME##__sift_(a, 0, n); \
+    } \
+  } \
+  static void NAME##__introsort_(T* a, size_t n, int depth) { \
+    while (n > 16) { \
+      if (depth-- == 0) { NAME##__heapsort_(a, n); return; } \
+      /* median of three to a[0], a[n / 2] <= a[0] <= a[n - 1] */ \
+      T x, *m = a + n / 2, *l = a + n - 1; \
+      if (LESS(*l, *m)) { x = *l; *l = *m; *m = x; } \
+      if (LESS(a[0], *m)) { x = a[0]; a[0] = *m; *m = x; } \
+      else if (LESS(*l, a[0])) { x = a[0]; a[0] = *l; *l = x; } \
+      T pivot = a[0]; \
+      size_t i = 0, j = n; \
+      for (;;) { \
+        while (LESS(a[++i], pivot)); \
+        while (LESS(pivot, a[--j])); \
+        if (i >= j) break; \
+        x = a[i]; a[i] = a[j]; a[j] = x; \
+      } \
+      a[0] = a[j]; a[j] = pivot; \
+      /* recurse into the smaller side */ \
+      if (j < n - j - 1) { NAME##__introsort_(a, j, depth); a += j + 1; n -= j + 1; } \
+      else { NAME##__introsort_(a + j + 1, n - j - 1, depth); n = j; } \
+    } \
+    NAME##__insertion_(a, n); \
+  } \
+  static inline void NAME##__sort_n_(T* a, size_t n) { \
+    int depth = 0; \
+    for (size_t k = n; k > 1; k >>= 1) depth += 2; \
+    NAME##__introsort_(a, n, depth); \
+  } \
+  static inline void NAME##_sort(dg_darray_t* pd) { \
+    assert(pd->elemsize == sizeof(T)); \
+    NAME##__sort_n_((T*)pd->pdata, pd->size); \
+  } \
+  static inline size_t NAME##_lower_bound(const dg_darray_t* pd, T key) { \
+    const T* a = (const T*)pd->pdata; \
+    size_t base = 0, n = pd->size; \
+    assert(pd->elemsize == sizeof(T)); \
+    while (n > 1) { \
+      size_t half = n / 2; \
+      base = LESS(a[base + half - 1], key) ? base + half : base; \
+      n -= half; \
+    } \
+    return base + (n == 1 && LESS(a[base], key)); \
+  } \
+  static inline size_t NAME##_unique(dg_darray_t* pd) { \
+    T* a = (T*)pd->pdata; \
+    size_t w = 0; \
+    assert(pd->elemsize == sizeof(T)); \
+    for (size_t r = 0; r < pd->size; r++) \
+      if (!w || LESS(a[w - 1], a[r]) || LESS(a[r], a[w - 1])) \
+        a[w++] = a[r]; \
+    pd->size = w; \
+    return w; \
+  } \
+  /* stable merge of a[0..na) and b[0..nb) into out, a first on ties */ \
+  static inline void NAME##__merge_(T* out, const T* a, size_t na, const T* b, size_t nb) { \
+    size_t i = 0, j = 0; \
+    while (i < na && j < nb) \
+      *out++ = LESS(b[j], a[i]) ? b[j++] : a[i++]; \
+    if (i < na) memcpy(out, a + i, (na - i) * sizeof(T)); \
+    if (j < nb) memcpy(out, b + j, (nb - j) * sizeof(T)); \
+  } \
+  static inline int NAME##_merge(dg_darray_t* pdst, const dg_darray_t* pa, const dg_darray_t* pb) { \
+    assert(pdst != pa && pdst != pb); \
+    assert(pdst->elemsize == sizeof(T) && pa->elemsize == sizeof(T) && pb->elemsize == sizeof(T)); \
+    size_t n = pa->size + pb->size; \
+    if (n && darray_reserve_exact(pdst, n) != DGERR_SUCCESS) \
+      return DGERR_OUT_OF_MEMORY; \
+    if (darray_resize(pdst, n) != DGERR_SUCCESS) \
+      return DGERR_OUT_OF_MEMORY; \
+    NAME##__merge_((T*)pdst->pdata, (const T*)pa->pdata, pa->size, (const T*)pb->pdata, pb->size); \
+    return DGERR_SUCCESS; \
+  } \
+  typedef struct NAME##__par_s { \
+    T* src; \
+    T* dst; \
+    size_t n, nparts, width; \
+  } NAME##__par_t; \
+  static void NAME##__par_sort_proc_(void* puserdata, size_t begin, size_t end) { \
+    NAME##__par_t* c = (NAME##__par_t*)puserdata; \
+    for (size_t p = begin; p < end; p++) { \
+      size_t lo = c->n * p / c->nparts, hi = c->n * (p + 1) / c->nparts; \
+      NAME##__sort_n_(c->src + lo, hi - lo); \
+    } \
+  } \
+  /* piece q of the merge of runs [lo, mid) and [mid, hi), split by output position */ \
+  static void NAME##__par_merge_proc_(void* puserdata, size_t begin, size_t end) { \
+    NAME##__par_t* c = (NAME##__par_t*)puserdata; \
+    for (size_t t = begin; t < end; t++) { \
+      size_t span = 2 * c->width, pair = t / span, q = t % span; \
+      size_t p0 = pair * span; \
+      size_t lo = c->n * p0 / c->nparts; \
+      size_t mid = c->n * (p0 + c->width < c->nparts ? p0 + c->width : c->nparts) / c->nparts; \
+      size_t hi = c->n * (p0 + span < c->nparts ? p0 + span : c->nparts) / c->nparts; \
+      const T* a = c->src + lo; \
+      const T* b = c->src + mid; \
+      size_t na = mid - lo, nb = hi - mid, nout = hi - lo, ends[2], idx[2]; \
+      ends[0] = nout * q / span; \
+      ends[1] = nout * (q + 1) / span; \
+      for (int e = 0; e < 2; e++) { \
+        size_t d = ends[e], l = d > nb ? d - nb : 0, h = d < na ? d : na; \
+        while (l < h) { \
+          size_t i = l + (h - l) / 2; \
+          if (LESS(b[d - i - 1], a[i])) h = i; else l = i + 1; \
+        } \
+        idx[e] = l; \
+      } \
+      NAME##__merge_(c->dst + lo + ends[0], a + idx[0], idx[1] - idx[0], \
+        b + (ends[0] - idx[0]), (ends[1] - idx[1]) - (ends[0] - idx[0])); \
+    } \
+  } \
+  static inline int NAME##_sort_par(dg_darray_t* pd, dg_threadpool_t* ptp) { \
+    NAME##__par_t c; \
+    size_t nthreads = ptp ? darray_get_size(&ptp->workers) + 1 : 1; \
+    assert(pd->elemsize == sizeof(T)); \
+    c.n = pd->size; \
+    c.nparts = 1; \
+    while (c.nparts < nthreads && c.n / (c.nparts * 2) >= DGDARRAY_SORT_MIN_PART) \
+      c.nparts *= 2; \
+    if (c.nparts == 1) { \
+      NAME##_sort(pd); \
+      return DGERR_SUCCESS; \
+    } \
+    T* tmp = (T*)malloc(pd->capacity * sizeof(T)); \
+    if (!tmp) \
+      return DGERR_OUT_OF_MEMORY; \
+    c.src = (T*)pd->pdata; \
+    c.dst = tmp; \
+    int st = tp_parallel_for(ptp, c.nparts, c.nparts, NAME##__par_sort_proc_, &c); \
+    for (c.width = 1; st == DGERR_SUCCESS && c.width < c.nparts; c.width *= 2) { \
+      st = tp_parallel_for(ptp, c.nparts, c.nparts, NAME##__par_merge_proc_, &c); \
+      if (st == DGERR_SUCCESS) { T* x = c.src; c.src = c.dst; c.dst = x; } \
+    } \
+    if (st != DGERR_SUCCESS) { \
+      /* the pool could not run a round: runs back into the array, finish here */ \
+      if ((uint8_t*)c.src != pd->pdata) memcpy(pd->pdata, c.src, c.n * sizeof(T)); \
+      free(tmp); \
+      NAME##_sort(pd); \
+      return DGERR_SUCCESS; \
+    } \
+    pd->pdata = (uint8_t*)c.src; \
+    free(c.dst); \
+    return DGERR_SUCCESS; \
+  }
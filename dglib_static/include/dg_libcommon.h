@@ -42,6 +42,8 @@ enum DGERR {
 #define DG_ALIGN_DOWN(x, a) (((x)/(a))*(a))
 #define DG_ALIGN_UP(x, a)   ((((x)+(a)-1)/(a))*(a))
 
+#define DG_CACHE_LINE_SIZE 64 /*< assumed L1 line size for padding hot shared fields */
+
 #define DG_ARRSIZE(x) (sizeof(x)/sizeof(x[0]))
 #define DG_CONST_STRLEN(name, str) enum { name=sizeof(str)-1 }
 
@@ -6,11 +6,19 @@
 // Design goals: high-throughput, low-overhead, cache-friendly.
 // - Open addressing, linear probing
 // - 8-bit control metadata per bucket (like SwissTable top-7)
-// - 64-bit hash stored per bucket to avoid re-hashing during probe
-// - Tombstones with periodic rehash; load factor target ~85%
+// - Probing over 16-byte control groups (SSE2, SWAR fallback elsewhere)
+// - 64-bit hash stored per bucket to avoid re-hashing during probe (optional, DG_MAP_STORE_HASH)
+// - One allocation per table; keys/values as parallel arrays or interleaved slots (DG_MAP_SLOTS)
+// - Tombstones with periodic rehash (or backward-shift erase, DG_MAP_BACKSHIFT); load factor target ~85%
 // - Power-of-two capacity for mask arithmetic
 // - Macro-based type generator: declare + define with custom HASH/EQ
 // - Iteration helpers and reserve/clear APIs
+// - Batched get/set: hash a window of keys, prefetch their buckets, then probe
+// - Optional incremental growth (NAME_set_rehash_budget): the old table is drained a few
+//   buckets per set/erase/get_ref or via NAME_rehash_step, lookups check both tables meanwhile
+// - Tables may borrow their memory (read-only snapshots, see dg_map_snapshot.h)
+// - *_hashed variants take a precomputed HASHFN value; DG_MAP_HETERO_IMPL adds lookups by
+//   another query type (e.g. dg_strview into a map of owned strings) without a temporary key
 //
 // Usage example (string->int):
 //   #define DG_MAP_IMPLEMENTATION
@@ -42,6 +50,40 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define DG_MAP_SSE2 1
+#  include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+// Keys hashed and prefetched ahead of probing by the *_batch functions
+#ifndef DG_MAP_BATCH_WIDTH
+#  define DG_MAP_BATCH_WIDTH 16
+#endif
+
+// Erase by backward shift instead of tombstones: later entries of the probe run are
+// pulled into the hole, so churn never accumulates TOMBs and never forces a full rehash.
+// Read where DG_MAP_IMPL expands, so it can differ between maps of one translation unit.
+#ifndef DG_MAP_BACKSHIFT
+#  define DG_MAP_BACKSHIFT 0
+#endif
+
+// Table layout, also read where DG_MAP_IMPL expands. Every table is one allocation:
+// ctrl bytes, then the hash array, then keys and values.
+// DG_MAP_SLOTS 1 stores {key, val} pairs side by side (NAME_slot) instead of two arrays,
+//   so a hit touches one entry line; m->keys/m->vals then point into the slot array and
+//   must be indexed through NAME_iter_key/NAME_iter_val.
+// DG_MAP_STORE_HASH 0 drops the 64-bit hash array (8 bytes per slot); probes compare the
+//   7-bit tag and then EQ, and growth/backward shift re-hash keys with HASHFN.
+#ifndef DG_MAP_SLOTS
+#  define DG_MAP_SLOTS 0
+#endif
+#ifndef DG_MAP_STORE_HASH
+#  define DG_MAP_STORE_HASH 1
+#endif
+
 #ifndef DG_MAP_MALLOC
 #  define DG_MAP_MALLOC(sz) malloc(sz)
 #endif
@@ -63,32 +105,193 @@ static inline uint64_t dg_splitmix64_(uint64_t x) {
 	return x ^ (x >> 31);
 }
 
-// Hash arbitrary bytes. Good general-purpose mixer; not crypto.
-static inline uint64_t dg_hash_bytes(const void* data, size_t len) {
+// --- Byte hash --------------------------------------------------------------
+// wyhash-style: 64x64->128 multiply-fold over 32-byte strides (two independent lanes),
+// keys up to 16 bytes are read with at most 4 overlapping loads and no loop.
+// Portable and deterministic across CPUs (safe for persisted tables); dg_hash.h in
+// dglib adds CRC32/AES-NI variants selected at runtime. Not crypto.
+#define DG__HS0 0xa0761d6478bd642full
+#define DG__HS1 0xe7037ed1a0b428dbull
+#define DG__HS2 0x8ebc6af09c88c6e3ull
+#define DG__HS3 0x589965cc75374cc3ull
+
+// full 128-bit product: *a = low half, *b = high half
+static inline void dg__mul128_(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+	__uint128_t r = (__uint128_t)*a * *b;
+	*a = (uint64_t)r; *b = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	*a = _umul128(*a, *b, b);
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+	uint64_t lo = *a * *b;
+	*b = __umulh(*a, *b); *a = lo;
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32), c = t < rl;
+	uint64_t lo = t + (rm1 << 32); c += lo < t;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c; *a = lo;
+#endif
+}
+static inline uint64_t dg__mum_(uint64_t a, uint64_t b) { dg__mul128_(&a, &b); return a ^ b; }
+static inline uint64_t dg__rd8_(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t dg__rd4_(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+// keys of 0..16 bytes folded into two words
+static inline void dg__hash_short_(const uint8_t* p, size_t len, uint64_t* pa, uint64_t* pb) {
+	if (len >= 4) {
+		size_t d = (len >> 3) << 2;
+		*pa = (dg__rd4_(p) << 32) | dg__rd4_(p + d);
+		*pb = (dg__rd4_(p + len - 4) << 32) | dg__rd4_(p + len - 4 - d);
+	}
+	else if (len > 0) {
+		*pa = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+		*pb = 0;
+	}
+	else *pa = *pb = 0;
+}
+
+static inline uint64_t dg__hash_final_(uint64_t a, uint64_t b, uint64_t seed, size_t len) {
+	a ^= DG__HS1; b ^= seed;
+	dg__mul128_(&a, &b);
+	return dg__mum_(a ^ DG__HS0 ^ (uint64_t)len, b ^ DG__HS1);
+}
+
+static inline uint64_t dg_hash_bytes_seed(const void* data, size_t len, uint64_t seed) {
 	const uint8_t* p = (const uint8_t*)data;
-	uint64_t h = 0xA0761D6478BD642Full ^ (uint64_t)len;
-	while (len >= 8) {
-		uint64_t k;
-		memcpy(&k, p, 8);
-		h = dg_splitmix64_(h ^ k);
-		p += 8; len -= 8;
+	uint64_t a, b;
+	seed ^= dg__mum_(seed ^ DG__HS0, DG__HS1);
+	if (len <= 16) {
+		dg__hash_short_(p, len, &a, &b);
+	}
+	else {
+		size_t i = len;
+		if (i > 32) {
+			uint64_t s1 = seed;
+			do {
+				seed = dg__mum_(dg__rd8_(p) ^ DG__HS1, dg__rd8_(p + 8) ^ seed);
+				s1 = dg__mum_(dg__rd8_(p + 16) ^ DG__HS2, dg__rd8_(p + 24) ^ s1);
+				p += 32; i -= 32;
+			} while (i > 32);
+			seed ^= s1;
+		}
+		while (i > 16) {
+			seed = dg__mum_(dg__rd8_(p) ^ DG__HS1, dg__rd8_(p + 8) ^ seed);
+			p += 16; i -= 16;
+		}
+		/* last 16 bytes of the key, may overlap the ones already consumed */
+		a = dg__rd8_(p + i - 16); b = dg__rd8_(p + i - 8);
 	}
-	uint64_t tail = 0;
-	for (size_t i = 0; i < len; ++i) tail |= (uint64_t)p[i] << (i * 8);
-	h = dg_splitmix64_(h ^ tail);
-	return h;
+	return dg__hash_final_(a, b, seed, len);
+}
+
+// Hash arbitrary bytes. Good general-purpose hash; not crypto.
+static inline uint64_t dg_hash_bytes(const void* data, size_t len) {
+	return dg_hash_bytes_seed(data, len, 0);
 }
 
 static inline uint64_t dg_hash_str(const char* s) {
 	return dg_hash_bytes(s, s ? strlen(s) : 0);
 }
 
+// Borrowed, not NUL-terminated string slice: the query type for heterogeneous lookups
+// (DG_MAP_HETERO_IMPL) into maps keyed by owned C strings. Hashes like dg_hash_str.
+typedef struct dg_strview { const char* ptr; size_t len; } dg_strview;
+
+static inline dg_strview dg_strview_make(const char* ptr, size_t len) {
+	dg_strview v;
+	v.ptr = ptr; v.len = len;
+	return v;
+}
+static inline uint64_t dg_hash_strview(dg_strview v) { return dg_hash_bytes(v.ptr, v.len); }
+// key equals the slice; never reads key past its terminator
+static inline int dg_str_eq_view(const char* key, dg_strview v) {
+	size_t i;
+	for (i = 0; i < v.len; ++i)
+		if (key[i] != v.ptr[i] || !key[i]) return 0;
+	return key[i] == '\0';
+}
+
 // --- Internals --------------------------------------------------------------
 #define DG__CTRL_EMPTY  ((uint8_t)0x80)
 #define DG__CTRL_TOMB   ((uint8_t)0xFE)
 
 static inline uint8_t dg__h2meta(uint64_t h) { return (uint8_t)((h >> 57) & 0x7F); }
 
+// --- Control groups ---------------------------------------------------------
+// The ctrl array holds cap + DG__GROUP_WIDTH bytes: the tail mirrors the first
+// DG__GROUP_WIDTH bytes so a group can be loaded at any position without wrapping.
+// Groups are probed at pos, pos+16, ... which visits slots in exactly the same
+// order as byte-wise linear probing, 16 control bytes per step.
+#define DG__GROUP_WIDTH 16
+
+typedef uint32_t dg__gmask_t; /* bit i set => byte i of the group matched */
+
+static inline unsigned dg__ctz32_(uint32_t x) {
+#if defined(_MSC_VER)
+	unsigned long r;
+	_BitScanForward(&r, (unsigned long)x);
+	return (unsigned)r;
+#else
+	return (unsigned)__builtin_ctz(x);
+#endif
+}
+
+#if defined(DG_MAP_SSE2)
+static inline dg__gmask_t dg__group_match_(const uint8_t* g, uint8_t meta) {
+	__m128i ctrl = _mm_loadu_si128((const __m128i*)g);
+	return (dg__gmask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)meta)));
+}
+// EMPTY and TOMB both have the top bit set, full slots never do
+static inline dg__gmask_t dg__group_free_(const uint8_t* g) {
+	return (dg__gmask_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)g));
+}
+#else
+#define DG__SWAR_LO7 0x7F7F7F7F7F7F7F7Full
+#define DG__SWAR_HI1 0x8080808080808080ull
+#define DG__SWAR_ONES 0x0101010101010101ull
+
+// gathers the top bit of every byte into an 8-bit mask
+static inline uint32_t dg__swar_pack_(uint64_t hibits) {
+	return (uint32_t)(((hibits >> 7) * 0x0102040810204080ull) >> 56);
+}
+// exact zero-byte detection (no false positives from borrows)
+static inline uint32_t dg__swar_zero_(uint64_t x) {
+	return dg__swar_pack_(~(((x & DG__SWAR_LO7) + DG__SWAR_LO7) | x | DG__SWAR_LO7));
+}
+static inline dg__gmask_t dg__group_match_(const uint8_t* g, uint8_t meta) {
+	uint64_t lo, hi, pat = DG__SWAR_ONES * meta;
+	memcpy(&lo, g, 8); memcpy(&hi, g + 8, 8);
+	return dg__swar_zero_(lo ^ pat) | (dg__swar_zero_(hi ^ pat) << 8);
+}
+static inline dg__gmask_t dg__group_free_(const uint8_t* g) {
+	uint64_t lo, hi;
+	memcpy(&lo, g, 8); memcpy(&hi, g + 8, 8);
+	return dg__swar_pack_(lo & DG__SWAR_HI1) | (dg__swar_pack_(hi & DG__SWAR_HI1) << 8);
+}
+#endif
+
+static inline dg__gmask_t dg__group_empty_(const uint8_t* g) {
+	return dg__group_match_(g, DG__CTRL_EMPTY);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define DG__PREFETCH(p) __builtin_prefetch((const void*)(p))
+#elif defined(DG_MAP_SSE2)
+#  define DG__PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#  define DG__PREFETCH(p) ((void)0)
+#endif
+
+static inline int dg__ctrl_is_full_(uint8_t c) { return !(c & 0x80); }
+
+static inline void dg__ctrl_set_(uint8_t* ctrl, size_t cap, size_t i, uint8_t c) {
+	ctrl[i] = c;
+	if (i < DG__GROUP_WIDTH) ctrl[cap + i] = c;
+}
+
+static inline size_t dg__align_line_(size_t x) { return (x + 63) & ~(size_t)63; }
+
 static inline size_t dg__next_pow2_(size_t x) {
 	if (x < 16) return 16;
 	x--; x |= x >> 1; x |= x >> 2; x |= x >> 4; x |= x >> 8; x |= x >> 16;
@@ -100,15 +303,29 @@ static inline size_t dg__next_pow2_(size_t x) {
 
 // --- Public API generator ---------------------------------------------------
 #define DG_MAP_DECL(NAME, K, V) \
+    typedef struct NAME##_slot { K key; V val; } NAME##_slot; \
     typedef struct NAME { \
-        size_t size; \
+        size_t size; /* live entries in both tables */ \
         size_t tombs; \
         size_t cap; \
         size_t mask; \
         uint8_t  *ctrl; \
-        uint64_t *hash; \
+        uint64_t *hash; /* NULL without DG_MAP_STORE_HASH */ \
         K *keys; \
         V *vals; \
+        size_t rehash_budget; /* 0: grow in one step, else old buckets migrated per op */ \
+        struct { \
+            size_t cap, mask; \
+            size_t size; /* entries not migrated yet */ \
+            size_t pos;  /* next bucket to migrate */ \
+            uint8_t  *ctrl; /* NULL when no migration is in progress */ \
+            uint64_t *hash; \
+            K *keys; \
+            V *vals; \
+        } old; \
+        /* borrowed table (mapped snapshot): read-only, released through pfn_release on destroy */ \
+        void *pborrow; \
+        void (*pfn_release)(void *pborrow); \
     } NAME; \
     int NAME##_init(NAME *m, size_t initial_capacity); \
     void NAME##_destroy(NAME *m); \
@@ -119,11 +336,25 @@ static inline size_t dg__next_pow2_(size_t x) {
     int NAME##_get(const NAME *m, const K *key, V *out_val); \
     V* NAME##_get_ref(NAME *m, const K *key); \
     int NAME##_erase(NAME *m, const K *key); \
+    /* precomputed hash: hash must be (uint64_t)HASHFN(*key) */ \
+    int NAME##_set_hashed(NAME *m, uint64_t hash, const K *key, const V *val, int *replaced); \
+    int NAME##_get_hashed(const NAME *m, uint64_t hash, const K *key, V *out_val); \
+    V* NAME##_get_ref_hashed(NAME *m, uint64_t hash, const K *key); \
+    int NAME##_erase_hashed(NAME *m, uint64_t hash, const K *key); \
+    int NAME##_compact(NAME *m); \
+    /* incremental growth: budget 0 restores stop-the-world rehash (finishing a pending one) */ \
+    void NAME##_set_rehash_budget(NAME *m, size_t budget); \
+    /* migrates up to budget old buckets; returns buckets left, 0 when no migration is pending */ \
+    size_t NAME##_rehash_step(NAME *m, size_t budget); \
+    /* batched ops: out_vals/out_found may be NULL; return number found / stored */ \
+    size_t NAME##_get_batch(const NAME *m, const K *keys, size_t n, V *out_vals, uint8_t *out_found); \
+    size_t NAME##_set_batch(NAME *m, const K *keys, const V *vals, size_t n); \
     /* iteration helpers */ \
     size_t NAME##_iter_begin(const NAME *m); \
     size_t NAME##_iter_next(const NAME *m, size_t it); \
     K* NAME##_iter_key(NAME *m, size_t it); \
-    V* NAME##_iter_val(NAME *m, size_t it);
+    V* NAME##_iter_val(NAME *m, size_t it); \
+    size_t NAME##_erase_at(NAME *m, size_t it);
 
 /*
 #define DG__MAP_DEFAULT_HOOKS(NAME) \
@@ -135,45 +366,63 @@ static inline size_t dg__next_pow2_(size_t x) {
 		#endif
 */
 
+// Slot indices handed out by the internals and iterators address the current
+// table in [0, cap) and the table being migrated in [cap, cap + old.cap).
 //TODO: K.D. removed DG__MAP_DEFAULT_HOOKS(NAME)
 #define DG_MAP_IMPL(NAME, K, V, HASHFN, EQFN) \
     static int NAME##__grow_(NAME *m, size_t min_cap); \
     static int NAME##__rehash_into_(NAME *m, size_t new_cap); \
+    /* element i of a keys/vals array, strided by the slot size in DG_MAP_SLOTS layout */ \
+    static inline K* NAME##__kp_(const K *keys, size_t i) { \
+        return (K*)((const char*)keys + i * (DG_MAP_SLOTS ? sizeof(NAME##_slot) : sizeof(K))); \
+    } \
+    static inline V* NAME##__vp_(const V *vals, size_t i) { \
+        return (V*)((const char*)vals + i * (DG_MAP_SLOTS ? sizeof(NAME##_slot) : sizeof(V))); \
+    } \
+    static inline uint64_t NAME##__hat_(const uint64_t *hash, const K *keys, size_t i) { \
+        return DG_MAP_STORE_HASH ? hash[i] : (uint64_t)HASHFN(*NAME##__kp_(keys, i)); \
+    } \
+    static void NAME##__free_table_(uint8_t *ctrl, K *keys, V *vals, size_t cap, int free_payload) { \
+        (void)keys; (void)vals; /* only read by user KEY_FREE/VAL_FREE */ \
+        if (!ctrl) return; \
+        if (free_payload) { \
+            for (size_t i = 0; i < cap; ++i) { \
+                if (dg__ctrl_is_full_(ctrl[i])) { \
+                    NAME##_KEY_FREE(NAME##__kp_(keys, i)); \
+                    NAME##_VAL_FREE(NAME##__vp_(vals, i)); \
+                } \
+            } \
+        } \
+        DG_MAP_FREE(ctrl); /* ctrl starts the table block */ \
+    } \
     int NAME##_init(NAME *m, size_t initial_capacity) { \
         if (!m) return 0; \
-        m->size = m->tombs = 0; \
-        m->cap = 0; m->mask = 0; \
-        m->ctrl = NULL; m->hash = NULL; m->keys = NULL; m->vals = NULL; \
+        memset(m, 0, sizeof(*m)); \
         if (initial_capacity && !NAME##_reserve(m, initial_capacity)) return 0;\
         return 1;\
     } \
     void NAME##_destroy(NAME *m) { \
         if (!m) return; \
-        if (m->ctrl) { \
-            for (size_t i = 0; i < m->cap; ++i) { \
-                uint8_t c = m->ctrl[i]; \
-                if (c != DG__CTRL_EMPTY && c != DG__CTRL_TOMB) { \
-                    NAME##_KEY_FREE(&m->keys[i]); \
-                    NAME##_VAL_FREE(&m->vals[i]); \
-                } \
-            } \
-            DG_MAP_FREE(m->ctrl); \
-            DG_MAP_FREE(m->hash); \
-            DG_MAP_FREE(m->keys); \
-            DG_MAP_FREE(m->vals); \
+        if (m->pborrow) { \
+            if (m->pfn_release) m->pfn_release(m->pborrow); \
+            memset(m, 0, sizeof(*m)); \
+            return; \
         } \
-        m->ctrl = NULL; m->hash = NULL; m->keys = NULL; m->vals = NULL; \
-        m->size = m->tombs = m->cap = m->mask = 0; \
+        NAME##__free_table_(m->ctrl, m->keys, m->vals, m->cap, 1); \
+        NAME##__free_table_(m->old.ctrl, m->old.keys, m->old.vals, m->old.cap, 1); \
+        memset(m, 0, sizeof(*m)); \
     } \
     void NAME##_clear(NAME *m) { \
-        if (!m || !m->ctrl) return; \
+        if (!m || !m->ctrl || m->pborrow) return; \
+        NAME##__free_table_(m->old.ctrl, m->old.keys, m->old.vals, m->old.cap, 1); \
+        memset(&m->old, 0, sizeof(m->old)); \
         for (size_t i = 0; i < m->cap; ++i) { \
-            if (m->ctrl[i] != DG__CTRL_EMPTY && m->ctrl[i] != DG__CTRL_TOMB) { \
-                NAME##_KEY_FREE(&m->keys[i]); \
-                NAME##_VAL_FREE(&m->vals[i]); \
+            if (dg__ctrl_is_full_(m->ctrl[i])) { \
+                NAME##_KEY_FREE(NAME##__kp_(m->keys, i)); \
+                NAME##_VAL_FREE(NAME##__vp_(m->vals, i)); \
             } \
-            m->ctrl[i] = DG__CTRL_EMPTY; \
         } \
+        memset(m->ctrl, DG__CTRL_EMPTY, m->cap + DG__GROUP_WIDTH); \
         m->size = 0; m->tombs = 0; \
     } \
     size_t NAME##_size(const NAME *m) { return m ? m->size : 0; } \
@@ -187,181 +436,391 @@ static inline size_t dg__next_pow2_(size_t x) {
         size_t new_cap = dg__next_pow2_(min_cap); \
         return NAME##__rehash_into_(m, new_cap); \
     } \
-    static int NAME##__rehash_into_(NAME *m, size_t new_cap) { \
-        uint8_t  *new_ctrl = (uint8_t*)DG_MAP_MALLOC(new_cap * sizeof(uint8_t)); \
-        uint64_t *new_hash = (uint64_t*)DG_MAP_MALLOC(new_cap * sizeof(uint64_t)); \
-        K *new_keys = (K*)DG_MAP_MALLOC(new_cap * sizeof(K)); \
-        V *new_vals = (V*)DG_MAP_MALLOC(new_cap * sizeof(V)); \
-        if (!new_ctrl || !new_hash || !new_keys || !new_vals) { \
-            DG_MAP_FREE(new_ctrl); DG_MAP_FREE(new_hash); DG_MAP_FREE(new_keys); DG_MAP_FREE(new_vals); \
-            return 0; \
-        } \
-        for (size_t i = 0; i < new_cap; ++i) new_ctrl[i] = DG__CTRL_EMPTY; \
-        size_t old_cap = m->cap; \
-        uint8_t  *old_ctrl = m->ctrl; \
-        uint64_t *old_hash = m->hash; \
-        K *old_keys = m->keys; \
-        V *old_vals = m->vals; \
+    /* places an entry known to be absent; the first EMPTY/TOMB on its probe path is the slot */ \
+    static inline void NAME##__place_(NAME *m, uint64_t h, const K *key, const V *val) { \
+        size_t pos = (size_t)h & m->mask; \
+        dg__gmask_t fm; \
+        while (!(fm = dg__group_free_(m->ctrl + pos))) pos = (pos + DG__GROUP_WIDTH) & m->mask; \
+        size_t idx = (pos + dg__ctz32_(fm)) & m->mask; \
+        if (m->ctrl[idx] == DG__CTRL_TOMB) m->tombs--; \
+        dg__ctrl_set_(m->ctrl, m->cap, idx, dg__h2meta(h)); \
+        if (DG_MAP_STORE_HASH) m->hash[idx] = h; \
+        *NAME##__kp_(m->keys, idx) = *key; \
+        *NAME##__vp_(m->vals, idx) = *val; \
+    } \
+    /* allocates a fresh table and turns the current one into the table being migrated */ \
+    static int NAME##__swap_table_(NAME *m, size_t new_cap) { \
+        /* one block: ctrl | hash | keys | vals, or ctrl | hash | slots; sections start on a cache line */ \
+        size_t off_hash = dg__align_line_(new_cap + DG__GROUP_WIDTH); \
+        size_t off_keys = off_hash + (DG_MAP_STORE_HASH ? dg__align_line_(new_cap * sizeof(uint64_t)) : 0); \
+        size_t off_vals = DG_MAP_SLOTS ? off_keys + offsetof(NAME##_slot, val) : off_keys + dg__align_line_(new_cap * sizeof(K)); \
+        size_t total = DG_MAP_SLOTS ? off_keys + new_cap * sizeof(NAME##_slot) : off_vals + new_cap * sizeof(V); \
+        uint8_t *new_ctrl = (uint8_t*)DG_MAP_MALLOC(total); \
+        if (!new_ctrl) return 0; \
+        uint64_t *new_hash = DG_MAP_STORE_HASH ? (uint64_t*)(new_ctrl + off_hash) : NULL; \
+        K *new_keys = (K*)(new_ctrl + off_keys); \
+        V *new_vals = (V*)(new_ctrl + off_vals); \
+        memset(new_ctrl, DG__CTRL_EMPTY, new_cap + DG__GROUP_WIDTH); \
+        m->old.cap = m->cap; m->old.mask = m->mask; \
+        m->old.size = m->size; m->old.pos = 0; \
+        m->old.ctrl = m->ctrl; m->old.hash = m->hash; m->old.keys = m->keys; m->old.vals = m->vals; \
         m->ctrl = new_ctrl; m->hash = new_hash; m->keys = new_keys; m->vals = new_vals; \
         m->cap = new_cap; m->mask = new_cap - 1; \
-        size_t old_size = m->size; \
-        m->size = 0; m->tombs = 0; \
-        if (old_ctrl) { \
-            for (size_t i = 0; i < old_cap; ++i) { \
-                uint8_t c = old_ctrl[i]; \
-                if (c != DG__CTRL_EMPTY && c != DG__CTRL_TOMB) { \
-                    /* reinsert */ \
-                    uint64_t h = old_hash[i]; \
-                    uint8_t meta = dg__h2meta(h); \
-                    size_t idx = (size_t)h & m->mask; \
-                    for (;;) { \
-                        uint8_t cc = m->ctrl[idx]; \
-                        if (cc == DG__CTRL_EMPTY) { \
-                            m->ctrl[idx] = meta; \
-                            m->hash[idx] = h; \
-                            m->keys[idx] = old_keys[i]; \
-                            m->vals[idx] = old_vals[i]; \
-                            m->size++; \
-                            break; \
-                        } \
-                        idx = (idx + 1) & m->mask; \
-                    } \
-                } \
+        m->tombs = 0; \
+        return 1; \
+    } \
+    size_t NAME##_rehash_step(NAME *m, size_t budget) { \
+        if (!m || !m->old.ctrl) return 0; \
+        size_t end = (m->old.cap - m->old.pos < budget) ? m->old.cap : m->old.pos + budget; \
+        for (size_t i = m->old.pos; i < end && m->old.size; ++i) { \
+            if (dg__ctrl_is_full_(m->old.ctrl[i])) { \
+                NAME##__place_(m, NAME##__hat_(m->old.hash, m->old.keys, i), NAME##__kp_(m->old.keys, i), NAME##__vp_(m->old.vals, i)); \
+                /* TOMB keeps probe chains of the not yet migrated entries intact */ \
+                dg__ctrl_set_(m->old.ctrl, m->old.cap, i, DG__CTRL_TOMB); \
+                m->old.size--; \
             } \
-            DG_MAP_FREE(old_ctrl); DG_MAP_FREE(old_hash); DG_MAP_FREE(old_keys); DG_MAP_FREE(old_vals); \
         } \
-        (void)old_size; \
+        m->old.pos = end; \
+        if (m->old.pos < m->old.cap && m->old.size) return m->old.cap - m->old.pos; \
+        NAME##__free_table_(m->old.ctrl, m->old.keys, m->old.vals, m->old.cap, 0); \
+        memset(&m->old, 0, sizeof(m->old)); \
+        return 0; \
+    } \
+    void NAME##_set_rehash_budget(NAME *m, size_t budget) { \
+        if (!m) return; \
+        m->rehash_budget = budget; \
+        if (!budget) NAME##_rehash_step(m, (size_t)-1); \
+    } \
+    static int NAME##__rehash_into_(NAME *m, size_t new_cap) { \
+        if (m->pborrow) return 0; \
+        NAME##_rehash_step(m, (size_t)-1); \
+        if (!NAME##__swap_table_(m, new_cap)) return 0; \
+        NAME##_rehash_step(m, (size_t)-1); \
         return 1; \
     } \
     static inline int NAME##__should_grow_(const NAME *m) { \
+        /* counts entries still in the old table too, so migration never overfills the new one */ \
         return (m->size + m->tombs) * 100 >= (m->cap * 85); \
     } \
-    int NAME##_set(NAME *m, const K *key, const V *val, int *replaced) { \
-        if (!m) return 0; \
+    /* probes one table; returns slot index of key or (size_t)-1 */ \
+    static inline size_t NAME##__probe_(const uint8_t *ctrl, const uint64_t *hash, const K *keys, size_t mask, uint64_t h, const K *key) { \
+        uint8_t meta = dg__h2meta(h); \
+        size_t pos = (size_t)h & mask; \
+        for (;;) { \
+            const uint8_t *g = ctrl + pos; \
+            for (dg__gmask_t mm = dg__group_match_(g, meta); mm; mm &= mm - 1) { \
+                size_t idx = (pos + dg__ctz32_(mm)) & mask; \
+                if ((!DG_MAP_STORE_HASH || hash[idx] == h) && EQFN(*NAME##__kp_(keys, idx), *key)) return idx; \
+            } \
+            if (dg__group_empty_(g)) return (size_t)-1; \
+            pos = (pos + DG__GROUP_WIDTH) & mask; \
+        } \
+    } \
+    /* returns slot index of key (see above) or (size_t)-1 */ \
+    static inline size_t NAME##__find_(const NAME *m, uint64_t h, const K *key) { \
+        size_t idx = NAME##__probe_(m->ctrl, m->hash, m->keys, m->mask, h, key); \
+        if (idx == (size_t)-1 && m->old.ctrl) { \
+            idx = NAME##__probe_(m->old.ctrl, m->old.hash, m->old.keys, m->old.mask, h, key); \
+            if (idx != (size_t)-1) idx += m->cap; \
+        } \
+        return idx; \
+    } \
+    static inline K* NAME##__key_at_(const NAME *m, size_t idx) { \
+        return (idx < m->cap) ? NAME##__kp_(m->keys, idx) : NAME##__kp_(m->old.keys, idx - m->cap); \
+    } \
+    static inline V* NAME##__val_at_(const NAME *m, size_t idx) { \
+        return (idx < m->cap) ? NAME##__vp_(m->vals, idx) : NAME##__vp_(m->old.vals, idx - m->cap); \
+    } \
+    static int NAME##__insert_(NAME *m, uint64_t h, const K *key, const V *val, int *replaced) { \
+        if (m->pborrow) return 0; \
+        if (m->old.ctrl) NAME##_rehash_step(m, m->rehash_budget); \
         if (m->cap == 0 || NAME##__should_grow_(m)) { \
             size_t newc = m->cap ? (m->cap << 1) : 16; \
-            if (!NAME##__grow_(m, newc)) return 0; \
+            if (m->rehash_budget && m->cap) { \
+                /* the new table outran the migration: finish it, then start the next one */ \
+                NAME##_rehash_step(m, (size_t)-1); \
+                if (!NAME##__swap_table_(m, newc)) return 0; \
+            } \
+            else if (!NAME##__grow_(m, newc)) return 0; \
+        } \
+        if (m->old.ctrl) { \
+            /* a key lives in exactly one table: update it where it is */ \
+            size_t oidx = NAME##__probe_(m->old.ctrl, m->old.hash, m->old.keys, m->old.mask, h, key); \
+            if (oidx != (size_t)-1) { \
+                NAME##_VAL_FREE(NAME##__vp_(m->old.vals, oidx)); \
+                *NAME##__vp_(m->old.vals, oidx) = *val; \
+                if (replaced) *replaced = 1; \
+                return 1; \
+            } \
         } \
-        uint64_t h = (uint64_t)HASHFN(*key); \
         uint8_t meta = dg__h2meta(h); \
-        size_t idx = (size_t)h & m->mask; \
-        size_t first_tomb = (size_t)-1; \
+        size_t pos = (size_t)h & m->mask; \
+        size_t slot = (size_t)-1; \
         for (;;) { \
-            uint8_t c = m->ctrl[idx]; \
-            if (c == DG__CTRL_EMPTY) { \
-                size_t t = (first_tomb != (size_t)-1) ? first_tomb : idx; \
-                m->ctrl[t] = meta; \
-                m->hash[t] = h; \
-                m->keys[t] = *key; \
-                m->vals[t] = *val; \
-                m->size++; \
-                if (t == first_tomb) m->tombs--; \
-                if (replaced) *replaced = 0; \
-                return 1; \
-            } else if (c == DG__CTRL_TOMB) { \
-                if (first_tomb == (size_t)-1) first_tomb = idx; \
-            } else if (c == meta) { \
-                if (m->hash[idx] == h && EQFN(m->keys[idx], *key)) { \
-                    NAME##_VAL_FREE(&m->vals[idx]); \
-                    m->vals[idx] = *val; \
+            const uint8_t *g = m->ctrl + pos; \
+            for (dg__gmask_t mm = dg__group_match_(g, meta); mm; mm &= mm - 1) { \
+                size_t idx = (pos + dg__ctz32_(mm)) & m->mask; \
+                if ((!DG_MAP_STORE_HASH || m->hash[idx] == h) && EQFN(*NAME##__kp_(m->keys, idx), *key)) { \
+                    NAME##_VAL_FREE(NAME##__vp_(m->vals, idx)); \
+                    *NAME##__vp_(m->vals, idx) = *val; \
                     if (replaced) *replaced = 1; \
                     return 1; \
                 } \
             } \
-            idx = (idx + 1) & m->mask; \
+            /* remember first EMPTY/TOMB on the probe path, keep looking for the key */ \
+            if (slot == (size_t)-1) { \
+                dg__gmask_t fm = dg__group_free_(g); \
+                if (fm) slot = (pos + dg__ctz32_(fm)) & m->mask; \
+            } \
+            if (dg__group_empty_(g)) break; \
+            pos = (pos + DG__GROUP_WIDTH) & m->mask; \
         } \
+        if (m->ctrl[slot] == DG__CTRL_TOMB) m->tombs--; \
+        dg__ctrl_set_(m->ctrl, m->cap, slot, meta); \
+        if (DG_MAP_STORE_HASH) m->hash[slot] = h; \
+        *NAME##__kp_(m->keys, slot) = *key; \
+        *NAME##__vp_(m->vals, slot) = *val; \
+        m->size++; \
+        if (replaced) *replaced = 0; \
+        return 1; \
     } \
-    int NAME##_get(const NAME *m, const K *key, V *out_val) { \
-        if (!m || m->cap == 0) return 0; \
-        uint64_t h = (uint64_t)HASHFN(*key); \
-        uint8_t meta = dg__h2meta(h); \
+    int NAME##_set(NAME *m, const K *key, const V *val, int *replaced) { \
+        if (!m) return 0; \
+        return NAME##__insert_(m, (uint64_t)HASHFN(*key), key, val, replaced); \
+    } \
+    int NAME##_set_hashed(NAME *m, uint64_t hash, const K *key, const V *val, int *replaced) { \
+        if (!m) return 0; \
+        return NAME##__insert_(m, hash, key, val, replaced); \
+    } \
+    static inline void NAME##__prefetch_(const NAME *m, uint64_t h, int with_vals) { \
         size_t idx = (size_t)h & m->mask; \
-        for (;;) { \
-            uint8_t c = m->ctrl[idx]; \
-            if (c == DG__CTRL_EMPTY) return 0; \
-            if (c == meta && m->hash[idx] == h && EQFN(m->keys[idx], *key)) { \
-                if (out_val) *out_val = m->vals[idx]; \
-                return 1; \
+        DG__PREFETCH(m->ctrl + idx); \
+        if (DG_MAP_STORE_HASH) DG__PREFETCH(m->hash + idx); \
+        DG__PREFETCH(NAME##__kp_(m->keys, idx)); \
+        if (with_vals && !DG_MAP_SLOTS) DG__PREFETCH(NAME##__vp_(m->vals, idx)); \
+    } \
+    size_t NAME##_get_batch(const NAME *m, const K *keys, size_t n, V *out_vals, uint8_t *out_found) { \
+        uint64_t hs[DG_MAP_BATCH_WIDTH]; \
+        size_t nfound = 0; \
+        if (!m || m->cap == 0) { \
+            if (out_found) memset(out_found, 0, n); \
+            return 0; \
+        } \
+        for (size_t base = 0; base < n; base += DG_MAP_BATCH_WIDTH) { \
+            size_t cnt = (n - base < DG_MAP_BATCH_WIDTH) ? n - base : DG_MAP_BATCH_WIDTH; \
+            /* pass 1: hash the window and start the bucket loads */ \
+            for (size_t j = 0; j < cnt; ++j) { \
+                hs[j] = (uint64_t)HASHFN(keys[base + j]); \
+                NAME##__prefetch_(m, hs[j], out_vals != NULL); \
+            } \
+            /* pass 2: resolve probes, lines are in flight or already cached */ \
+            for (size_t j = 0; j < cnt; ++j) { \
+                size_t idx = NAME##__find_(m, hs[j], &keys[base + j]); \
+                int hit = (idx != (size_t)-1); \
+                if (hit) { \
+                    if (out_vals) out_vals[base + j] = *NAME##__val_at_(m, idx); \
+                    nfound++; \
+                } \
+                if (out_found) out_found[base + j] = (uint8_t)hit; \
             } \
-            idx = (idx + 1) & m->mask; \
         } \
+        return nfound; \
     } \
-    V* NAME##_get_ref(NAME *m, const K *key) { \
-        if (!m || m->cap == 0) return NULL; \
-        uint64_t h = (uint64_t)HASHFN(*key); \
-        uint8_t meta = dg__h2meta(h); \
-        size_t idx = (size_t)h & m->mask; \
-        for (;;) { \
-            uint8_t c = m->ctrl[idx]; \
-            if (c == DG__CTRL_EMPTY) return NULL; \
-            if (c == meta && m->hash[idx] == h && EQFN(m->keys[idx], *key)) { \
-                return &m->vals[idx]; \
+    size_t NAME##_set_batch(NAME *m, const K *keys, const V *vals, size_t n) { \
+        uint64_t hs[DG_MAP_BATCH_WIDTH]; \
+        if (!m) return 0; \
+        /* size once up front; duplicates only make this an over-estimate. \
+           Incremental maps grow as they go instead of stalling here. */ \
+        if (!m->rehash_budget && !NAME##_reserve(m, m->size + n)) return 0; \
+        for (size_t base = 0; base < n; base += DG_MAP_BATCH_WIDTH) { \
+            size_t cnt = (n - base < DG_MAP_BATCH_WIDTH) ? n - base : DG_MAP_BATCH_WIDTH; \
+            for (size_t j = 0; j < cnt; ++j) { \
+                hs[j] = (uint64_t)HASHFN(keys[base + j]); \
+                if (m->cap) NAME##__prefetch_(m, hs[j], 1); \
+            } \
+            for (size_t j = 0; j < cnt; ++j) { \
+                if (!NAME##__insert_(m, hs[j], &keys[base + j], &vals[base + j], NULL)) return base + j; \
             } \
-            idx = (idx + 1) & m->mask; \
         } \
+        return n; \
     } \
-    int NAME##_erase(NAME *m, const K *key) { \
+    int NAME##_get_hashed(const NAME *m, uint64_t hash, const K *key, V *out_val) { \
         if (!m || m->cap == 0) return 0; \
-        uint64_t h = (uint64_t)HASHFN(*key); \
-        uint8_t meta = dg__h2meta(h); \
-        size_t idx = (size_t)h & m->mask; \
+        size_t idx = NAME##__find_(m, hash, key); \
+        if (idx == (size_t)-1) return 0; \
+        if (out_val) *out_val = *NAME##__val_at_(m, idx); \
+        return 1; \
+    } \
+    int NAME##_get(const NAME *m, const K *key, V *out_val) { \
+        if (!m || m->cap == 0) return 0; \
+        return NAME##_get_hashed(m, (uint64_t)HASHFN(*key), key, out_val); \
+    } \
+    V* NAME##_get_ref_hashed(NAME *m, uint64_t hash, const K *key) { \
+        if (!m || m->cap == 0) return NULL; \
+        if (m->old.ctrl) NAME##_rehash_step(m, m->rehash_budget); \
+        size_t idx = NAME##__find_(m, hash, key); \
+        return (idx == (size_t)-1) ? NULL : NAME##__val_at_(m, idx); \
+    } \
+    V* NAME##_get_ref(NAME *m, const K *key) { \
+        if (!m || m->cap == 0) return NULL; \
+        return NAME##_get_ref_hashed(m, (uint64_t)HASHFN(*key), key); \
+    } \
+    /* frees the payload and marks the slot TOMB, no rehash */ \
+    static void NAME##__kill_(NAME *m, size_t idx) { \
+        NAME##_KEY_FREE(NAME##__key_at_(m, idx)); \
+        NAME##_VAL_FREE(NAME##__val_at_(m, idx)); \
+        if (idx < m->cap) { \
+            dg__ctrl_set_(m->ctrl, m->cap, idx, DG__CTRL_TOMB); \
+            m->tombs++; \
+        } \
+        else { \
+            dg__ctrl_set_(m->old.ctrl, m->old.cap, idx - m->cap, DG__CTRL_TOMB); \
+            m->old.size--; \
+        } \
+        m->size--; \
+    } \
+    /* empties slot hole of the current table by moving later run members back into it */ \
+    static void NAME##__backshift_(NAME *m, size_t hole) { \
+        size_t j = hole; \
         for (;;) { \
-            uint8_t c = m->ctrl[idx]; \
-            if (c == DG__CTRL_EMPTY) return 0; \
-            if (c == meta && m->hash[idx] == h && EQFN(m->keys[idx], *key)) { \
-                NAME##_KEY_FREE(&m->keys[idx]); \
-                NAME##_VAL_FREE(&m->vals[idx]); \
-                m->ctrl[idx] = DG__CTRL_TOMB; \
-                m->size--; m->tombs++; \
-                /* Opportunistic rehash if too many tombstones */ \
-                if (m->tombs * 2 > m->cap) NAME##__rehash_into_(m, m->cap); \
-                return 1; \
+            j = (j + 1) & m->mask; \
+            uint8_t c = m->ctrl[j]; \
+            if (c == DG__CTRL_EMPTY) break; \
+            if (c == DG__CTRL_TOMB) { \
+                /* run holds a TOMB left by erase_at: the hole has to stay non-empty as well */ \
+                dg__ctrl_set_(m->ctrl, m->cap, hole, DG__CTRL_TOMB); \
+                m->tombs++; \
+                return; \
+            } \
+            size_t home = (size_t)NAME##__hat_(m->hash, m->keys, j) & m->mask; \
+            /* movable unless its home lies cyclically in (hole, j] */ \
+            if (((j - home) & m->mask) >= ((j - hole) & m->mask)) { \
+                dg__ctrl_set_(m->ctrl, m->cap, hole, c); \
+                if (DG_MAP_STORE_HASH) m->hash[hole] = m->hash[j]; \
+                *NAME##__kp_(m->keys, hole) = *NAME##__kp_(m->keys, j); \
+                *NAME##__vp_(m->vals, hole) = *NAME##__vp_(m->vals, j); \
+                hole = j; \
             } \
-            idx = (idx + 1) & m->mask; \
         } \
+        dg__ctrl_set_(m->ctrl, m->cap, hole, DG__CTRL_EMPTY); \
     } \
-    size_t NAME##_iter_begin(const NAME *m) { \
-        if (!m || m->cap == 0) return (size_t)-1; \
-        for (size_t i = 0; i < m->cap; ++i) { \
-            uint8_t c = m->ctrl[i]; \
-            if (c != DG__CTRL_EMPTY && c != DG__CTRL_TOMB) return i; \
+    static void NAME##__remove_(NAME *m, size_t idx) { \
+        if (DG_MAP_BACKSHIFT && idx < m->cap) { \
+            NAME##_KEY_FREE(NAME##__kp_(m->keys, idx)); \
+            NAME##_VAL_FREE(NAME##__vp_(m->vals, idx)); \
+            m->size--; \
+            NAME##__backshift_(m, idx); \
         } \
-        return (size_t)-1; \
+        else NAME##__kill_(m, idx); \
+        /* Opportunistic rehash if too many tombstones */ \
+        if (!m->old.ctrl && m->tombs * 2 > m->cap) NAME##__rehash_into_(m, m->cap); \
+    } \
+    int NAME##_erase_hashed(NAME *m, uint64_t hash, const K *key) { \
+        if (!m || m->cap == 0 || m->pborrow) return 0; \
+        if (m->old.ctrl) NAME##_rehash_step(m, m->rehash_budget); \
+        size_t idx = NAME##__find_(m, hash, key); \
+        if (idx == (size_t)-1) return 0; \
+        NAME##__remove_(m, idx); \
+        return 1; \
+    } \
+    int NAME##_erase(NAME *m, const K *key) { \
+        if (!m || m->cap == 0 || m->pborrow) return 0; \
+        return NAME##_erase_hashed(m, (uint64_t)HASHFN(*key), key); \
+    } \
+    static inline int NAME##__is_full_at_(const NAME *m, size_t i) { \
+        return dg__ctrl_is_full_(i < m->cap ? m->ctrl[i] : m->old.ctrl[i - m->cap]); \
     } \
     size_t NAME##_iter_next(const NAME *m, size_t it) { \
         if (!m || m->cap == 0 || it == (size_t)-1) return (size_t)-1; \
-        for (size_t i = it + 1; i < m->cap; ++i) { \
-            uint8_t c = m->ctrl[i]; \
-            if (c != DG__CTRL_EMPTY && c != DG__CTRL_TOMB) return i; \
+        size_t end = m->cap + m->old.cap; \
+        for (size_t i = it + 1; i < end; ++i) { \
+            if (NAME##__is_full_at_(m, i)) return i; \
         } \
         return (size_t)-1; \
     } \
+    size_t NAME##_iter_begin(const NAME *m) { \
+        if (!m || m->cap == 0) return (size_t)-1; \
+        if (dg__ctrl_is_full_(m->ctrl[0])) return 0; \
+        return NAME##_iter_next(m, 0); \
+    } \
     K* NAME##_iter_key(NAME *m, size_t it) { \
         if (!m || it == (size_t)-1) return NULL; \
-        return &m->keys[it]; \
+        return NAME##__key_at_(m, it); \
     } \
     V* NAME##_iter_val(NAME *m, size_t it) { \
         if (!m || it == (size_t)-1) return NULL; \
-        return &m->vals[it]; \
+        return NAME##__val_at_(m, it); \
     }\
     size_t NAME##_erase_at(NAME *m, size_t it) { \
-      if (!m || it == (size_t)-1 || it >= m->cap) return (size_t)-1; \
-      uint8_t c = m->ctrl[it]; \
-      if (c == DG__CTRL_EMPTY || c == DG__CTRL_TOMB) { \
+      if (!m || it == (size_t)-1 || it >= m->cap + m->old.cap || m->pborrow) return (size_t)-1; \
+      if (!NAME##__is_full_at_(m, it)) { \
       return NAME##_iter_next(m, it); \
       } \
-      KEYFREE(&m->keys[it]); \
-      VALFREE(&m->vals[it]); \
-      m->ctrl[it] = DG__CTRL_TOMB; \
-      m->size--; \
-      m->tombs++; \
-      /* Intentionally DO NOT rehash here to keep iteration stable. */ \
+      NAME##__kill_(m, it); \
+      /* Intentionally DO NOT rehash, migrate or backward-shift here to keep iteration stable. */ \
       return NAME##_iter_next(m, it); \
     } \
     int NAME##_compact(NAME *m) { \
     if (!m) return 0; \
-    if (m->tombs == 0) return 1; \
+    if (m->tombs == 0 && !m->old.ctrl) return 1; \
     return NAME##__rehash_into_(m, m->cap); \
     }
 
+/**
+* @brief generates lookups by a query type Q for a map made by DG_MAP_DECL/DG_MAP_IMPL
+*
+* Expand after DG_MAP_IMPL. QHASHFN(q) must equal HASHFN(k), and QEQFN(k, q) must hold,
+* for every stored key k equal to q. Example, C string keys owned by the map:
+*   DG_MAP_HETERO_IMPL(strmap, const char*, int, view, dg_strview, dg_hash_strview, dg_str_eq_view)
+*
+* int NAME_get_SUFFIX(const NAME *m, Q q, V *out_val)
+* V*  NAME_get_ref_SUFFIX(NAME *m, Q q)
+* int NAME_erase_SUFFIX(NAME *m, Q q)
+*   the same as NAME_get/NAME_get_ref/NAME_erase
+*/
+#define DG_MAP_HETERO_IMPL(NAME, K, V, SUFFIX, Q, QHASHFN, QEQFN) \
+    static inline size_t NAME##__probe_##SUFFIX##_(const uint8_t *ctrl, const uint64_t *hash, const K *keys, size_t mask, uint64_t h, Q q) { \
+        uint8_t meta = dg__h2meta(h); \
+        size_t pos = (size_t)h & mask; \
+        for (;;) { \
+            const uint8_t *g = ctrl + pos; \
+            for (dg__gmask_t mm = dg__group_match_(g, meta); mm; mm &= mm - 1) { \
+                size_t idx = (pos + dg__ctz32_(mm)) & mask; \
+                if ((!DG_MAP_STORE_HASH || hash[idx] == h) && QEQFN(*NAME##__kp_(keys, idx), q)) return idx; \
+            } \
+            if (dg__group_empty_(g)) return (size_t)-1; \
+            pos = (pos + DG__GROUP_WIDTH) & mask; \
+        } \
+    } \
+    static inline size_t NAME##__find_##SUFFIX##_(const NAME *m, Q q) { \
+        uint64_t h = (uint64_t)QHASHFN(q); \
+        size_t idx = NAME##__probe_##SUFFIX##_(m->ctrl, m->hash, m->keys, m->mask, h, q); \
+        if (idx == (size_t)-1 && m->old.ctrl) { \
+            idx = NAME##__probe_##SUFFIX##_(m->old.ctrl, m->old.hash, m->old.keys, m->old.mask, h, q); \
+            if (idx != (size_t)-1) idx += m->cap; \
+        } \
+        return idx; \
+    } \
+    int NAME##_get_##SUFFIX(const NAME *m, Q q, V *out_val) { \
+        if (!m || m->cap == 0) return 0; \
+        size_t idx = NAME##__find_##SUFFIX##_(m, q); \
+        if (idx == (size_t)-1) return 0; \
+        if (out_val) *out_val = *NAME##__val_at_(m, idx); \
+        return 1; \
+    } \
+    V* NAME##_get_ref_##SUFFIX(NAME *m, Q q) { \
+        if (!m || m->cap == 0) return NULL; \
+        if (m->old.ctrl) NAME##_rehash_step(m, m->rehash_budget); \
+        size_t idx = NAME##__find_##SUFFIX##_(m, q); \
+        return (idx == (size_t)-1) ? NULL : NAME##__val_at_(m, idx); \
+    } \
+    int NAME##_erase_##SUFFIX(NAME *m, Q q) { \
+        if (!m || m->cap == 0 || m->pborrow) return 0; \
+        if (m->old.ctrl) NAME##_rehash_step(m, m->rehash_budget); \
+        size_t idx = NAME##__find_##SUFFIX##_(m, q); \
+        if (idx == (size_t)-1) return 0; \
+        NAME##__remove_(m, idx); \
+        return 1; \
+    }
+
 #endif /* DG_MAP_H */
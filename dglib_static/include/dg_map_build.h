@@ -0,0 +1,197 @@
+// dg_map_build.h - bulk construction of dg_map.h tables on a dg_threadpool_t
+// Public Domain / Unlicense. Header-only, expand DG_MAP_BUILD_IMPL after DG_MAP_IMPL.
+//
+// NAME_build_from loads n key/value pairs at once instead of n NAME_set calls:
+//   1. the table is sized once with NAME_reserve(n), no grow checks while loading;
+//   2. all keys are hashed in parallel and bucketed by the top bits of their home
+//      bucket, so partition p owns buckets [p * cap / P, (p + 1) * cap / P);
+//   3. every partition is filled by one task; an entry whose probe would leave its
+//      partition is deferred, and the few deferred entries are inserted serially
+//      at the end, when probes may cross partitions again.
+// Workers never write the same ctrl byte or slot, so no locks or atomics are needed.
+// Input order is kept within a partition: a duplicated key keeps its last value,
+// exactly like a sequence of NAME_set calls.
+//
+// Usage example (u64 -> u64):
+//   DG_MAP_DECL(u64map, uint64_t, uint64_t)
+//   DG_MAP_IMPL(u64map, uint64_t, uint64_t, u64_hash, u64_eq)
+//   DG_MAP_BUILD_IMPL(u64map, uint64_t, uint64_t, u64_hash, u64_eq)
+//
+//   u64map m; u64map_init(&m, 0);
+//   u64map_build_from(&m, keys, vals, n, 8);             /* temporary pool of 8 threads */
+//   u64map_build_from_tp(&m, keys, vals, n, &pool, 8);   /* or an existing pool */
+//
+// Notes:
+// - The partitioned path needs an empty map (fresh or cleared), otherwise the pairs
+//   are inserted with NAME_set_batch. With ptp == NULL it runs on the calling thread.
+// - Scratch memory: 16 bytes per input pair (hashes and partition order).
+
+#ifndef DG_MAP_BUILD_H
+#define DG_MAP_BUILD_H
+
+#include "dg_map.h"
+#include "dg_threadpool.h"
+
+#define DG_MAP_BUILD_MIN_PART    1024 /*< buckets per partition, at least */
+#define DG_MAP_BUILD_MIN_CHUNK   4096 /*< input pairs per hashing task, at least */
+#define DG_MAP_BUILD_PARTS_PER_THREAD 8
+
+/**
+* @brief generates bulk construction functions for a map made by DG_MAP_DECL/DG_MAP_IMPL
+*
+* int NAME_build_from(NAME *m, const K *keys, const V *vals, size_t n, size_t nthreads)
+*   inserts n pairs using a temporary pool of nthreads workers
+*   @return 1 - success, 0 - out of memory (pairs inserted so far stay in the map)
+*
+* int NAME_build_from_tp(NAME *m, const K *keys, const V *vals, size_t n, dg_threadpool_t *ptp, size_t nthreads)
+*   the same on an existing pool (or the calling thread if ptp is NULL); nthreads sets the task granularity
+*/
+#define DG_MAP_BUILD_IMPL(NAME, K, V, HASHFN, EQFN) \
+    typedef struct NAME##__build_ctx { \
+        NAME     *m; \
+        const K  *keys; \
+        const V  *vals; \
+        size_t    n; \
+        uint64_t *hs;       /* hash of every input pair */ \
+        size_t   *order;    /* input indices grouped by partition, input order within one */ \
+        size_t   *offs;     /* nchunks x nparts counters, then write offsets */ \
+        size_t   *pbase;    /* nparts + 1 partition starts in order */ \
+        size_t   *placed;   /* new entries per partition */ \
+        size_t   *ndefer;   /* deferred entries per partition, kept at the front of its order range */ \
+        size_t    nchunks; \
+        size_t    nparts; \
+        unsigned  part_shift; \
+    } NAME##__build_ctx; \
+    static inline size_t NAME##__build_part_(const NAME##__build_ctx *c, uint64_t h) { \
+        return ((size_t)h & c->m->mask) >> c->part_shift; \
+    } \
+    static void NAME##__build_hash_proc_(void *pud, size_t cbegin, size_t cend) { \
+        NAME##__build_ctx *c = (NAME##__build_ctx*)pud; \
+        for (size_t ch = cbegin; ch < cend; ++ch) { \
+            size_t *cnt = c->offs + ch * c->nparts; \
+            size_t end = c->n * (ch + 1) / c->nchunks; \
+            for (size_t i = c->n * ch / c->nchunks; i < end; ++i) { \
+                uint64_t h = (uint64_t)HASHFN(c->keys[i]); \
+                c->hs[i] = h; \
+                cnt[NAME##__build_part_(c, h)]++; \
+            } \
+        } \
+    } \
+    static void NAME##__build_scatter_proc_(void *pud, size_t cbegin, size_t cend) { \
+        NAME##__build_ctx *c = (NAME##__build_ctx*)pud; \
+        for (size_t ch = cbegin; ch < cend; ++ch) { \
+            size_t *off = c->offs + ch * c->nparts; \
+            size_t end = c->n * (ch + 1) / c->nchunks; \
+            for (size_t i = c->n * ch / c->nchunks; i < end; ++i) \
+                c->order[off[NAME##__build_part_(c, c->hs[i])]++] = i; \
+        } \
+    } \
+    /* linear probing confined to the partition; ctrl mirror bytes are fixed up afterwards */ \
+    static void NAME##__build_place_proc_(void *pud, size_t pbegin, size_t pend) { \
+        NAME##__build_ctx *c = (NAME##__build_ctx*)pud; \
+        NAME *m = c->m; \
+        for (size_t p = pbegin; p < pend; ++p) { \
+            size_t hi = (p + 1) << c->part_shift; \
+            size_t placed = 0, ndefer = 0; \
+            for (size_t k = c->pbase[p]; k < c->pbase[p + 1]; ++k) { \
+                size_t i = c->order[k]; \
+                uint64_t h = c->hs[i]; \
+                uint8_t meta = dg__h2meta(h); \
+                for (size_t b = (size_t)h & m->mask;; ++b) { \
+                    if (b == hi) { \
+                        c->order[c->pbase[p] + ndefer++] = i; \
+                        break; \
+                    } \
+                    uint8_t cb = m->ctrl[b]; \
+                    if (cb == DG__CTRL_EMPTY) { \
+                        m->ctrl[b] = meta; \
+                        if (DG_MAP_STORE_HASH) m->hash[b] = h; \
+                        *NAME##__kp_(m->keys, b) = c->keys[i]; \
+                        *NAME##__vp_(m->vals, b) = c->vals[i]; \
+                        placed++; \
+                        break; \
+                    } \
+                    if (cb == meta && (!DG_MAP_STORE_HASH || m->hash[b] == h) && EQFN(*NAME##__kp_(m->keys, b), c->keys[i])) { \
+                        NAME##_VAL_FREE(NAME##__vp_(m->vals, b)); \
+                        *NAME##__vp_(m->vals, b) = c->vals[i]; \
+                        break; \
+                    } \
+                } \
+            } \
+            c->placed[p] = placed; \
+            c->ndefer[p] = ndefer; \
+        } \
+    } \
+    /* without a pool the phases run on the calling thread, partitioning still pays off in locality */ \
+    static int NAME##__build_run_(dg_threadpool_t *ptp, size_t count, dg_tp_range_proc proc, NAME##__build_ctx *c) { \
+        if (ptp) return tp_parallel_for(ptp, count, count, proc, c) == DGERR_SUCCESS; \
+        proc(c, 0, count); \
+        return 1; \
+    } \
+    int NAME##_build_from_tp(NAME *m, const K *keys, const V *vals, size_t n, dg_threadpool_t *ptp, size_t nthreads) { \
+        NAME##__build_ctx c; \
+        if (!m) return 0; \
+        if (!n) return 1; \
+        if (m->pborrow) return 0; \
+        if (!NAME##_reserve(m, m->size + n)) return 0; \
+        if (m->size || m->old.ctrl) return NAME##_set_batch(m, keys, vals, n) == n; \
+        if (nthreads < 1) nthreads = 1; \
+        if (m->tombs) NAME##_clear(m); \
+        memset(&c, 0, sizeof(c)); \
+        c.m = m; c.keys = keys; c.vals = vals; c.n = n; \
+        c.nparts = dg__next_pow2_(nthreads * DG_MAP_BUILD_PARTS_PER_THREAD); \
+        while (c.nparts > 1 && m->cap / c.nparts < DG_MAP_BUILD_MIN_PART) c.nparts >>= 1; \
+        while (((size_t)1 << c.part_shift) * c.nparts < m->cap) c.part_shift++; \
+        c.nchunks = n / DG_MAP_BUILD_MIN_CHUNK + 1; \
+        if (c.nchunks > nthreads * 4) c.nchunks = nthreads * 4; \
+        c.hs = (uint64_t*)DG_MAP_MALLOC(n * sizeof(uint64_t)); \
+        c.order = (size_t*)DG_MAP_MALLOC(n * sizeof(size_t)); \
+        c.offs = (size_t*)DG_MAP_MALLOC((c.nchunks * c.nparts + 3 * c.nparts + 1) * sizeof(size_t)); \
+        int ok = c.hs && c.order && c.offs; \
+        if (ok) { \
+            c.pbase = c.offs + c.nchunks * c.nparts; \
+            c.placed = c.pbase + c.nparts + 1; \
+            c.ndefer = c.placed + c.nparts; \
+            memset(c.offs, 0, c.nchunks * c.nparts * sizeof(size_t)); \
+            ok = NAME##__build_run_(ptp, c.nchunks, NAME##__build_hash_proc_, &c); \
+        } \
+        if (ok) { \
+            /* partition-major prefix sums: chunk counters become write offsets */ \
+            size_t off = 0; \
+            for (size_t p = 0; p < c.nparts; ++p) { \
+                c.pbase[p] = off; \
+                for (size_t ch = 0; ch < c.nchunks; ++ch) { \
+                    size_t cnt = c.offs[ch * c.nparts + p]; \
+                    c.offs[ch * c.nparts + p] = off; \
+                    off += cnt; \
+                } \
+            } \
+            c.pbase[c.nparts] = off; \
+            ok = NAME##__build_run_(ptp, c.nchunks, NAME##__build_scatter_proc_, &c) && \
+                NAME##__build_run_(ptp, c.nparts, NAME##__build_place_proc_, &c); \
+        } \
+        if (ok) { \
+            memcpy(m->ctrl + m->cap, m->ctrl, DG__GROUP_WIDTH); \
+            for (size_t p = 0; p < c.nparts; ++p) m->size += c.placed[p]; \
+            for (size_t p = 0; p < c.nparts && ok; ++p) { \
+                for (size_t k = c.pbase[p]; k < c.pbase[p] + c.ndefer[p] && ok; ++k) { \
+                    size_t i = c.order[k]; \
+                    ok = NAME##__insert_(m, c.hs[i], &keys[i], &vals[i], NULL); \
+                } \
+            } \
+        } \
+        DG_MAP_FREE(c.offs); \
+        DG_MAP_FREE(c.order); \
+        DG_MAP_FREE(c.hs); \
+        return ok; \
+    } \
+    int NAME##_build_from(NAME *m, const K *keys, const V *vals, size_t n, size_t nthreads) { \
+        dg_threadpool_t tp; \
+        if (nthreads <= 1 || n < DG_MAP_BUILD_MIN_CHUNK) return NAME##_build_from_tp(m, keys, vals, n, NULL, nthreads); \
+        if (tp_init(&tp, nthreads) != DGERR_SUCCESS) return NAME##_build_from_tp(m, keys, vals, n, NULL, 1); \
+        int ok = NAME##_build_from_tp(m, keys, vals, n, &tp, nthreads); \
+        tp_deinit(&tp); \
+        return ok; \
+    }
+
+#endif /* DG_MAP_BUILD_H */
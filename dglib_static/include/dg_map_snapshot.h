@@ -0,0 +1,306 @@
+// dg_map_snapshot.h - memory-mapped snapshots of dg_map.h tables
+// Public Domain / Unlicense. Header-only, expand DG_MAP_SNAPSHOT_IMPL after DG_MAP_IMPL.
+//
+// NAME_save writes the table arrays exactly as they sit in memory; NAME_open_mapped
+// maps such a file read-only and points a map at the mapped arrays. Nothing is parsed
+// or rehashed at load, so opening costs the same for 1K and 1G entries: pages are
+// faulted in by the lookups that touch them.
+//
+// File layout (native byte order, every section starts on a DG_MAP_SNAP_PAGE boundary):
+//   header page | ctrl (cap + 16 bytes) | hash (cap * 8, DG_MAP_STORE_HASH only) | keys | vals
+// In DG_MAP_SLOTS layout the keys section holds NAME_slot pairs and there is no vals section.
+//
+// Usage example (u64 -> u64):
+//   DG_MAP_DECL(u64map, uint64_t, uint64_t)
+//   DG_MAP_IMPL(u64map, uint64_t, uint64_t, u64_hash, u64_eq)
+//   DG_MAP_SNAPSHOT_IMPL(u64map, uint64_t, uint64_t, u64_hash)
+//
+//   u64map_save(&m, hfile);   /* hfile opened with FS_BIN, FS_W | FS_TRUNC */
+//   u64map mm; u64map_open_mapped(&mm, pathid, L"table.dgms", 0);
+//   u64map_get(&mm, &key, &val);
+//   u64map_destroy(&mm);      /* unmaps the file */
+//
+// Notes:
+// - K and V must be trivially copyable (no pointers): the file is a raw memory image.
+// - A mapped map is read-only: set/erase/clear/reserve/compact fail, and the value
+//   returned by get_ref must not be written through.
+// - DG_MAP_SLOTS, DG_MAP_STORE_HASH and the K/V sizes are recorded in the header;
+//   a file written with another layout is rejected. Both knobs must have the values
+//   they had where DG_MAP_IMPL of the same map expanded.
+// - The header is always checksummed. The data checksum needs a full pass over the
+//   file and is only checked with DG_MAP_SNAP_VERIFY; without it open_mapped rehashes
+//   a few stored keys to catch a file written with another HASHFN.
+
+#ifndef DG_MAP_SNAPSHOT_H
+#define DG_MAP_SNAPSHOT_H
+
+#include "dg_map.h"
+#include "dg_libcommon.h"
+#include "dg_filesystem.h"
+
+#define DG_MAP_SNAP_MAGIC   0x534D4744u /* 'DGMS' */
+#define DG_MAP_SNAP_VERSION 1
+#define DG_MAP_SNAP_PAGE    4096
+
+#define DG_MAP_SNAP_MAX_CAP ((uint64_t)1 << 48)
+#define DG_MAP_SNAP_WRITE_CHUNK ((size_t)1 << 30) /*< fs_write length limit per call */
+
+/**
+* layout flags
+*/
+enum DG_MAP_SNAP_FLAGS {
+	DG_MAP_SNAP_F_SLOTS = 1 << 0, /*< written with DG_MAP_SLOTS */
+	DG_MAP_SNAP_F_HASH = 1 << 1 /*< written with DG_MAP_STORE_HASH, hash section present */
+};
+
+/**
+* open_mapped flags
+*/
+enum DG_MAP_SNAP_OPEN {
+	DG_MAP_SNAP_VERIFY = 1 << 0 /*< verify data checksum (reads the whole file) */
+};
+
+/**
+* @brief snapshot file header, stored at offset 0
+*/
+typedef struct dg_map_snap_hdr_s {
+	uint32_t magic; /*< DG_MAP_SNAP_MAGIC */
+	uint32_t version; /*< DG_MAP_SNAP_VERSION */
+	uint32_t hdr_size; /*< sizeof(dg_map_snap_hdr_t) */
+	uint32_t flags; /*< DG_MAP_SNAP_FLAGS */
+	uint32_t key_size; /*< sizeof(K) */
+	uint32_t val_size; /*< sizeof(V) */
+	uint32_t slot_size; /*< sizeof(NAME_slot) */
+	uint32_t slot_val_off; /*< offsetof(NAME_slot, val) */
+	uint64_t size; /*< live entries */
+	uint64_t tombs; /*< tombstones */
+	uint64_t cap; /*< buckets, 0 or power of two */
+	uint64_t off_ctrl; /*< section offsets from the start of file */
+	uint64_t off_hash;
+	uint64_t off_keys;
+	uint64_t off_vals;
+	uint64_t file_size;
+	uint64_t data_sum; /*< checksum of ctrl, hash, keys and vals sections */
+	uint64_t hdr_sum; /*< checksum of header bytes before this field */
+} dg_map_snap_hdr_t;
+
+// 4-lane multiply/rotate checksum, not crypto. Kept independent of dg_hash_bytes
+// so that a change of the general-purpose hash does not invalidate existing files.
+static inline uint64_t dg_map_snap_sum(uint64_t seed, const void* data, size_t len) {
+	const uint8_t* p = (const uint8_t*)data;
+	uint64_t a = seed ^ 0x9E3779B97F4A7C15ull, b = seed + (uint64_t)len;
+	uint64_t c = ~seed, d = seed * 0xBF58476D1CE4E5B9ull + 1;
+	uint64_t w[4];
+	while (len >= 32) {
+		memcpy(w, p, 32);
+		a = dg_rotl64_(a ^ w[0], 29) * 0x9E3779B97F4A7C15ull;
+		b = dg_rotl64_(b ^ w[1], 29) * 0x9E3779B97F4A7C15ull;
+		c = dg_rotl64_(c ^ w[2], 29) * 0x9E3779B97F4A7C15ull;
+		d = dg_rotl64_(d ^ w[3], 29) * 0x9E3779B97F4A7C15ull;
+		p += 32; len -= 32;
+	}
+	uint64_t tail = 0;
+	for (size_t i = 0; i < len; ++i) tail ^= (uint64_t)p[i] << ((i & 7) * 8);
+	a = dg_rotl64_(a ^ tail, 29) * 0x9E3779B97F4A7C15ull;
+	return dg_splitmix64_(a ^ dg_rotl64_(b, 17) ^ dg_rotl64_(c, 31) ^ dg_rotl64_(d, 47));
+}
+
+static inline uint64_t dg__snap_align_(uint64_t x) {
+	return (x + DG_MAP_SNAP_PAGE - 1) & ~(uint64_t)(DG_MAP_SNAP_PAGE - 1);
+}
+
+// fills section offsets and file size from cap, flags and element sizes
+static inline void dg__map_snap_layout_(dg_map_snap_hdr_t* phdr) {
+	uint64_t cap = phdr->cap;
+	phdr->off_ctrl = DG_MAP_SNAP_PAGE;
+	phdr->off_hash = dg__snap_align_(phdr->off_ctrl + (cap ? cap + DG__GROUP_WIDTH : 0));
+	phdr->off_keys = dg__snap_align_(phdr->off_hash + ((phdr->flags & DG_MAP_SNAP_F_HASH) ? cap * sizeof(uint64_t) : 0));
+	if (phdr->flags & DG_MAP_SNAP_F_SLOTS) {
+		phdr->off_vals = phdr->off_keys + phdr->slot_val_off;
+		phdr->file_size = phdr->off_keys + cap * phdr->slot_size;
+	}
+	else {
+		phdr->off_vals = dg__snap_align_(phdr->off_keys + cap * phdr->key_size);
+		phdr->file_size = phdr->off_vals + cap * phdr->val_size;
+	}
+}
+
+static inline uint64_t dg__map_snap_data_sum_(const dg_map_snap_hdr_t* phdr, const uint8_t* ctrl,
+	const uint64_t* hash, const void* keys, const void* vals) {
+	uint64_t cap = phdr->cap, sum = 0;
+	if (!cap) return 0;
+	sum = dg_map_snap_sum(sum, ctrl, (size_t)(cap + DG__GROUP_WIDTH));
+	if (phdr->flags & DG_MAP_SNAP_F_HASH) sum = dg_map_snap_sum(sum, hash, (size_t)(cap * sizeof(uint64_t)));
+	if (phdr->flags & DG_MAP_SNAP_F_SLOTS) return dg_map_snap_sum(sum, keys, (size_t)(cap * phdr->slot_size));
+	sum = dg_map_snap_sum(sum, keys, (size_t)(cap * phdr->key_size));
+	return dg_map_snap_sum(sum, vals, (size_t)(cap * phdr->val_size));
+}
+
+/**
+* @brief validates header read from a mapped file against the expected layout
+* @param phdr - header copy
+* @param pexpect - header with flags and element sizes of the reading map
+* @param file_size - size of mapped file
+* @return 0 - success
+* @return DGERR_INCONSISTENT - wrong magic, version, checksum or section table
+* @return DGERR_INVALID_PARAM - file was written by a map with another layout
+*/
+static inline int dg__map_snap_check_hdr_(const dg_map_snap_hdr_t* phdr, const dg_map_snap_hdr_t* pexpect, uint64_t file_size) {
+	if (phdr->magic != DG_MAP_SNAP_MAGIC || phdr->version != DG_MAP_SNAP_VERSION || phdr->hdr_size != sizeof(*phdr))
+		return DGERR_INCONSISTENT;
+	if (phdr->hdr_sum != dg_map_snap_sum(0, phdr, offsetof(dg_map_snap_hdr_t, hdr_sum)))
+		return DGERR_INCONSISTENT;
+	if (phdr->flags != pexpect->flags || phdr->key_size != pexpect->key_size || phdr->val_size != pexpect->val_size ||
+		phdr->slot_size != pexpect->slot_size || phdr->slot_val_off != pexpect->slot_val_off)
+		return DGERR_INVALID_PARAM;
+	if (phdr->cap && (phdr->cap < DG__GROUP_WIDTH || phdr->cap > DG_MAP_SNAP_MAX_CAP || (phdr->cap & (phdr->cap - 1))))
+		return DGERR_INCONSISTENT;
+	if (phdr->size + phdr->tombs > phdr->cap)
+		return DGERR_INCONSISTENT;
+
+	dg_map_snap_hdr_t layout = *phdr;
+	dg__map_snap_layout_(&layout);
+	if (layout.off_ctrl != phdr->off_ctrl || layout.off_hash != phdr->off_hash || layout.off_keys != phdr->off_keys ||
+		layout.off_vals != phdr->off_vals || layout.file_size != phdr->file_size || phdr->file_size != file_size)
+		return DGERR_INCONSISTENT;
+	return DGERR_SUCCESS;
+}
+
+// writes len bytes, split into calls fs_write can take
+static inline int dg__map_snap_write_(dg_file_t hfile, const void* psrc, size_t len, uint64_t* ppos) {
+	const uint8_t* p = (const uint8_t*)psrc;
+	while (len) {
+		size_t n = 0, chunk = (len < DG_MAP_SNAP_WRITE_CHUNK) ? len : DG_MAP_SNAP_WRITE_CHUNK;
+		int res = fs_write(hfile, p, chunk, &n);
+		if (res != DGERR_SUCCESS)
+			return res;
+		if (n != chunk)
+			return DGERR_PARTIAL_COMPLETE;
+		p += chunk; len -= chunk; *ppos += chunk;
+	}
+	return DGERR_SUCCESS;
+}
+
+// zero-fills the file up to offset target
+static inline int dg__map_snap_pad_(dg_file_t hfile, uint64_t target, uint64_t* ppos) {
+	static const uint8_t zeros[DG_MAP_SNAP_PAGE];
+	while (*ppos < target) {
+		uint64_t n = target - *ppos;
+		int res = dg__map_snap_write_(hfile, zeros, (size_t)(n < sizeof(zeros) ? n : sizeof(zeros)), ppos);
+		if (res != DGERR_SUCCESS)
+			return res;
+	}
+	return DGERR_SUCCESS;
+}
+
+static inline void dg__map_snap_release_(void* pborrow) {
+	fs_unmap_file((dg_hfmap_t)pborrow);
+}
+
+/**
+* @brief generates snapshot functions for a map made by DG_MAP_DECL/DG_MAP_IMPL
+*
+* int NAME_save(NAME *m, dg_file_t hfile)
+*   writes the table to hfile (opened for writing, positioned at its start),
+*   finishing a pending incremental rehash first
+*   @return 0 - success
+*
+* int NAME_open_mapped(NAME *m, dg_pathid_t pathid, const dg_wchar_t *ppath, uint32_t flags)
+*   maps a file written by NAME_save as a read-only map, released with NAME_destroy
+*   @param flags - DG_MAP_SNAP_OPEN flags
+*   @return 0 - success
+*   @return DGERR_INCONSISTENT - damaged file or another HASHFN
+*   @return DGERR_INVALID_PARAM - file written with another layout or K/V types
+*/
+#define DG_MAP_SNAPSHOT_IMPL(NAME, K, V, HASHFN) \
+    static inline void NAME##__snap_hdr_init_(dg_map_snap_hdr_t *phdr) { \
+        memset(phdr, 0, sizeof(*phdr)); \
+        phdr->magic = DG_MAP_SNAP_MAGIC; \
+        phdr->version = DG_MAP_SNAP_VERSION; \
+        phdr->hdr_size = (uint32_t)sizeof(*phdr); \
+        phdr->flags = (DG_MAP_SLOTS ? DG_MAP_SNAP_F_SLOTS : 0) | (DG_MAP_STORE_HASH ? DG_MAP_SNAP_F_HASH : 0); \
+        phdr->key_size = (uint32_t)sizeof(K); \
+        phdr->val_size = (uint32_t)sizeof(V); \
+        phdr->slot_size = (uint32_t)sizeof(NAME##_slot); \
+        phdr->slot_val_off = (uint32_t)offsetof(NAME##_slot, val); \
+    } \
+    int NAME##_save(NAME *m, dg_file_t hfile) { \
+        dg_map_snap_hdr_t hdr; \
+        uint64_t pos = 0; \
+        int res; \
+        if (!m) return DGERR_INVALID_PARAM; \
+        NAME##_rehash_step(m, (size_t)-1); /* one table on disk */ \
+        NAME##__snap_hdr_init_(&hdr); \
+        hdr.size = m->size; \
+        hdr.tombs = m->tombs; \
+        hdr.cap = m->cap; \
+        dg__map_snap_layout_(&hdr); \
+        hdr.data_sum = dg__map_snap_data_sum_(&hdr, m->ctrl, m->hash, m->keys, m->vals); \
+        hdr.hdr_sum = dg_map_snap_sum(0, &hdr, offsetof(dg_map_snap_hdr_t, hdr_sum)); \
+        if ((res = dg__map_snap_write_(hfile, &hdr, sizeof(hdr), &pos)) != DGERR_SUCCESS) return res; \
+        if ((res = dg__map_snap_pad_(hfile, hdr.off_ctrl, &pos)) != DGERR_SUCCESS) return res; \
+        if (!m->cap) return DGERR_SUCCESS; \
+        if ((res = dg__map_snap_write_(hfile, m->ctrl, m->cap + DG__GROUP_WIDTH, &pos)) != DGERR_SUCCESS) return res; \
+        if ((res = dg__map_snap_pad_(hfile, hdr.off_hash, &pos)) != DGERR_SUCCESS) return res; \
+        if (DG_MAP_STORE_HASH && (res = dg__map_snap_write_(hfile, m->hash, m->cap * sizeof(uint64_t), &pos)) != DGERR_SUCCESS) return res; \
+        if ((res = dg__map_snap_pad_(hfile, hdr.off_keys, &pos)) != DGERR_SUCCESS) return res; \
+        if (DG_MAP_SLOTS) return dg__map_snap_write_(hfile, m->keys, m->cap * sizeof(NAME##_slot), &pos); \
+        if ((res = dg__map_snap_write_(hfile, m->keys, m->cap * sizeof(K), &pos)) != DGERR_SUCCESS) return res; \
+        if ((res = dg__map_snap_pad_(hfile, hdr.off_vals, &pos)) != DGERR_SUCCESS) return res; \
+        return dg__map_snap_write_(hfile, m->vals, m->cap * sizeof(V), &pos); \
+    } \
+    /* rehashes up to 8 stored keys: a file written with another HASHFN would miss every lookup */ \
+    static int NAME##__snap_probe_keys_(const NAME *m) { \
+        size_t checked = 0, end = (m->cap < 4096) ? m->cap : 4096; \
+        for (size_t i = 0; i < end && checked < 8; ++i) { \
+            if (!dg__ctrl_is_full_(m->ctrl[i])) continue; \
+            uint64_t h = (uint64_t)HASHFN(*NAME##__kp_(m->keys, i)); \
+            if (dg__h2meta(h) != m->ctrl[i] || (DG_MAP_STORE_HASH && m->hash[i] != h)) return 0; \
+            checked++; \
+        } \
+        return 1; \
+    } \
+    int NAME##_open_mapped(NAME *m, dg_pathid_t pathid, const dg_wchar_t *ppath, uint32_t flags) { \
+        dg_map_snap_hdr_t hdr, expect; \
+        dg_hfmap_t hfmap; \
+        const void *pdata; \
+        size_t size; \
+        int res; \
+        if (!m) return DGERR_INVALID_PARAM; \
+        memset(m, 0, sizeof(*m)); \
+        if ((res = fs_map_file(&hfmap, &pdata, &size, pathid, ppath)) != DGERR_SUCCESS) return res; \
+        const uint8_t *base = (const uint8_t*)pdata; \
+        if (size < DG_MAP_SNAP_PAGE) { \
+            fs_unmap_file(hfmap); \
+            return DGERR_INCONSISTENT; \
+        } \
+        memcpy(&hdr, base, sizeof(hdr)); \
+        NAME##__snap_hdr_init_(&expect); \
+        res = dg__map_snap_check_hdr_(&hdr, &expect, size); \
+        if (res == DGERR_SUCCESS && (flags & DG_MAP_SNAP_VERIFY) && \
+            hdr.data_sum != dg__map_snap_data_sum_(&hdr, base + hdr.off_ctrl, (const uint64_t*)(base + hdr.off_hash), \
+                base + hdr.off_keys, base + hdr.off_vals)) \
+            res = DGERR_INCONSISTENT; \
+        if (res != DGERR_SUCCESS) { \
+            fs_unmap_file(hfmap); \
+            return res; \
+        } \
+        m->pborrow = hfmap; \
+        m->pfn_release = dg__map_snap_release_; \
+        if (!hdr.cap) return DGERR_SUCCESS; \
+        m->size = (size_t)hdr.size; \
+        m->tombs = (size_t)hdr.tombs; \
+        m->cap = (size_t)hdr.cap; \
+        m->mask = m->cap - 1; \
+        m->ctrl = (uint8_t*)(base + hdr.off_ctrl); \
+        m->hash = DG_MAP_STORE_HASH ? (uint64_t*)(base + hdr.off_hash) : NULL; \
+        m->keys = (K*)(base + hdr.off_keys); \
+        m->vals = (V*)(base + hdr.off_vals); \
+        if (!NAME##__snap_probe_keys_(m)) { \
+            NAME##_destroy(m); \
+            return DGERR_INCONSISTENT; \
+        } \
+        return DGERR_SUCCESS; \
+    }
+
+#endif /* DG_MAP_SNAPSHOT_H */
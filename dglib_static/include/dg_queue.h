@@ -38,26 +38,93 @@ void *queue_get_front(dg_queue_t* pqueue);
 // Lock-free bounded multiple-producer/multiple-consumer queue
 // Uses Dmitry Vyukov's MPMC algorithm
 // Capacity must be a power of two.
+// enqueue_pos and dequeue_pos sit on their own cache lines, apart from the read-only fields,
+// so producers and consumers do not invalidate each other's line on every claim.
 typedef struct dg_mtqueue_mpmc_s {
 	size_t         elemsize;    // size of each element in bytes
 	size_t         capacity;    // number of slots (power of two)
 	size_t         mask;        // capacity - 1, for index wrap
-	atomic_size_t  enqueue_pos; // next position to enqueue
-	atomic_size_t  dequeue_pos; // next position to dequeue
 	atomic_size_t *seq;        // sequence for each slot, length = capacity
 	uint8_t       *pdata;      // raw buffer for elements: capacity * elemsize
+	char           pad0[DG_CACHE_LINE_SIZE];
+	atomic_size_t  enqueue_pos; // next position to enqueue
+	char           pad1[DG_CACHE_LINE_SIZE - sizeof(atomic_size_t)];
+	atomic_size_t  dequeue_pos; // next position to dequeue
+	char           pad2[DG_CACHE_LINE_SIZE - sizeof(atomic_size_t)];
 } dg_mtqueue_mpmc_t;
 
 bool  mpmc_queue_alloc(dg_mtqueue_mpmc_t* q, size_t elemsize, size_t capacity);
 bool  mpmc_queue_free(dg_mtqueue_mpmc_t* pqueue);
 bool  mpmc_queue_add_back(dg_mtqueue_mpmc_t* pqueue, const void* psrc);
 bool  mpmc_queue_get_front(void* pdst, dg_mtqueue_mpmc_t* q);
+// claims up to count consecutive slots with one compare-exchange, returns number added/taken
+size_t mpmc_queue_add_back_n(dg_mtqueue_mpmc_t* q, const void* psrc, size_t count);
+size_t mpmc_queue_get_front_n(void* pdst, dg_mtqueue_mpmc_t* q, size_t count);
 bool  mpmc_queue_is_empty(dg_mtqueue_mpmc_t* pqueue);
 bool  mpmc_queue_is_full(dg_mtqueue_mpmc_t* pqueue);
 
+// Blocking wrapper over dg_mtqueue_mpmc_t
+// A full add/empty get retries DGMPMC_SPIN_COUNT times, then parks on a condition variable.
+// Successful calls only take the mutex when the waiter counter of the other side is non-zero.
+// Every add/get must go through the _wait calls: plain calls on bq->q wake nobody.
+#define DGMPMC_SPIN_COUNT 128
+
+typedef struct dg_mtqueue_mpmc_blocking_s {
+	dg_mtqueue_mpmc_t q;
+	atomic_size_t     nwait_add; // threads parked in mpmc_queue_add_back_wait
+	atomic_size_t     nwait_get; // threads parked in mpmc_queue_get_front_wait
+	dg_mutex_t        mtx;
+	dg_cond_t         not_full;
+	dg_cond_t         not_empty;
+} dg_mtqueue_mpmc_blocking_t;
+
+bool  mpmc_queue_blocking_alloc(dg_mtqueue_mpmc_blocking_t* bq, size_t elemsize, size_t capacity);
+bool  mpmc_queue_blocking_free(dg_mtqueue_mpmc_blocking_t* bq);
+void  mpmc_queue_add_back_wait(dg_mtqueue_mpmc_blocking_t* bq, const void* psrc);
+void  mpmc_queue_get_front_wait(void* pdst, dg_mtqueue_mpmc_blocking_t* bq);
+
+// Wait-free bounded single-producer/single-consumer ring
+// Exactly one thread may push and exactly one thread may pop.
+// head and tail are free-running counters on separate cache lines, each side keeps a
+// cached copy of the opposite counter and only reloads it when the ring looks full/empty.
+// Capacity must be a power of two.
+typedef struct dg_spsc_ring_s {
+	size_t         elemsize;   // size of each element in bytes
+	size_t         capacity;   // number of slots (power of two)
+	size_t         mask;       // capacity - 1, for index wrap
+	uint8_t       *pdata;      // raw buffer for elements: capacity * elemsize
+	char           pad0[DG_CACHE_LINE_SIZE];
+	atomic_size_t  head;       // next position to pop, written by the consumer
+	size_t         tail_cache; // consumer's last seen tail
+	char           pad1[DG_CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+	atomic_size_t  tail;       // next position to push, written by the producer
+	size_t         head_cache; // producer's last seen head
+	char           pad2[DG_CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+} dg_spsc_ring_t;
+
+bool   spsc_ring_alloc(dg_spsc_ring_t* r, size_t elemsize, size_t capacity);
+bool   spsc_ring_free(dg_spsc_ring_t* r);
+/* producer side */
+bool   spsc_ring_push(dg_spsc_ring_t* r, const void* psrc);
+size_t spsc_ring_push_n(dg_spsc_ring_t* r, const void* psrc, size_t count); // returns number pushed
+void*  spsc_ring_reserve(dg_spsc_ring_t* r, size_t count, size_t* pgranted); // up to count contiguous free slots, NULL if full
+void   spsc_ring_commit(dg_spsc_ring_t* r, size_t count); // publishes count <= granted reserved slots
+/* consumer side */
+bool   spsc_ring_pop(void* pdst, dg_spsc_ring_t* r);
+size_t spsc_ring_pop_n(void* pdst, dg_spsc_ring_t* r, size_t count); // returns number popped
+void*  spsc_ring_peek(dg_spsc_ring_t* r, size_t count, size_t* pavail); // up to count contiguous filled slots, NULL if empty
+void   spsc_ring_release(dg_spsc_ring_t* r, size_t count); // frees count <= avail peeked slots
+/* approximate when called concurrently */
+size_t spsc_ring_size(dg_spsc_ring_t* r);
+bool   spsc_ring_is_empty(dg_spsc_ring_t* r);
+bool   spsc_ring_is_full(dg_spsc_ring_t* r);
+
 /**
-* multithreaded interlocked queue
+* multithreaded blocking queue
 */
+#define DGMTQUEUE_WAIT_INFINITE ((uint32_t)-1) /*< timeout value of the _timed calls that never expires */
+
+#if defined(_WIN32)
 typedef struct dg_mtqueue_s {
 	size_t         elemsize;
 	size_t         capacity;
@@ -70,6 +137,23 @@ typedef struct dg_mtqueue_s {
 	dg_mutex_t     head_mtx;
 	dg_mutex_t     tail_mtx;
 } dg_mtqueue_t;
+#else
+// Linux: dg_mtqueue_mpmc_t ring plus one futex eventcount per direction.
+// A call only enters the kernel when it has to sleep (queue full/empty after bounded spinning)
+// or when the other side has sleeping threads to wake.
+// Capacity is rounded up to a power of two. Only add-back/get-front operations exist.
+typedef struct dg_mtqueue_s {
+	size_t            elemsize;
+	size_t            capacity;
+	dg_mtqueue_mpmc_t ring;
+	atomic_size_t     nwait_get; // threads sleeping on items_seq
+	uint32_t          items_seq; // futex word, bumped before waking getters
+	char              pad0[DG_CACHE_LINE_SIZE - sizeof(atomic_size_t) - sizeof(uint32_t)];
+	atomic_size_t     nwait_add; // threads sleeping on slots_seq
+	uint32_t          slots_seq; // futex word, bumped before waking adders
+	char              pad1[DG_CACHE_LINE_SIZE - sizeof(atomic_size_t) - sizeof(uint32_t)];
+} dg_mtqueue_t;
+#endif
 
 bool  mtqueue_alloc(dg_mtqueue_t *q, size_t elemsize, size_t capacity);
 bool  mtqueue_free(dg_mtqueue_t* q);
@@ -77,8 +161,16 @@ bool  mtqueue_free(dg_mtqueue_t* q);
 bool  mtqueue_is_empty(dg_mtqueue_t* pqueue);
 bool  mtqueue_is_full(dg_mtqueue_t* pqueue);
 void  mtqueue_add_back(dg_mtqueue_t* pqueue, const void* psrc);
+bool  mtqueue_try_add_back(dg_mtqueue_t* pqueue, const void* psrc);
+bool  mtqueue_add_back_timed(dg_mtqueue_t* pqueue, const void* psrc, uint32_t timeout_ms); // false on timeout
+/* copy the front element out, the slot is free for producers once the call returns */
+void  mtqueue_get_front_copy(void* pdst, dg_mtqueue_t* pqueue);
+bool  mtqueue_try_get_front(void* pdst, dg_mtqueue_t* pqueue);
+bool  mtqueue_get_front_timed(void* pdst, dg_mtqueue_t* pqueue, uint32_t timeout_ms); // false on timeout
+#if defined(_WIN32)
+/* the returned pointers address a slot that producers may already overwrite, prefer the copying calls */
 void* mtqueue_get_back(dg_mtqueue_t* pqueue);
 void  mtqueue_add_front(dg_mtqueue_t* pqueue, const void* psrc);
 void* mtqueue_get_front(dg_mtqueue_t* pqueue);
-bool  mtqueue_try_add_back(dg_mtqueue_t* pqueue, const void* psrc);
-bool  mtqueue_try_add_front(dg_mtqueue_t* pqueue, const void* psrc);
\ No newline at end of file
+bool  mtqueue_try_add_front(dg_mtqueue_t* pqueue, const void* psrc);
+#endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+#include "dg_alloc.h"
+
+/**
+ * @brief Segmented array (1D) with stable element addresses
+ * @details Elements live in fixed-size chunks of a power-of-two number of
+ * elements, reached through a chunk table. Growth appends chunks and at most
+ * reallocates the table of chunk pointers, so element addresses stay valid
+ * until the element is removed or the array is freed. Indexing is a shift,
+ * a mask and two loads. Elements are contiguous only inside a chunk: bulk
+ * loops should walk chunks with segarray_get_chunk().
+ */
+typedef struct dg_segarray_s {
+  size_t    elemsize;   /**< Size of one element in bytes */
+  size_t    size;       /**< Current number of elements */
+  size_t    nchunks;    /**< Allocated chunks (capacity is nchunks << chunkshift) */
+  size_t    tablecap;   /**< Capacity of the chunk table */
+  uint8_t** pchunks;    /**< Chunk table */
+  uint32_t  chunkshift; /**< log2 of elements per chunk */
+} dg_segarray_t;
+
+#define DGSEGARRAY_DEFAULT_CHUNK_BYTES (64 * 1024) /**< Chunk size used when chunkelems is 0 */
+
+#define segarray_get_size(p)         ((p)->size)                              /**< Get current size */
+#define segarray_get_capacity(p)     ((p)->nchunks << (p)->chunkshift)        /**< Get allocated capacity */
+#define segarray_get_elemsize(p)     ((p)->elemsize)                          /**< Get element size */
+#define segarray_get_chunk_elems(p)  ((size_t)1 << (p)->chunkshift)           /**< Get elements per chunk */
+#define segarray_get_chunk_count(p)  (((p)->size + segarray_get_chunk_elems(p) - 1) >> (p)->chunkshift) /**< Get number of chunks holding elements */
+#define segarray_is_empty(p)         (!((p)->size))
+
+/**
+ * @brief Initialize empty segmented array, no memory is allocated
+ * @param psa Pointer to array
+ * @param elemsize Element size in bytes
+ * @param chunkelems Elements per chunk, rounded up to a power of two;
+ * 0 picks a chunk of about DGSEGARRAY_DEFAULT_CHUNK_BYTES
+ * @return DGERR_SUCCESS or DGERR_INVALID_PARAM
+ */
+int     segarray_init(dg_segarray_t* psa, size_t elemsize, size_t chunkelems);
+/**
+ * @brief Free all chunks and the chunk table
+ * @param psa Pointer to array
+ */
+void    segarray_free(dg_segarray_t* psa);
+/**
+ * @brief Clear array (set size to 0, keep chunks)
+ * @param psa Pointer to array
+ */
+void    segarray_clear(dg_segarray_t* psa);
+/**
+ * @brief Allocate chunks for at least count elements
+ * @param psa Pointer to array
+ * @param count Number of elements
+ * @return DGERR_SUCCESS or DGERR_OUT_OF_MEMORY
+ */
+int     segarray_reserve(dg_segarray_t* psa, size_t count);
+/**
+ * @brief Free chunks past the last element
+ * @param psa Pointer to array
+ */
+void    segarray_shrink_to_fit(dg_segarray_t* psa);
+/**
+ * @brief Add element to back, return its (stable) address
+ * @param psa Pointer to array
+ * @return Pointer to new element or NULL on failure
+ */
+void*   segarray_add_back(dg_segarray_t* psa);
+/**
+ * @brief Push element to back (copy from src)
+ * @param psa Pointer to array
+ * @param psrc Pointer to source element
+ * @return true on success, false on failure
+ */
+bool    segarray_push_back(dg_segarray_t* psa, const void* psrc);
+/**
+ * @brief Append count elements, copied chunk by chunk
+ * @param psa Pointer to array
+ * @param psrc Pointer to count source elements
+ * @param count Number of elements
+ * @return DGERR_SUCCESS, DGERR_OUT_OF_MEMORY or DGERR_OVERFLOWED
+ */
+int     segarray_append(dg_segarray_t* psa, const void* psrc, size_t count);
+/**
+ * @brief Pop element from back
+ * @param pdst Pointer to destination or NULL
+ * @param psa Pointer to array
+ * @return true on success, false if empty
+ */
+bool    segarray_pop_back(void* pdst, dg_segarray_t* psa);
+
+/**
+ * @brief Get pointer to element at index
+ * @param psa Pointer to array
+ * @param idx Element index
+ * @return Pointer to element, valid until it is removed
+ */
+static inline void* segarray_get_ex(const dg_segarray_t* psa, size_t idx) {
+  assert(idx < psa->size && "idx out of bounds");
+  return psa->pchunks[idx >> psa->chunkshift] +
+    (idx & (segarray_get_chunk_elems(psa) - 1)) * psa->elemsize;
+}
+/**
+ * @brief Get element at index (typed)
+ * @param p Pointer to array
+ * @param idx Element index
+ * @param type Element type
+ */
+#define segarray_get(p, idx, type)    (*((type*)segarray_get_ex((p), (idx))))
+#define segarray_getptr(p, idx, type) ((type*)segarray_get_ex((p), (idx)))
+
+/**
+ * @brief Get contiguous elements of a chunk
+ * @details Chunks are full except the last one, for (i = 0; i < segarray_get_chunk_count(p); i++)
+ * visits all elements in index order.
+ * @param psa Pointer to array
+ * @param ichunk Chunk index
+ * @param pcount Receives number of elements in the chunk
+ * @return Pointer to the first element of the chunk
+ */
+static inline void* segarray_get_chunk(const dg_segarray_t* psa, size_t ichunk, size_t* pcount) {
+  size_t first = ichunk << psa->chunkshift;
+  size_t n = segarray_get_chunk_elems(psa);
+  assert(first < psa->size && "chunk out of bounds");
+  *pcount = (psa->size - first < n) ? psa->size - first : n;
+  return psa->pchunks[ichunk];
+}
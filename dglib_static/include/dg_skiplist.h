@@ -0,0 +1,370 @@
+// dg_skiplist.h - lock-free concurrent ordered map generator (skip list)
+// Public Domain / Unlicense. Header-only, same DECL/IMPL split as dg_treemap.h.
+//
+// Every level is a sorted singly linked list of atomic links (Fraser, Herlihy-Shavit).
+// A node is erased by setting the low bit of its links, top level first and level 0
+// last (the linearization point); the next search that passes the node unlinks it.
+// _get, _lower_bound and iteration never write shared memory: they step over marked
+// nodes instead of unlinking them, so readers do not bounce cache lines between cores.
+//
+// Memory reclamation is epoch based (EBR):
+// - Every thread attaches once and gets a handle, one of DG_SKIPLIST_MAX_THREADS cache
+//   line padded slots of the map. Operations publish the global epoch in the slot on
+//   entry and clear it on exit; calls nest, so a caller may hold an _enter/_leave pair
+//   around several calls (required to keep iterators).
+// - An unlinked node goes to the limbo list of its handle, tagged with the current
+//   epoch. The epoch advances once every thread inside a critical section has seen it,
+//   and a node retired in epoch e is reused once the epoch reaches e + 2.
+// - Nodes are carved from chunks owned by the map and recycled through per-handle,
+//   per-height free lists: no malloc/free on the steady state insert/erase path.
+//   A node reclaimed by another handle (one thread inserts, another erases) is pushed
+//   back to the remote stack of the handle that carved it, which takes the whole stack
+//   once its free list runs dry.
+//   A detached handle keeps its lists, the next thread attaching to the slot reuses them.
+//
+// Usage example (u64 -> u64):
+//   DG_SKIPLIST_DECL(u64sl, uint64_t, uint64_t)
+//   DG_SKIPLIST_IMPL(u64sl, uint64_t, uint64_t, u64_cmp)
+//
+//   u64sl m; u64sl_init(&m);              /* single threaded */
+//   u64sl_handle *h = u64sl_attach(&m);   /* once per thread */
+//   u64sl_insert(h, 42, &val);
+//   u64sl_enter(h);                       /* iterators are valid until _leave */
+//   for (u64sl_it it = u64sl_lower_bound(h, 10); it && *u64sl_iter_key(it) < 100; it = u64sl_iter_next(h, it)) ...
+//   u64sl_leave(h);
+//   u64sl_detach(h);
+//   u64sl_destroy(&m);                    /* after all threads detached */
+//
+// Notes:
+// - K and V are copied by value and never change after insertion: _insert does not
+//   replace the value of a present key (erase and insert again instead).
+// - No KEYFREE/VALFREE hooks, a node may be read by other threads after its erase returned.
+// - Iteration is ordered but not a snapshot: concurrent inserts/erases may or may not show.
+// - _size sums per-handle counters, it is exact only while no writer runs.
+// - Do not block inside _enter/_leave, a stalled critical section stops reclamation.
+
+#ifndef DG_SKIPLIST_H
+#define DG_SKIPLIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dg_libcommon.h"
+#include "dg_atomic.h"
+
+#ifndef DG_SKIPLIST_MALLOC
+#  define DG_SKIPLIST_MALLOC(sz) malloc(sz)
+#endif
+#ifndef DG_SKIPLIST_FREE
+#  define DG_SKIPLIST_FREE(p) free(p)
+#endif
+
+#define DG_SKIPLIST_MAX_LEVEL   24    /*< levels, with p = 1/4 enough for 2^48 keys */
+#define DG_SKIPLIST_MAX_THREADS 64    /*< handles per map */
+#define DG_SKIPLIST_CHUNK_BYTES 65536 /*< level 1 node chunk, halved per level */
+#define DG_SKIPLIST_EBR_BATCH   64    /*< retired nodes between epoch advance attempts */
+
+#define DG__SL_MARKED(x) (((x) & 1) != 0)
+#define DG__SL_ALIGN 16 /* chunk header and node size granularity */
+
+#define DG_SKIPLIST_DECL(NAME, K, V) \
+    typedef struct NAME NAME; \
+    typedef struct NAME##_node NAME##_node; \
+    typedef NAME##_node* NAME##_it; /* NULL = end, valid until _leave */ \
+    struct NAME##_node { \
+        K key; V val; \
+        NAME##_node* rlink; /* limbo list */ \
+        atomic_size_t owners; /* inserter + eraser, the last one retires the node */ \
+        uint32_t level; \
+        uint32_t owner; /* handle slot that carved the node, it gets the node back */ \
+        atomic_size_t next[]; /* node pointer | 1 if erased */ \
+    }; \
+    typedef struct NAME##_handle_data { \
+        atomic_size_t used; /* 1 while a thread is attached */ \
+        atomic_size_t active; /* epoch seen on entry, 0 outside critical sections */ \
+        atomic_size_t count; /* inserts - erases through this handle */ \
+        NAME*         m; \
+        uint32_t      depth; \
+        uint32_t      nretired; \
+        uint64_t      rng; \
+        NAME##_node*  limbo[3]; /* by epoch % 3 */ \
+        size_t        limbo_epoch[3]; \
+        NAME##_node*  free[DG_SKIPLIST_MAX_LEVEL]; /* by level - 1, linked through next[0] */ \
+        atomic_size_t remote; /* nodes reclaimed by other handles, linked through next[0] */ \
+    } NAME##_handle_data; \
+    typedef union NAME##_handle { \
+        NAME##_handle_data d; \
+        char pad[DG_ALIGN_UP(sizeof(NAME##_handle_data), DG_CACHE_LINE_SIZE)]; \
+    } NAME##_handle; \
+    struct NAME { \
+        NAME##_node*   head; /* DG_SKIPLIST_MAX_LEVEL links, no key */ \
+        atomic_size_t  height; /* levels in use, searches start there */ \
+        atomic_size_t  epoch; \
+        atomic_size_t  nhandles; /* slots ever attached */ \
+        atomic_size_t  chunks; /* node chunks, linked through their first word */ \
+        NAME##_handle* handles; \
+        void*          pmem; \
+    }; \
+    int  NAME##_init(NAME* m); \
+    void NAME##_destroy(NAME* m); \
+    size_t NAME##_size(NAME* m); \
+    /* threads */ \
+    NAME##_handle* NAME##_attach(NAME* m); \
+    void NAME##_detach(NAME##_handle* h); \
+    void NAME##_enter(NAME##_handle* h); \
+    void NAME##_leave(NAME##_handle* h); \
+    /* CRUD */ \
+    int  NAME##_insert(NAME##_handle* h, K key, const V* val); \
+    int  NAME##_get(NAME##_handle* h, K key, V* out); \
+    int  NAME##_erase(NAME##_handle* h, K key); \
+    /* iterators (in-order), between _enter and _leave */ \
+    NAME##_it NAME##_iter_begin(NAME##_handle* h); \
+    NAME##_it NAME##_iter_next(NAME##_handle* h, NAME##_it it); \
+    NAME##_it NAME##_lower_bound(NAME##_handle* h, K key); \
+    const K* NAME##_iter_key(NAME##_it it); \
+    const V* NAME##_iter_val(NAME##_it it);
+
+/**
+* int NAME_insert(NAME_handle *h, K key, const V *val)
+*   @return 1 - inserted, 0 - key present or out of memory
+* int NAME_get(NAME_handle *h, K key, V *out)
+*   @return 1 - found, value copied to out (if not NULL), 0 - not found
+* int NAME_erase(NAME_handle *h, K key)
+*   @return 1 - erased by this call, 0 - not found
+* NAME_handle* NAME_attach(NAME *m)
+*   @return free handle slot or NULL if all DG_SKIPLIST_MAX_THREADS are attached
+*/
+#define DG_SKIPLIST_IMPL(NAME, K, V, CMPFN) \
+    static inline NAME##_node* NAME##__ptr_(size_t x){ return (NAME##_node*)(x & ~(size_t)1); } \
+    static inline size_t NAME##__node_size_(uint32_t level){ \
+        return DG_ALIGN_UP(sizeof(NAME##_node) + level*sizeof(atomic_size_t), DG__SL_ALIGN); } \
+    /* p = 1/4 per extra level */ \
+    static inline uint32_t NAME##__rand_level_(NAME##_handle_data* d){ \
+        uint64_t r = d->rng; r ^= r << 13; r ^= r >> 7; r ^= r << 17; d->rng = r; \
+        uint32_t l = 1; while(!(r & 3) && l < DG_SKIPLIST_MAX_LEVEL){ l++; r >>= 2; } return l; } \
+    static inline uint32_t NAME##__slot_(NAME##_handle_data* d){ return (uint32_t)((NAME##_handle*)d - d->m->handles); } \
+    static inline void NAME##__push_free_(NAME##_handle_data* d, NAME##_node* n){ \
+        n->next[0] = (size_t)d->free[n->level-1]; d->free[n->level-1] = n; } \
+    static NAME##_node* NAME##__alloc_node_(NAME##_handle_data* d, uint32_t level){ \
+        NAME##_node* n = d->free[level-1]; \
+        if(!n && dg_atomic_load(&d->remote)){ \
+            /* only the owner pops, and it takes the whole stack: no ABA */ \
+            NAME##_node* r = (NAME##_node*)dg_atomic_exchange(&d->remote, 0); \
+            while(r){ NAME##_node* nx = NAME##__ptr_(r->next[0]); NAME##__push_free_(d, r); r = nx; } \
+            n = d->free[level-1]; \
+        } \
+        if(n){ d->free[level-1] = NAME##__ptr_(n->next[0]); return n; } \
+        size_t nsz = NAME##__node_size_(level), cnt = (DG_SKIPLIST_CHUNK_BYTES >> (level - 1)) / nsz; \
+        if(cnt < 4) cnt = 4; \
+        uint8_t* c = (uint8_t*)DG_SKIPLIST_MALLOC(DG__SL_ALIGN + cnt*nsz); \
+        if(!c) return NULL; \
+        size_t head = dg_atomic_load(&d->m->chunks); \
+        for(;;){ *(size_t*)c = head; size_t prev = dg_atomic_compare_exchange(&d->m->chunks, head, (size_t)c); if(prev == head) break; head = prev; } \
+        uint32_t self = NAME##__slot_(d); \
+        for(size_t i = cnt - 1; i > 0; --i){ \
+            NAME##_node* f = (NAME##_node*)(c + DG__SL_ALIGN + i*nsz); \
+            f->level = level; f->owner = self; NAME##__push_free_(d, f); } \
+        n = (NAME##_node*)(c + DG__SL_ALIGN); n->level = level; n->owner = self; \
+        return n; \
+    } \
+    /* push the chain first..last to the remote stack of its owner */ \
+    static void NAME##__give_back_(NAME* m, NAME##_node* first, NAME##_node* last){ \
+        atomic_size_t* r = &m->handles[first->owner].d.remote; \
+        size_t head = dg_atomic_load(r); \
+        for(;;){ last->next[0] = head; size_t prev = dg_atomic_compare_exchange(r, head, (size_t)first); if(prev == head) break; head = prev; } \
+    } \
+    /* own nodes go to the free lists, others back to their owner in runs of one owner */ \
+    static void NAME##__reclaim_(NAME##_handle_data* d, int b){ \
+        uint32_t self = NAME##__slot_(d); \
+        NAME##_node *n = d->limbo[b], *first = NULL, *last = NULL; \
+        while(n){ \
+            NAME##_node* nx = n->rlink; \
+            if(n->owner == self) NAME##__push_free_(d, n); \
+            else { \
+                if(first && first->owner != n->owner){ NAME##__give_back_(d->m, first, last); first = NULL; } \
+                if(!first) last = n; \
+                n->next[0] = (size_t)first; first = n; \
+            } \
+            n = nx; \
+        } \
+        if(first) NAME##__give_back_(d->m, first, last); \
+        d->limbo[b] = NULL; \
+    } \
+    /* advance if every thread inside a critical section has seen the current epoch */ \
+    static void NAME##__try_advance_(NAME* m){ \
+        size_t e = dg_atomic_load(&m->epoch), nh = dg_atomic_load_acquire(&m->nhandles); \
+        for(size_t i = 0; i < nh; ++i){ size_t a = dg_atomic_load_acquire(&m->handles[i].d.active); if(a && a != e) return; } \
+        dg_atomic_compare_exchange(&m->epoch, e, e + 1); \
+    } \
+    /* n is unreachable: no new reader can find it, old readers are waited for by epoch */ \
+    static void NAME##__retire_(NAME##_handle_data* d, NAME##_node* n){ \
+        size_t e = dg_atomic_load_acquire(&d->m->epoch); int b = (int)(e % 3); \
+        if(d->limbo_epoch[b] != e){ NAME##__reclaim_(d, b); d->limbo_epoch[b] = e; } /* holds epoch e - 3 or older */ \
+        n->rlink = d->limbo[b]; d->limbo[b] = n; \
+        if(++d->nretired >= DG_SKIPLIST_EBR_BATCH){ d->nretired = 0; NAME##__try_advance_(d->m); } \
+    } \
+    /* fills preds/succs on levels [0, max(top, height)), unlinks marked nodes on the way */ \
+    static int NAME##__find_(NAME* m, K key, NAME##_node** preds, NAME##_node** succs, uint32_t top){ \
+        size_t ht = dg_atomic_load_acquire(&m->height); if(ht < top) ht = top; \
+    retry: ; \
+        NAME##_node* pred = m->head; \
+        for(int l = (int)ht - 1; l >= 0; --l){ \
+            NAME##_node* curr = NAME##__ptr_(dg_atomic_load_acquire(&pred->next[l])); \
+            while(curr){ \
+                size_t sx = dg_atomic_load_acquire(&curr->next[l]); \
+                while(DG__SL_MARKED(sx)){ \
+                    if(dg_atomic_compare_exchange(&pred->next[l], (size_t)curr, sx & ~(size_t)1) != (size_t)curr) goto retry; \
+                    curr = NAME##__ptr_(sx); \
+                    if(!curr) break; \
+                    sx = dg_atomic_load_acquire(&curr->next[l]); \
+                } \
+                if(!curr || CMPFN(curr->key, key) >= 0) break; \
+                pred = curr; curr = NAME##__ptr_(sx); \
+            } \
+            preds[l] = pred; succs[l] = curr; \
+        } \
+        return succs[0] && CMPFN(succs[0]->key, key) == 0; \
+    } \
+    /* first unmarked node >= key, read only */ \
+    static NAME##_node* NAME##__seek_(NAME* m, K key){ \
+        NAME##_node *pred = m->head, *curr = NULL; \
+        for(int l = (int)dg_atomic_load_acquire(&m->height) - 1; l >= 0; --l){ \
+            curr = NAME##__ptr_(dg_atomic_load_acquire(&pred->next[l])); \
+            while(curr){ \
+                size_t sx = dg_atomic_load_acquire(&curr->next[l]); \
+                if(!DG__SL_MARKED(sx)){ if(CMPFN(curr->key, key) >= 0) break; pred = curr; } \
+                curr = NAME##__ptr_(sx); \
+            } \
+        } \
+        return curr; \
+    } \
+    static inline NAME##_node* NAME##__skip_marked_(NAME##_node* n){ \
+        while(n){ size_t sx = dg_atomic_load_acquire(&n->next[0]); if(!DG__SL_MARKED(sx)) break; n = NAME##__ptr_(sx); } \
+        return n; \
+    } \
+    int NAME##_init(NAME* m){ \
+        if(!m) return 0; \
+        memset(m, 0, sizeof(*m)); \
+        m->head = (NAME##_node*)DG_SKIPLIST_MALLOC(NAME##__node_size_(DG_SKIPLIST_MAX_LEVEL)); \
+        m->pmem = DG_SKIPLIST_MALLOC(DG_SKIPLIST_MAX_THREADS*sizeof(NAME##_handle) + DG_CACHE_LINE_SIZE); \
+        if(!m->head || !m->pmem){ DG_SKIPLIST_FREE(m->head); DG_SKIPLIST_FREE(m->pmem); memset(m, 0, sizeof(*m)); return 0; } \
+        memset(m->head, 0, NAME##__node_size_(DG_SKIPLIST_MAX_LEVEL)); \
+        m->head->level = DG_SKIPLIST_MAX_LEVEL; \
+        m->handles = (NAME##_handle*)DG_ALIGN_UP((uintptr_t)m->pmem, DG_CACHE_LINE_SIZE); \
+        memset(m->handles, 0, DG_SKIPLIST_MAX_THREADS*sizeof(NAME##_handle)); \
+        m->height = 1; m->epoch = 1; \
+        return 1; \
+    } \
+    void NAME##_destroy(NAME* m){ \
+        if(!m) return; \
+        for(size_t c = m->chunks; c; ){ size_t nx = *(size_t*)c; DG_SKIPLIST_FREE((void*)c); c = nx; } \
+        DG_SKIPLIST_FREE(m->head); DG_SKIPLIST_FREE(m->pmem); \
+        memset(m, 0, sizeof(*m)); \
+    } \
+    size_t NAME##_size(NAME* m){ \
+        size_t n = 0, nh = m ? dg_atomic_load_acquire(&m->nhandles) : 0; \
+        for(size_t i = 0; i < nh; ++i) n += dg_atomic_load_acquire(&m->handles[i].d.count); \
+        return n; \
+    } \
+    NAME##_handle* NAME##_attach(NAME* m){ \
+        if(!m) return NULL; \
+        for(size_t i = 0; i < DG_SKIPLIST_MAX_THREADS; ++i){ \
+            NAME##_handle_data* d = &m->handles[i].d; \
+            if(dg_atomic_load_acquire(&d->used) || dg_atomic_compare_exchange(&d->used, 0, 1) != 0) continue; \
+            if(!d->m){ d->m = m; d->rng = ((uint64_t)(i + 1) * 0x9E3779B97F4A7C15ull) ^ (uintptr_t)m; if(!d->rng) d->rng = 1; } \
+            size_t nh = dg_atomic_load(&m->nhandles); \
+            while(nh <= i){ size_t prev = dg_atomic_compare_exchange(&m->nhandles, nh, i + 1); if(prev == nh) break; nh = prev; } \
+            return &m->handles[i]; \
+        } \
+        return NULL; \
+    } \
+    void NAME##_detach(NAME##_handle* h){ if(h) dg_atomic_store_release(&h->d.used, 0); } \
+    void NAME##_enter(NAME##_handle* h){ \
+        NAME##_handle_data* d = &h->d; \
+        if(d->depth++) return; \
+        size_t e = dg_atomic_load_acquire(&d->m->epoch); \
+        dg_atomic_store(&d->active, e); /* full barrier: published before any link is read */ \
+        for(int b = 0; b < 3; ++b) if(d->limbo[b] && d->limbo_epoch[b] + 2 <= e) NAME##__reclaim_(d, b); \
+    } \
+    void NAME##_leave(NAME##_handle* h){ \
+        NAME##_handle_data* d = &h->d; \
+        if(--d->depth) return; \
+        dg_atomic_store_release(&d->active, 0); \
+    } \
+    int NAME##_insert(NAME##_handle* h, K key, const V* val){ \
+        NAME##_handle_data* d = &h->d; NAME* m = d->m; \
+        NAME##_node *preds[DG_SKIPLIST_MAX_LEVEL], *succs[DG_SKIPLIST_MAX_LEVEL]; \
+        uint32_t top = NAME##__rand_level_(d), l; \
+        NAME##_node* n = NAME##__alloc_node_(d, top); \
+        if(!n) return 0; \
+        n->key = key; n->val = *val; n->owners = 2; \
+        NAME##_enter(h); \
+        size_t ht = dg_atomic_load_acquire(&m->height); \
+        while(ht < top){ size_t prev = dg_atomic_compare_exchange(&m->height, ht, top); if(prev == ht) break; ht = prev; } \
+        for(;;){ \
+            if(NAME##__find_(m, key, preds, succs, top)){ \
+                NAME##__push_free_(d, n); \
+                NAME##_leave(h); return 0; } \
+            for(l = 0; l < top; ++l) n->next[l] = (size_t)succs[l]; \
+            if(dg_atomic_compare_exchange(&preds[0]->next[0], (size_t)succs[0], (size_t)n) == (size_t)succs[0]) break; \
+        } \
+        /* upper levels: stop as soon as an eraser marked the node */ \
+        for(l = 1; l < top; ++l){ \
+            for(;;){ \
+                size_t nx = dg_atomic_load_acquire(&n->next[l]); \
+                if(DG__SL_MARKED(nx)) goto linked; \
+                if(nx != (size_t)succs[l] && dg_atomic_compare_exchange(&n->next[l], nx, (size_t)succs[l]) != nx) goto linked; \
+                if(dg_atomic_compare_exchange(&preds[l]->next[l], (size_t)succs[l], (size_t)n) == (size_t)succs[l]) break; \
+                NAME##__find_(m, key, preds, succs, top); \
+                if(succs[0] != n) goto linked; \
+            } \
+        } \
+    linked: \
+        /* an eraser may have finished unlinking before the last level was linked */ \
+        if(DG__SL_MARKED(dg_atomic_load_acquire(&n->next[0]))) NAME##__find_(m, key, preds, succs, top); \
+        if(dg_atomic_fetch_sub(&n->owners, 1) == 1) NAME##__retire_(d, n); \
+        dg_atomic_store_release(&d->count, d->count + 1); \
+        NAME##_leave(h); \
+        return 1; \
+    } \
+    int NAME##_get(NAME##_handle* h, K key, V* out){ \
+        NAME##_enter(h); \
+        NAME##_node* n = NAME##__seek_(h->d.m, key); \
+        int found = n && CMPFN(n->key, key) == 0; \
+        if(found && out) *out = n->val; \
+        NAME##_leave(h); \
+        return found; \
+    } \
+    int NAME##_erase(NAME##_handle* h, K key){ \
+        NAME##_handle_data* d = &h->d; NAME* m = d->m; \
+        NAME##_node *preds[DG_SKIPLIST_MAX_LEVEL], *succs[DG_SKIPLIST_MAX_LEVEL]; \
+        NAME##_enter(h); \
+        if(!NAME##__find_(m, key, preds, succs, 1)){ NAME##_leave(h); return 0; } \
+        NAME##_node* n = succs[0]; \
+        for(uint32_t l = n->level - 1; l > 0; --l){ \
+            size_t nx = dg_atomic_load_acquire(&n->next[l]); \
+            while(!DG__SL_MARKED(nx)){ size_t prev = dg_atomic_compare_exchange(&n->next[l], nx, nx | 1); if(prev == nx) break; nx = prev; } \
+        } \
+        size_t nx = dg_atomic_load_acquire(&n->next[0]); \
+        for(;;){ \
+            if(DG__SL_MARKED(nx)){ NAME##_leave(h); return 0; } /* another eraser won */ \
+            size_t prev = dg_atomic_compare_exchange(&n->next[0], nx, nx | 1); \
+            if(prev == nx) break; \
+            nx = prev; \
+        } \
+        NAME##__find_(m, key, preds, succs, n->level); \
+        if(dg_atomic_fetch_sub(&n->owners, 1) == 1) NAME##__retire_(d, n); \
+        dg_atomic_store_release(&d->count, d->count - 1); \
+        NAME##_leave(h); \
+        return 1; \
+    } \
+    NAME##_it NAME##_iter_begin(NAME##_handle* h){ \
+        return NAME##__skip_marked_(NAME##__ptr_(dg_atomic_load_acquire(&h->d.m->head->next[0]))); } \
+    NAME##_it NAME##_iter_next(NAME##_handle* h, NAME##_it it){ (void)h; \
+        return it ? NAME##__skip_marked_(NAME##__ptr_(dg_atomic_load_acquire(&it->next[0]))) : NULL; } \
+    NAME##_it NAME##_lower_bound(NAME##_handle* h, K key){ return NAME##__seek_(h->d.m, key); } \
+    const K* NAME##_iter_key(NAME##_it it){ return it ? &it->key : NULL; } \
+    const V* NAME##_iter_val(NAME##_it it){ return it ? &it->val : NULL; }
+
+#endif /* DG_SKIPLIST_H */
@@ -0,0 +1,188 @@
+// dg_soa.h - header-only C99 structure-of-arrays container
+// Public Domain / Unlicense. Same generator shape as DG_VEC (dg_vec.h).
+//
+// Goals vs an array of structs in dg_darray_t:
+// - One contiguous column per field, so a kernel reading one field streams only that field
+// - All columns share size/capacity and live in one allocation, each column starts on a
+//   DG_SOA_ALIGN boundary: s.field is a plain T* ready for SIMD loops
+// - Rows are pushed/read/written through NAME_row, a struct with the same fields
+// - Erase moves the last row into the hole (order is not kept), O(fields)
+//
+// Fields are given as (type, name) pairs, up to 16, identically to DECL and IMPL:
+//   #define PARTICLE_FIELDS (float, x), (float, y), (float, vx), (float, vy), (uint32_t, flags)
+//   DG_SOA_DECL(particles, PARTICLE_FIELDS);
+//   DG_SOA_IMPL(particles, PARTICLE_FIELDS);
+//
+//   particles s; particles_init(&s, 0);
+//   particles_push(&s, &(particles_row){ .x = 1.0f, .vx = 0.5f });
+//   float *x = s.x; const float *vx = s.vx;
+//   for (size_t i = 0; i < particles_size(&s); i++) x[i] += vx[i] * dt;
+//   particles_erase_swap(&s, 0);
+//   particles_destroy(&s);
+//
+// Notes:
+// - Growth moves all columns: column pointers must be reloaded after push/reserve.
+// - Thread safety is up to the caller.
+//
+#ifndef DG_SOA_H
+#define DG_SOA_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef DG_SOA_MALLOC
+#  define DG_SOA_MALLOC(sz) malloc(sz)
+#endif
+#ifndef DG_SOA_FREE
+#  define DG_SOA_FREE(p) free(p)
+#endif
+
+// Column alignment in bytes (power of two), read where DG_SOA_IMPL expands
+#ifndef DG_SOA_ALIGN
+#  define DG_SOA_ALIGN 64
+#endif
+
+// Capacity of the first allocation made by a push into an empty container
+#ifndef DG_SOA_MIN_CAP
+#  define DG_SOA_MIN_CAP 16
+#endif
+
+// --- field list iteration: DG__SOA_FOREACH(M, (T,f), ...) expands to M((T,f)) ... -------
+// DG__SOA_EXPAND forces a rescan so MSVC's traditional preprocessor splits __VA_ARGS__.
+#define DG__SOA_EXPAND(x) x
+#define DG__SOA_CAT_(a, b) a##b
+#define DG__SOA_CAT(a, b) DG__SOA_CAT_(a, b)
+#define DG__SOA_NARGS_(_1,_2,_3,_4,_5,_6,_7,_8,_9,_10,_11,_12,_13,_14,_15,_16,N,...) N
+#define DG__SOA_NARGS(...) \
+    DG__SOA_EXPAND(DG__SOA_NARGS_(__VA_ARGS__,16,15,14,13,12,11,10,9,8,7,6,5,4,3,2,1))
+#define DG__SOA_FE_1(M, a) M(a)
+#define DG__SOA_FE_2(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_1(M, __VA_ARGS__))
+#define DG__SOA_FE_3(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_2(M, __VA_ARGS__))
+#define DG__SOA_FE_4(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_3(M, __VA_ARGS__))
+#define DG__SOA_FE_5(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_4(M, __VA_ARGS__))
+#define DG__SOA_FE_6(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_5(M, __VA_ARGS__))
+#define DG__SOA_FE_7(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_6(M, __VA_ARGS__))
+#define DG__SOA_FE_8(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_7(M, __VA_ARGS__))
+#define DG__SOA_FE_9(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_8(M, __VA_ARGS__))
+#define DG__SOA_FE_10(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_9(M, __VA_ARGS__))
+#define DG__SOA_FE_11(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_10(M, __VA_ARGS__))
+#define DG__SOA_FE_12(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_11(M, __VA_ARGS__))
+#define DG__SOA_FE_13(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_12(M, __VA_ARGS__))
+#define DG__SOA_FE_14(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_13(M, __VA_ARGS__))
+#define DG__SOA_FE_15(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_14(M, __VA_ARGS__))
+#define DG__SOA_FE_16(M, a, ...) M(a) DG__SOA_EXPAND(DG__SOA_FE_15(M, __VA_ARGS__))
+#define DG__SOA_FOREACH(M, ...) \
+    DG__SOA_EXPAND(DG__SOA_CAT(DG__SOA_FE_, DG__SOA_NARGS(__VA_ARGS__))(M, __VA_ARGS__))
+
+// per-field fragments, TF is a (type, name) pair; bodies use the locals of DG_SOA_IMPL
+#define DG__SOA_COLUMN_(T, f) T* f;
+#define DG__SOA_COLUMN(TF) DG__SOA_COLUMN_ TF
+#define DG__SOA_ROWFIELD_(T, f) T f;
+#define DG__SOA_ROWFIELD(TF) DG__SOA_ROWFIELD_ TF
+#define DG__SOA_ROWBYTES_(T, f) + sizeof(T)
+#define DG__SOA_ROWBYTES(TF) DG__SOA_ROWBYTES_ TF
+#define DG__SOA_PUT_(T, f) s->f[i] = r->f;
+#define DG__SOA_PUT(TF) DG__SOA_PUT_ TF
+#define DG__SOA_GET_(T, f) r->f = s->f[i];
+#define DG__SOA_GET(TF) DG__SOA_GET_ TF
+#define DG__SOA_MOVE_(T, f) s->f[i] = s->f[j];
+#define DG__SOA_MOVE(TF) DG__SOA_MOVE_ TF
+#define DG__SOA_SWAP_(T, f) { T t_ = s->f[i]; s->f[i] = s->f[j]; s->f[j] = t_; }
+#define DG__SOA_SWAP(TF) DG__SOA_SWAP_ TF
+#define DG__SOA_PLACE_(T, f) \
+    off = (off + DG_SOA_ALIGN - 1) & ~(size_t)(DG_SOA_ALIGN - 1); \
+    n.f = (T*)(base + off); \
+    if (s->size) memcpy(n.f, s->f, s->size * sizeof(T)); \
+    off += cap * sizeof(T);
+#define DG__SOA_PLACE(TF) DG__SOA_PLACE_ TF
+
+// Declarations generator, also defines the inline hot paths
+#define DG_SOA_DECL(NAME, ...) \
+    typedef struct NAME##_row { \
+        DG__SOA_FOREACH(DG__SOA_ROWFIELD, __VA_ARGS__) \
+    } NAME##_row; \
+    typedef struct NAME { \
+        size_t size; \
+        size_t cap; \
+        void* block; /* allocation holding all columns */ \
+        DG__SOA_FOREACH(DG__SOA_COLUMN, __VA_ARGS__) \
+    } NAME; \
+    int  NAME##_init(NAME* s, size_t initial_capacity); \
+    void NAME##_destroy(NAME* s); \
+    /* capacity of exactly n rows unless already larger, moves all columns */ \
+    int  NAME##_reserve(NAME* s, size_t n); \
+    int  NAME##__grow_(NAME* s, size_t min_cap); \
+    static inline size_t NAME##_size(const NAME* s) { return s->size; } \
+    static inline size_t NAME##_capacity(const NAME* s) { return s->cap; } \
+    static inline void NAME##_clear(NAME* s) { s->size = 0; } \
+    static inline int NAME##_push(NAME* s, const NAME##_row* r) { \
+        size_t i = s->size; \
+        if (i == s->cap && !NAME##__grow_(s, i + 1)) return 0; \
+        DG__SOA_FOREACH(DG__SOA_PUT, __VA_ARGS__) \
+        s->size = i + 1; \
+        return 1; \
+    } \
+    static inline void NAME##_get(const NAME* s, size_t i, NAME##_row* r) { \
+        assert(i < s->size); \
+        DG__SOA_FOREACH(DG__SOA_GET, __VA_ARGS__) \
+    } \
+    static inline void NAME##_set(NAME* s, size_t i, const NAME##_row* r) { \
+        assert(i < s->size); \
+        DG__SOA_FOREACH(DG__SOA_PUT, __VA_ARGS__) \
+    } \
+    static inline void NAME##_swap(NAME* s, size_t i, size_t j) { \
+        assert(i < s->size && j < s->size); \
+        DG__SOA_FOREACH(DG__SOA_SWAP, __VA_ARGS__) \
+    } \
+    /* moves the last row into row i */ \
+    static inline void NAME##_erase_swap(NAME* s, size_t i) { \
+        size_t j = s->size - 1; \
+        assert(i < s->size); \
+        if (i != j) { DG__SOA_FOREACH(DG__SOA_MOVE, __VA_ARGS__) } \
+        s->size = j; \
+    }
+
+// Implementation generator
+#define DG_SOA_IMPL(NAME, ...) \
+    /* moves the columns into a new block of cap rows, the container is unchanged on failure */ \
+    static int NAME##__set_cap_(NAME* s, size_t cap) { \
+        const size_t rowbytes = 0 DG__SOA_FOREACH(DG__SOA_ROWBYTES, __VA_ARGS__); \
+        const size_t slack = (size_t)DG_SOA_ALIGN * (DG__SOA_NARGS(__VA_ARGS__) + 1); \
+        if (cap > (SIZE_MAX - slack) / rowbytes) return 0; \
+        uint8_t* raw = (uint8_t*)DG_SOA_MALLOC(cap * rowbytes + slack); \
+        if (!raw) return 0; \
+        uint8_t* base = (uint8_t*)(((uintptr_t)raw + DG_SOA_ALIGN - 1) & ~(uintptr_t)(DG_SOA_ALIGN - 1)); \
+        size_t off = 0; \
+        NAME n = *s; \
+        DG__SOA_FOREACH(DG__SOA_PLACE, __VA_ARGS__) \
+        DG_SOA_FREE(s->block); \
+        n.block = raw; \
+        n.cap = cap; \
+        *s = n; \
+        return 1; \
+    } \
+    int NAME##__grow_(NAME* s, size_t min_cap) { \
+        size_t cap = s->cap * 2; \
+        if (cap < s->cap) cap = min_cap; /* wrapped */ \
+        if (cap < DG_SOA_MIN_CAP) cap = DG_SOA_MIN_CAP; \
+        if (cap < min_cap) cap = min_cap; \
+        return NAME##__set_cap_(s, cap); \
+    } \
+    int NAME##_init(NAME* s, size_t initial_capacity) { \
+        if (!s) return 0; \
+        memset(s, 0, sizeof(*s)); \
+        return initial_capacity ? NAME##__set_cap_(s, initial_capacity) : 1; \
+    } \
+    void NAME##_destroy(NAME* s) { \
+        if (!s) return; \
+        DG_SOA_FREE(s->block); \
+        memset(s, 0, sizeof(*s)); \
+    } \
+    int NAME##_reserve(NAME* s, size_t n) { \
+        return n <= s->cap ? 1 : NAME##__set_cap_(s, n); \
+    }
+
+#endif
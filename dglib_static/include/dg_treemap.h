@@ -9,6 +9,31 @@
 // - Erase-during-iteration is trivial and doesn't trigger rehash/moves
 // - Stable iterators unless you erase the pointed node
 //
+// Node storage:
+// - All nodes of a map live in one array and link by 32-bit index (0 = nil), the color
+//   is the top bit of the parent index: 12 bytes of links per node instead of 3 pointers
+//   and a flag. Erased nodes are reused through a free list, no malloc per insert.
+// - NAME_reserve sizes the array once; NAME_compact renumbers the nodes in key order,
+//   so in-order iteration walks memory sequentially.
+// - Iterators are node indices (0 = end) and stay valid across inserts. Pointers from
+//   NAME_get_ref/NAME_iter_key/NAME_iter_val are invalidated by inserts (the array may
+//   grow) and by NAME_compact, which invalidates iterators as well.
+// - At most 2^31 - 1 nodes per map.
+//
+// Bulk construction:
+// - NAME_build_sorted replaces the map with n strictly ascending pairs in O(n): nodes are
+//   written in key order (like NAME_compact) and linked as a perfectly balanced tree, the
+//   deepest, incomplete level red. No comparisons besides the order check, no rotations.
+// - NAME_merge moves all pairs of src into dst in O(|dst| + |src|) by walking both trees
+//   in order and rebuilding dst the same way. On equal keys src's value wins, as with
+//   NAME_insert (dst key and src value are kept, the other two are freed by the hooks).
+//
+// Order statistics (optional):
+// - DG_TMAP_DECL_OS/DG_TMAP_IMPL_OS add a subtree node count to every node (4 bytes), kept
+//   up to date by rotations, insert and erase, and generate NAME_select (k-th key),
+//   NAME_rank (keys below a key) and NAME_count_range (keys in [lo, hi)), all O(log N).
+//   Without _OS the counters and their upkeep compile away.
+//
 // API is macro-generated per (K,V) pair with a user-supplied comparator CMP(a,b):
 //   <0 if a<b, 0 if equal, >0 if a>b.
 // Optional KEYFREE/VALFREE hooks via _EX variant.
@@ -23,7 +48,7 @@
 //   void *p=(void*)123; u64_to_ptr_insert(&m,(Key){42}, &p, NULL);
 //   void **pref = u64_to_ptr_get_ref(&m,(Key){42});
 //   for (u64_to_ptr_it it=u64_to_ptr_iter_begin(&m); it; ) {
-//       if (*u64_to_ptr_iter_val(&m,it)==p) it = u64_to_ptr_erase_at(&m,it); else it=u64_to_ptr_iter_next(it);
+//       if (*u64_to_ptr_iter_val(&m,it)==p) it = u64_to_ptr_erase_at(&m,it); else it=u64_to_ptr_iter_next(&m,it);
 //   }
 //   u64_to_ptr_destroy(&m);
 //
@@ -33,6 +58,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef DG_TMAP_MALLOC
 #  define DG_TMAP_MALLOC(sz) malloc(sz)
@@ -40,20 +66,38 @@
 #ifndef DG_TMAP_FREE
 #  define DG_TMAP_FREE(p) free(p)
 #endif
+#ifndef DG_TMAP_REALLOC
+#  define DG_TMAP_REALLOC(p,sz) realloc(p,sz)
+#endif
 
 #define DG__NOOP_FREE(p) ((void)0)
 
+#define DG__TMAP_RED       0x80000000u /* color bit of node parent field */
+#define DG__TMAP_MAX_SLOTS 0x80000000u /* node indices are 31-bit, slot 0 is nil */
+
 // Declarations generator
 #define DG_TMAP_DECL(NAME, K, V) \
     typedef struct NAME NAME; \
     typedef struct NAME##_node NAME##_node; \
-    typedef NAME##_node* NAME##_it; \
-    struct NAME { NAME##_node* root; size_t size; }; \
+    typedef uint32_t NAME##_it; /* node index, 0 = end */ \
+    struct NAME { \
+        NAME##_node* nodes; /* nodes[0] is nil: no links, black */ \
+        uint32_t root; \
+        uint32_t free_head; /* erased nodes, linked through left */ \
+        uint32_t used; /* slots handed out, nil included */ \
+        uint32_t cap; \
+        size_t size; \
+    }; \
     /* basic ops */ \
     int  NAME##_init(NAME* m); \
     void NAME##_clear(NAME* m); \
     void NAME##_destroy(NAME* m); \
     size_t NAME##_size(const NAME* m); \
+    int  NAME##_reserve(NAME* m, size_t n); \
+    int  NAME##_compact(NAME* m); \
+    /* bulk */ \
+    int  NAME##_build_sorted(NAME* m, const K* keys, const V* vals, size_t n); \
+    int  NAME##_merge(NAME* dst, NAME* src); \
     /* CRUD */ \
     int  NAME##_insert(NAME* m, K key, const V* val, int* replaced); \
     int  NAME##_get(const NAME* m, K key, V* out); \
@@ -62,119 +106,256 @@
     /* iterators (in-order) */ \
     NAME##_it NAME##_iter_begin(const NAME* m); \
     NAME##_it NAME##_iter_end(const NAME* m); \
-    NAME##_it NAME##_iter_next(NAME##_it it); \
-    NAME##_it NAME##_iter_prev(NAME##_it it); \
-    K* NAME##_iter_key(NAME##_it it); \
-    V* NAME##_iter_val(NAME##_it it); \
+    NAME##_it NAME##_iter_next(const NAME* m, NAME##_it it); \
+    NAME##_it NAME##_iter_prev(const NAME* m, NAME##_it it); \
+    K* NAME##_iter_key(const NAME* m, NAME##_it it); \
+    V* NAME##_iter_val(const NAME* m, NAME##_it it); \
     NAME##_it NAME##_erase_at(NAME* m, NAME##_it it); \
     /* bounds */ \
     NAME##_it NAME##_lower_bound(const NAME* m, K key); \
     NAME##_it NAME##_upper_bound(const NAME* m, K key);
 
+// Declarations with order statistics, pair with DG_TMAP_IMPL_OS
+#define DG_TMAP_DECL_OS(NAME, K, V) \
+    DG_TMAP_DECL(NAME, K, V) \
+    NAME##_it NAME##_select(const NAME* m, size_t k); \
+    size_t NAME##_rank(const NAME* m, K key); \
+    size_t NAME##_count_range(const NAME* m, K lo, K hi);
+
 // Implementation generator (default free hooks = no-op)
 #define DG_TMAP_IMPL(NAME, K, V, CMPFN) \
     DG_TMAP_IMPL_EX(NAME, K, V, CMPFN, DG__NOOP_FREE, DG__NOOP_FREE)
 
 #define DG_TMAP_IMPL_EX(NAME, K, V, CMPFN, KEYFREE, VALFREE) \
+    DG__TMAP_IMPL_(NAME, K, V, CMPFN, KEYFREE, VALFREE, 0)
+
+// Implementation with order statistics
+#define DG_TMAP_IMPL_OS(NAME, K, V, CMPFN) \
+    DG_TMAP_IMPL_OS_EX(NAME, K, V, CMPFN, DG__NOOP_FREE, DG__NOOP_FREE)
+
+#define DG_TMAP_IMPL_OS_EX(NAME, K, V, CMPFN, KEYFREE, VALFREE) \
+    DG__TMAP_IMPL_(NAME, K, V, CMPFN, KEYFREE, VALFREE, 1) \
+    NAME##_it NAME##_select(const NAME* m, size_t k){ if(!m || k >= m->size) return 0; const NAME##_node* N=m->nodes; uint32_t cur=m->root; \
+        for(;;){ size_t l=N[N[cur].left].count; if(k < l) cur=N[cur].left; else if(k == l) return cur; else { k -= l + 1; cur=N[cur].right; } } } \
+    size_t NAME##_rank(const NAME* m, K key){ if(!m) return 0; const NAME##_node* N=m->nodes; uint32_t cur=m->root; size_t r=0; \
+        while(cur){ if(CMPFN(key,N[cur].key) <= 0) cur=N[cur].left; else { r += (size_t)N[N[cur].left].count + 1; cur=N[cur].right; } } return r; } \
+    size_t NAME##_count_range(const NAME* m, K lo, K hi){ if(!m || CMPFN(lo,hi) >= 0) return 0; return NAME##_rank(m,hi) - NAME##_rank(m,lo); }
+
+/* subtree counters: field and upkeep for CNT = 1, nothing for CNT = 0 */
+#define DG__TMAP_CNT_FIELD_0
+#define DG__TMAP_CNT_FIELD_1 uint32_t count; /* nodes in this subtree, 0 for nil */
+#define DG__TMAP_CNT_OPS_0(NAME) \
+    static inline void NAME##__upd_cnt_(NAME##_node* N, uint32_t n){ (void)N; (void)n; } \
+    static inline void NAME##__set_cnt_(NAME##_node* N, uint32_t n, size_t c){ (void)N; (void)n; (void)c; } \
+    static inline void NAME##__path_cnt_(NAME##_node* N, uint32_t n, uint32_t d){ (void)N; (void)n; (void)d; }
+#define DG__TMAP_CNT_OPS_1(NAME) \
+    static inline void NAME##__upd_cnt_(NAME##_node* N, uint32_t n){ N[n].count = N[N[n].left].count + N[N[n].right].count + 1; } \
+    static inline void NAME##__set_cnt_(NAME##_node* N, uint32_t n, size_t c){ N[n].count = (uint32_t)c; } \
+    /* adds d (1 or (uint32_t)-1) from n up to the root */ \
+    static inline void NAME##__path_cnt_(NAME##_node* N, uint32_t n, uint32_t d){ for(; n; n=NAME##__par_(N,n)) N[n].count += d; }
+
+#define DG__TMAP_IMPL_(NAME, K, V, CMPFN, KEYFREE, VALFREE, CNT) \
     struct NAME##_node { \
         K key; V val; \
-        struct NAME##_node *left, *right, *parent; \
-        unsigned char red; /* 1=red, 0=black */ \
+        uint32_t left, right; \
+        uint32_t parent; /* parent index | DG__TMAP_RED */ \
+        DG__TMAP_CNT_FIELD_##CNT \
     }; \
-    static inline NAME##_it NAME##__min_(NAME##_it n){ if(!n) return NULL; while(n->left) n=n->left; return n; } \
-    static inline NAME##_it NAME##__max_(NAME##_it n){ if(!n) return NULL; while(n->right) n=n->right; return n; } \
-    static inline NAME##_it NAME##__succ_(NAME##_it n){ if(!n) return NULL; if(n->right) return NAME##__min_(n->right); \
-        NAME##_it p=n->parent; while(p && n==p->right){ n=p; p=p->parent; } return p; } \
-    static inline NAME##_it NAME##__pred_(NAME##_it n){ if(!n) return NULL; if(n->left) return NAME##__max_(n->left); \
-        NAME##_it p=n->parent; while(p && n==p->left){ n=p; p=p->parent; } return p; } \
-    static inline void NAME##__rotate_left_(NAME* m, NAME##_it x){ \
-        NAME##_it y=x->right; x->right=y->left; if(y->left) y->left->parent=x; \
-        y->parent=x->parent; \
-        if(!x->parent) m->root=y; else if(x==x->parent->left) x->parent->left=y; else x->parent->right=y; \
-        y->left=x; x->parent=y; } \
-    static inline void NAME##__rotate_right_(NAME* m, NAME##_it x){ \
-        NAME##_it y=x->left; x->left=y->right; if(y->right) y->right->parent=x; \
-        y->parent=x->parent; \
-        if(!x->parent) m->root=y; else if(x==x->parent->right) x->parent->right=y; else x->parent->left=y; \
-        y->right=x; x->parent=y; } \
-    static void NAME##__insert_fix_(NAME* m, NAME##_it z){ \
-        while(z->parent && z->parent->red){ \
-            NAME##_it p=z->parent; NAME##_it g=p->parent; \
-            if(p==g->left){ NAME##_it y=g->right; \
-                if(y && y->red){ p->red=0; y->red=0; g->red=1; z=g; } \
-                else { if(z==p->right){ z=p; NAME##__rotate_left_(m,z); p=z->parent; g=p->parent; } \
-                       p->red=0; g->red=1; NAME##__rotate_right_(m,g); } \
-            } else { NAME##_it y=g->left; \
-                if(y && y->red){ p->red=0; y->red=0; g->red=1; z=g; } \
-                else { if(z==p->left){ z=p; NAME##__rotate_right_(m,z); p=z->parent; g=p->parent; } \
-                       p->red=0; g->red=1; NAME##__rotate_left_(m,g); } \
+    static inline uint32_t NAME##__par_(const NAME##_node* N, uint32_t n){ return N[n].parent & ~DG__TMAP_RED; } \
+    DG__TMAP_CNT_OPS_##CNT(NAME) \
+    static inline int NAME##__red_(const NAME##_node* N, uint32_t n){ return (N[n].parent & DG__TMAP_RED) != 0; } \
+    static inline void NAME##__set_par_(NAME##_node* N, uint32_t n, uint32_t p){ N[n].parent = (N[n].parent & DG__TMAP_RED) | p; } \
+    static inline void NAME##__set_red_(NAME##_node* N, uint32_t n, int red){ if(red) N[n].parent |= DG__TMAP_RED; else N[n].parent &= ~DG__TMAP_RED; } \
+    static inline uint32_t NAME##__min_(const NAME##_node* N, uint32_t n){ if(!n) return 0; while(N[n].left) n=N[n].left; return n; } \
+    static inline uint32_t NAME##__max_(const NAME##_node* N, uint32_t n){ if(!n) return 0; while(N[n].right) n=N[n].right; return n; } \
+    static inline uint32_t NAME##__succ_(const NAME##_node* N, uint32_t n){ if(!n) return 0; if(N[n].right) return NAME##__min_(N,N[n].right); \
+        uint32_t p=NAME##__par_(N,n); while(p && n==N[p].right){ n=p; p=NAME##__par_(N,p); } return p; } \
+    static inline uint32_t NAME##__pred_(const NAME##_node* N, uint32_t n){ if(!n) return 0; if(N[n].left) return NAME##__max_(N,N[n].left); \
+        uint32_t p=NAME##__par_(N,n); while(p && n==N[p].left){ n=p; p=NAME##__par_(N,p); } return p; } \
+    static inline void NAME##__rotate_left_(NAME* m, uint32_t x){ NAME##_node* N=m->nodes; \
+        uint32_t y=N[x].right, xp=NAME##__par_(N,x); N[x].right=N[y].left; if(N[y].left) NAME##__set_par_(N,N[y].left,x); \
+        NAME##__set_par_(N,y,xp); \
+        if(!xp) m->root=y; else if(x==N[xp].left) N[xp].left=y; else N[xp].right=y; \
+        N[y].left=x; NAME##__set_par_(N,x,y); NAME##__upd_cnt_(N,x); NAME##__upd_cnt_(N,y); } \
+    static inline void NAME##__rotate_right_(NAME* m, uint32_t x){ NAME##_node* N=m->nodes; \
+        uint32_t y=N[x].left, xp=NAME##__par_(N,x); N[x].left=N[y].right; if(N[y].right) NAME##__set_par_(N,N[y].right,x); \
+        NAME##__set_par_(N,y,xp); \
+        if(!xp) m->root=y; else if(x==N[xp].right) N[xp].right=y; else N[xp].left=y; \
+        N[y].right=x; NAME##__set_par_(N,x,y); NAME##__upd_cnt_(N,x); NAME##__upd_cnt_(N,y); } \
+    static void NAME##__insert_fix_(NAME* m, uint32_t z){ NAME##_node* N=m->nodes; \
+        while(NAME##__red_(N,NAME##__par_(N,z))){ \
+            uint32_t p=NAME##__par_(N,z), g=NAME##__par_(N,p); \
+            if(p==N[g].left){ uint32_t y=N[g].right; \
+                if(NAME##__red_(N,y)){ NAME##__set_red_(N,p,0); NAME##__set_red_(N,y,0); NAME##__set_red_(N,g,1); z=g; } \
+                else { if(z==N[p].right){ z=p; NAME##__rotate_left_(m,z); p=NAME##__par_(N,z); g=NAME##__par_(N,p); } \
+                       NAME##__set_red_(N,p,0); NAME##__set_red_(N,g,1); NAME##__rotate_right_(m,g); } \
+            } else { uint32_t y=N[g].left; \
+                if(NAME##__red_(N,y)){ NAME##__set_red_(N,p,0); NAME##__set_red_(N,y,0); NAME##__set_red_(N,g,1); z=g; } \
+                else { if(z==N[p].left){ z=p; NAME##__rotate_right_(m,z); p=NAME##__par_(N,z); g=NAME##__par_(N,p); } \
+                       NAME##__set_red_(N,p,0); NAME##__set_red_(N,g,1); NAME##__rotate_left_(m,g); } \
             } \
         } \
-        m->root->red=0; \
+        NAME##__set_red_(N,m->root,0); \
     } \
-    static void NAME##__transplant_(NAME* m, NAME##_it u, NAME##_it v){ \
-        if(!u->parent) m->root=v; else if(u==u->parent->left) u->parent->left=v; else u->parent->right=v; \
-        if(v) v->parent=u->parent; \
+    static void NAME##__transplant_(NAME* m, uint32_t u, uint32_t v){ NAME##_node* N=m->nodes; uint32_t up=NAME##__par_(N,u); \
+        if(!up) m->root=v; else if(u==N[up].left) N[up].left=v; else N[up].right=v; \
+        if(v) NAME##__set_par_(N,v,up); \
     } \
-    static void NAME##__erase_fix_(NAME* m, NAME##_it x, NAME##_it xparent){ \
-        while( (x!=m->root) && (!x || !x->red) ){ \
-            if(x == (xparent?xparent->left:NULL)){ NAME##_it w = xparent?xparent->right:NULL; \
-                if(w && w->red){ w->red=0; if(xparent) xparent->red=1; NAME##__rotate_left_(m,xparent); w = xparent?xparent->right:NULL; } \
-                if( (!w->left || !w->left->red) && (!w->right || !w->right->red) ){ if(w) w->red=1; x=xparent; xparent=xparent?xparent->parent:NULL; } \
-                else { if(!w->right || !w->right->red){ if(w->left) w->left->red=0; if(w){ w->red=1; NAME##__rotate_right_(m,w);} w=xparent?xparent->right:NULL; } \
-                       if(w) w->red = xparent?xparent->red:0; if(xparent) xparent->red=0; if(w && w->right) w->right->red=0; NAME##__rotate_left_(m,xparent); x=m->root; xparent=NULL; } \
-            } else { NAME##_it w = xparent?xparent->left:NULL; \
-                if(w && w->red){ w->red=0; if(xparent) xparent->red=1; NAME##__rotate_right_(m,xparent); w = xparent?xparent->left:NULL; } \
-                if( (!w->right || !w->right->red) && (!w->left || !w->left->red) ){ if(w) w->red=1; x=xparent; xparent=xparent?xparent->parent:NULL; } \
-                else { if(!w->left || !w->left->red){ if(w->right) w->right->red=0; if(w){ w->red=1; NAME##__rotate_left_(m,w);} w=xparent?xparent->left:NULL; } \
-                       if(w) w->red = xparent?xparent->red:0; if(xparent) xparent->red=0; if(w && w->left) w->left->red=0; NAME##__rotate_right_(m,xparent); x=m->root; xparent=NULL; } \
+    /* nil is never written: its links and color stay 0 */ \
+    static void NAME##__erase_fix_(NAME* m, uint32_t x, uint32_t xparent){ NAME##_node* N=m->nodes; \
+        while( (x!=m->root) && !NAME##__red_(N,x) ){ \
+            if(x == N[xparent].left){ uint32_t w = N[xparent].right; \
+                if(NAME##__red_(N,w)){ NAME##__set_red_(N,w,0); NAME##__set_red_(N,xparent,1); NAME##__rotate_left_(m,xparent); w = N[xparent].right; } \
+                if( !NAME##__red_(N,N[w].left) && !NAME##__red_(N,N[w].right) ){ if(w) NAME##__set_red_(N,w,1); x=xparent; xparent=NAME##__par_(N,xparent); } \
+                else { if(!NAME##__red_(N,N[w].right)){ if(N[w].left) NAME##__set_red_(N,N[w].left,0); NAME##__set_red_(N,w,1); NAME##__rotate_right_(m,w); w=N[xparent].right; } \
+                       NAME##__set_red_(N,w,NAME##__red_(N,xparent)); NAME##__set_red_(N,xparent,0); if(N[w].right) NAME##__set_red_(N,N[w].right,0); NAME##__rotate_left_(m,xparent); x=m->root; xparent=0; } \
+            } else { uint32_t w = N[xparent].left; \
+                if(NAME##__red_(N,w)){ NAME##__set_red_(N,w,0); NAME##__set_red_(N,xparent,1); NAME##__rotate_right_(m,xparent); w = N[xparent].left; } \
+                if( !NAME##__red_(N,N[w].right) && !NAME##__red_(N,N[w].left) ){ if(w) NAME##__set_red_(N,w,1); x=xparent; xparent=NAME##__par_(N,xparent); } \
+                else { if(!NAME##__red_(N,N[w].left)){ if(N[w].right) NAME##__set_red_(N,N[w].right,0); NAME##__set_red_(N,w,1); NAME##__rotate_left_(m,w); w=N[xparent].left; } \
+                       NAME##__set_red_(N,w,NAME##__red_(N,xparent)); NAME##__set_red_(N,xparent,0); if(N[w].left) NAME##__set_red_(N,N[w].left,0); NAME##__rotate_right_(m,xparent); x=m->root; xparent=0; } \
             } \
         } \
-        if(x) x->red=0; \
+        if(x) NAME##__set_red_(N,x,0); \
     } \
-    int NAME##_init(NAME* m){ if(!m) return 0; m->root=NULL; m->size=0; return 1; } \
+    /* node array grows geometrically to at least want slots (nil included) */ \
+    static int NAME##__grow_(NAME* m, size_t want){ \
+        if(want <= m->cap) return 1; \
+        if(want > DG__TMAP_MAX_SLOTS) return 0; \
+        size_t ncap = m->cap ? m->cap : 16; while(ncap < want) ncap *= 2; if(ncap > DG__TMAP_MAX_SLOTS) ncap = DG__TMAP_MAX_SLOTS; \
+        NAME##_node* p = (NAME##_node*)DG_TMAP_REALLOC(m->nodes, ncap*sizeof(NAME##_node)); if(!p) return 0; \
+        if(!m->nodes) memset(p, 0, sizeof(NAME##_node)); \
+        m->nodes=p; m->cap=(uint32_t)ncap; return 1; \
+    } \
+    static uint32_t NAME##__alloc_node_(NAME* m){ \
+        if(m->free_head){ uint32_t n=m->free_head; m->free_head=m->nodes[n].left; return n; } \
+        if(m->used >= m->cap && !NAME##__grow_(m, (size_t)m->used + 1)) return 0; \
+        return m->used++; \
+    } \
+    static inline void NAME##__free_node_(NAME* m, uint32_t n){ \
+        KEYFREE(&m->nodes[n].key); VALFREE(&m->nodes[n].val); \
+        m->nodes[n].left=m->free_head; m->nodes[n].parent=0; m->free_head=n; \
+    } \
+    int NAME##_init(NAME* m){ if(!m) return 0; memset(m, 0, sizeof(*m)); m->used=1; return 1; } \
     void NAME##_clear(NAME* m){ if(!m) return; \
         NAME##_it it = NAME##_iter_begin(m); \
-        while(it){ NAME##_it nxt = NAME##_iter_next(it); KEYFREE(&it->key); VALFREE(&it->val); DG_TMAP_FREE(it); it = nxt; } \
-        m->root=NULL; m->size=0; \
+        while(it){ NAME##_it nxt = NAME##__succ_(m->nodes,it); KEYFREE(&m->nodes[it].key); VALFREE(&m->nodes[it].val); it = nxt; } \
+        m->root=0; m->free_head=0; m->used=1; m->size=0; \
     } \
-    void NAME##_destroy(NAME* m){ if(!m) return; NAME##_clear(m); } \
+    void NAME##_destroy(NAME* m){ if(!m) return; NAME##_clear(m); DG_TMAP_FREE(m->nodes); m->nodes=NULL; m->cap=0; } \
     size_t NAME##_size(const NAME* m){ return m?m->size:0; } \
-    static NAME##_it NAME##__find_node_(const NAME* m, K key){ NAME##_it cur=m?m->root:NULL; while(cur){ int c=CMPFN(key,cur->key); if(c==0) return cur; cur = (c<0)?cur->left:cur->right; } return NULL; } \
-    int NAME##_get(const NAME* m, K key, V* out){ NAME##_it n=NAME##__find_node_(m,key); if(!n) return 0; if(out) *out=n->val; return 1; } \
-    V* NAME##_get_ref(NAME* m, K key){ NAME##_it n=NAME##__find_node_(m,key); return n?&n->val:NULL; } \
+    int NAME##_reserve(NAME* m, size_t n){ if(!m) return 0; return NAME##__grow_(m, n + 1); } \
+    /* moves nodes into key order in a fresh array of exactly size + 1 slots */ \
+    int NAME##_compact(NAME* m){ \
+        if(!m) return 0; \
+        NAME##_node* N=m->nodes; \
+        NAME##_node* D=(NAME##_node*)DG_TMAP_MALLOC((m->size + 1)*sizeof(NAME##_node)); \
+        uint32_t* remap=(uint32_t*)DG_TMAP_MALLOC((size_t)m->used*sizeof(uint32_t)); \
+        if(!D || !remap){ DG_TMAP_FREE(D); DG_TMAP_FREE(remap); return 0; } \
+        uint32_t r=0; remap[0]=0; \
+        for(uint32_t n=NAME##__min_(N,m->root); n; n=NAME##__succ_(N,n)) remap[n]=++r; \
+        memset(D, 0, sizeof(NAME##_node)); \
+        for(uint32_t n=NAME##__min_(N,m->root); n; n=NAME##__succ_(N,n)){ \
+            NAME##_node* d=D + remap[n]; *d=N[n]; \
+            d->left=remap[N[n].left]; d->right=remap[N[n].right]; \
+            d->parent=remap[NAME##__par_(N,n)] | (N[n].parent & DG__TMAP_RED); \
+        } \
+        m->root=remap[m->root]; \
+        DG_TMAP_FREE(remap); DG_TMAP_FREE(N); \
+        m->nodes=D; m->cap=r + 1; m->used=r + 1; m->free_head=0; \
+        return 1; \
+    } \
+    /* links slots lo+1..hi of D (in key order) as a balanced subtree; nodes below the last full level are red */ \
+    static uint32_t NAME##__build_(NAME##_node* D, size_t lo, size_t hi, uint32_t parent, unsigned depth, unsigned full){ \
+        if(lo >= hi) return 0; \
+        size_t mid = lo + (hi - lo)/2; uint32_t n=(uint32_t)(mid + 1); \
+        D[n].parent = parent | (depth >= full ? DG__TMAP_RED : 0); NAME##__set_cnt_(D, n, hi - lo); \
+        D[n].left = NAME##__build_(D, lo, mid, n, depth + 1, full); \
+        D[n].right = NAME##__build_(D, mid + 1, hi, n, depth + 1, full); \
+        return n; \
+    } \
+    /* takes D as the node array, slots 1..n hold the pairs in key order; old nodes must be released by the caller */ \
+    static void NAME##__adopt_(NAME* m, NAME##_node* D, size_t n, size_t cap){ \
+        unsigned full=0; while(((size_t)2 << full) - 1 <= n) full++; /* full levels: floor(log2(n + 1)) */ \
+        memset(D, 0, sizeof(NAME##_node)); \
+        m->nodes=D; m->cap=(uint32_t)cap; m->used=(uint32_t)(n + 1); m->free_head=0; m->size=n; \
+        m->root=NAME##__build_(D, 0, n, 0, 0, full); \
+    } \
+    /* the current node array is reused if it is large enough, one allocation otherwise */ \
+    int NAME##_build_sorted(NAME* m, const K* keys, const V* vals, size_t n){ \
+        if(!m || (n && (!keys || !vals)) || n >= DG__TMAP_MAX_SLOTS) return 0; \
+        for(size_t i=1; i<n; ++i) if(CMPFN(keys[i-1],keys[i]) >= 0) return 0; \
+        NAME##_node* D=NULL; size_t cap=m->cap; \
+        if(n >= cap){ cap=n + 1; D=(NAME##_node*)DG_TMAP_MALLOC(cap*sizeof(NAME##_node)); if(!D) return 0; } \
+        NAME##_clear(m); \
+        if(D){ DG_TMAP_FREE(m->nodes); } else D=m->nodes; \
+        for(size_t i=0; i<n; ++i){ D[i + 1].key=keys[i]; D[i + 1].val=vals[i]; } \
+        NAME##__adopt_(m, D, n, cap); \
+        return 1; \
+    } \
+    int NAME##_merge(NAME* dst, NAME* src){ \
+        if(!dst || !src) return 0; \
+        if(dst == src || !src->size) return 1; \
+        size_t total = dst->size + src->size; \
+        if(total >= DG__TMAP_MAX_SLOTS) return 0; \
+        NAME##_node* D=(NAME##_node*)DG_TMAP_MALLOC((total + 1)*sizeof(NAME##_node)); \
+        if(!D) return 0; \
+        NAME##_node *A=dst->nodes, *B=src->nodes; \
+        uint32_t a=NAME##__min_(A,dst->root), b=NAME##__min_(B,src->root); size_t r=0; \
+        while(a && b){ int c=CMPFN(A[a].key,B[b].key); ++r; \
+            if(c < 0){ D[r].key=A[a].key; D[r].val=A[a].val; a=NAME##__succ_(A,a); } \
+            else if(c > 0){ D[r].key=B[b].key; D[r].val=B[b].val; b=NAME##__succ_(B,b); } \
+            else { KEYFREE(&B[b].key); VALFREE(&A[a].val); D[r].key=A[a].key; D[r].val=B[b].val; a=NAME##__succ_(A,a); b=NAME##__succ_(B,b); } \
+        } \
+        for(; a; a=NAME##__succ_(A,a)){ ++r; D[r].key=A[a].key; D[r].val=A[a].val; } \
+        for(; b; b=NAME##__succ_(B,b)){ ++r; D[r].key=B[b].key; D[r].val=B[b].val; } \
+        DG_TMAP_FREE(A); \
+        NAME##__adopt_(dst, D, r, total + 1); \
+        src->root=0; src->free_head=0; src->used=1; src->size=0; /* pairs moved, no hooks */ \
+        return 1; \
+    } \
+    static uint32_t NAME##__find_node_(const NAME* m, K key){ if(!m) return 0; const NAME##_node* N=m->nodes; uint32_t cur=m->root; \
+        while(cur){ int c=CMPFN(key,N[cur].key); if(c==0) return cur; cur = (c<0)?N[cur].left:N[cur].right; } return 0; } \
+    int NAME##_get(const NAME* m, K key, V* out){ uint32_t n=NAME##__find_node_(m,key); if(!n) return 0; if(out) *out=m->nodes[n].val; return 1; } \
+    V* NAME##_get_ref(NAME* m, K key){ uint32_t n=NAME##__find_node_(m,key); return n?&m->nodes[n].val:NULL; } \
     int NAME##_insert(NAME* m, K key, const V* val, int* replaced){ \
         if(!m) return 0; \
-        NAME##_it y=NULL, x=m->root; \
-        while(x){ y=x; int c=CMPFN(key,x->key); if(c==0){ if(replaced) *replaced=1; VALFREE(&x->val); x->val=*val; return 1; } x = (c<0)?x->left:x->right; } \
-        NAME##_it z=(NAME##_it)DG_TMAP_MALLOC(sizeof(*z)); if(!z) return 0; \
-        z->key=key; z->val=*val; z->left=z->right=NULL; z->parent=y; z->red=1; \
-        if(!y) m->root=z; else { if(CMPFN(key,y->key)<0) y->left=z; else y->right=z; } \
+        NAME##_node* N=m->nodes; uint32_t y=0, x=m->root; int c=0; \
+        while(x){ y=x; c=CMPFN(key,N[x].key); if(c==0){ if(replaced) *replaced=1; VALFREE(&N[x].val); N[x].val=*val; return 1; } x = (c<0)?N[x].left:N[x].right; } \
+        uint32_t z=NAME##__alloc_node_(m); if(!z) return 0; \
+        N=m->nodes; N[z].key=key; N[z].val=*val; N[z].left=N[z].right=0; N[z].parent=y | DG__TMAP_RED; NAME##__set_cnt_(N,z,1); \
+        if(!y) m->root=z; else if(c<0) N[y].left=z; else N[y].right=z; \
+        NAME##__path_cnt_(N,y,1); \
         NAME##__insert_fix_(m,z); m->size++; if(replaced) *replaced=0; return 1; \
     } \
-    static NAME##_it NAME##__erase_node_(NAME* m, NAME##_it z){ \
-        NAME##_it y=z, x=NULL; unsigned char y_red=y->red; NAME##_it xparent=NULL; \
-        if(!z->left){ x=z->right; xparent=z->parent; NAME##__transplant_(m,z,z->right); } \
-        else if(!z->right){ x=z->left; xparent=z->parent; NAME##__transplant_(m,z,z->left); } \
-        else { y=NAME##__min_(z->right); y_red=y->red; x=y->right; \
-            if(y->parent==z){ xparent=y; if(x) x->parent=y; } \
-            else { NAME##__transplant_(m,y,y->right); y->right=z->right; if(y->right) y->right->parent=y; xparent=y->parent; } \
-            NAME##__transplant_(m,z,y); y->left=z->left; if(y->left) y->left->parent=y; y->red=z->red; \
+    static void NAME##__erase_node_(NAME* m, uint32_t z){ NAME##_node* N=m->nodes; \
+        uint32_t y=z, x=0, xparent=0; int y_red=NAME##__red_(N,y); \
+        /* counters: the spliced out position is z or its successor, y inherits z's count */ \
+        NAME##__path_cnt_(N, NAME##__par_(N, (N[z].left && N[z].right) ? NAME##__min_(N,N[z].right) : z), (uint32_t)-1); \
+        if(!N[z].left){ x=N[z].right; xparent=NAME##__par_(N,z); NAME##__transplant_(m,z,N[z].right); } \
+        else if(!N[z].right){ x=N[z].left; xparent=NAME##__par_(N,z); NAME##__transplant_(m,z,N[z].left); } \
+        else { y=NAME##__min_(N,N[z].right); y_red=NAME##__red_(N,y); x=N[y].right; \
+            if(NAME##__par_(N,y)==z){ xparent=y; if(x) NAME##__set_par_(N,x,y); } \
+            else { xparent=NAME##__par_(N,y); NAME##__transplant_(m,y,N[y].right); N[y].right=N[z].right; NAME##__set_par_(N,N[y].right,y); } \
+            NAME##__transplant_(m,z,y); N[y].left=N[z].left; NAME##__set_par_(N,N[y].left,y); NAME##__set_red_(N,y,NAME##__red_(N,z)); \
+            NAME##__upd_cnt_(N,y); \
         } \
         if(!y_red) NAME##__erase_fix_(m,x,xparent); \
-        return z; /* caller frees z */ \
+        /* caller frees z */ \
     } \
-    int NAME##_erase(NAME* m, K key){ if(!m) return 0; NAME##_it z=NAME##__find_node_(m,key); if(!z) return 0; \
-        NAME##_it victim = NAME##__erase_node_(m,z); KEYFREE(&victim->key); VALFREE(&victim->val); DG_TMAP_FREE(victim); m->size--; return 1; } \
-    NAME##_it NAME##_iter_begin(const NAME* m){ return m?NAME##__min_(m->root):NULL; } \
-    NAME##_it NAME##_iter_end(const NAME* m){ (void)m; return NULL; } \
-    NAME##_it NAME##_iter_next(NAME##_it it){ return NAME##__succ_(it); } \
-    NAME##_it NAME##_iter_prev(NAME##_it it){ return NAME##__pred_(it); } \
-    K* NAME##_iter_key(NAME##_it it){ return it?&it->key:NULL; } \
-    V* NAME##_iter_val(NAME##_it it){ return it?&it->val:NULL; } \
-    NAME##_it NAME##_erase_at(NAME* m, NAME##_it it){ if(!m || !it) return NULL; NAME##_it nxt=NAME##__succ_(it); \
-        NAME##_it victim = NAME##__erase_node_(m,it); KEYFREE(&victim->key); VALFREE(&victim->val); DG_TMAP_FREE(victim); m->size--; return nxt; } \
-    NAME##_it NAME##_lower_bound(const NAME* m, K key){ NAME##_it cur=m?m->root:NULL, res=NULL; while(cur){ int c=CMPFN(key,cur->key); if(c<=0){ res=cur; cur=cur->left; } else cur=cur->right; } return res; } \
-    NAME##_it NAME##_upper_bound(const NAME* m, K key){ NAME##_it cur=m?m->root:NULL, res=NULL; while(cur){ int c=CMPFN(key,cur->key); if(c<0){ res=cur; cur=cur->left; } else cur=cur->right; } return res; }
+    int NAME##_erase(NAME* m, K key){ if(!m) return 0; uint32_t z=NAME##__find_node_(m,key); if(!z) return 0; \
+        NAME##__erase_node_(m,z); NAME##__free_node_(m,z); m->size--; return 1; } \
+    NAME##_it NAME##_iter_begin(const NAME* m){ return m?NAME##__min_(m->nodes,m->root):0; } \
+    NAME##_it NAME##_iter_end(const NAME* m){ (void)m; return 0; } \
+    NAME##_it NAME##_iter_next(const NAME* m, NAME##_it it){ return NAME##__succ_(m->nodes,it); } \
+    NAME##_it NAME##_iter_prev(const NAME* m, NAME##_it it){ return NAME##__pred_(m->nodes,it); } \
+    K* NAME##_iter_key(const NAME* m, NAME##_it it){ return it?&m->nodes[it].key:NULL; } \
+    V* NAME##_iter_val(const NAME* m, NAME##_it it){ return it?&m->nodes[it].val:NULL; } \
+    NAME##_it NAME##_erase_at(NAME* m, NAME##_it it){ if(!m || !it) return 0; NAME##_it nxt=NAME##__succ_(m->nodes,it); \
+        NAME##__erase_node_(m,it); NAME##__free_node_(m,it); m->size--; return nxt; } \
+    NAME##_it NAME##_lower_bound(const NAME* m, K key){ if(!m) return 0; const NAME##_node* N=m->nodes; uint32_t cur=m->root, res=0; \
+        while(cur){ int c=CMPFN(key,N[cur].key); if(c<=0){ res=cur; cur=N[cur].left; } else cur=N[cur].right; } return res; } \
+    NAME##_it NAME##_upper_bound(const NAME* m, K key){ if(!m) return 0; const NAME##_node* N=m->nodes; uint32_t cur=m->root, res=0; \
+        while(cur){ int c=CMPFN(key,N[cur].key); if(c<0){ res=cur; cur=N[cur].left; } else cur=N[cur].right; } return res; }
 
 #endif /* DG_TREE_MAP_H */
@@ -0,0 +1,160 @@
+// dg_vec.h - header-only C99 typed dynamic array
+// Public Domain / Unlicense. Same generator shape as DG_MAP (dg_map.h).
+//
+// Goals vs dg_darray_t:
+// - Element type known at compile time: indexing is a plain T* access, no runtime
+//   elemsize multiply, push is an inlined assignment instead of an out-of-line memcpy,
+//   so loops over NAME_data() vectorize like loops over a C array
+// - Hot paths (push, at, data, size, pop) are static inline in DG_VEC_DECL, the growth
+//   slow path and the range operations are emitted once by DG_VEC_IMPL
+// - Capacity doubles like DGDARRAY_GROW_2X, NAME_reserve sizes exactly
+// - Memory goes through DG_VEC_REALLOC/DG_VEC_FREE, realloc/free by default, i.e. the
+//   dg_alloc.h memory manager wherever dg_darray_t uses it
+//
+// Example:
+//   DG_VEC_DECL(u64vec, uint64_t);
+//   DG_VEC_IMPL(u64vec, uint64_t);
+//
+//   u64vec v; u64vec_init(&v, 0);
+//   for (uint64_t i = 0; i < 100; i++) if (!u64vec_push(&v, i)) {/*oom*/}
+//   uint64_t sum = 0, *p = u64vec_data(&v);
+//   for (size_t i = 0; i < u64vec_size(&v); i++) sum += p[i];
+//   u64vec_erase_range(&v, 10, 20);
+//   u64vec_destroy(&v);
+//
+// Notes:
+// - Elements are copied with assignment/memcpy, there are no per-element hooks.
+// - Growth invalidates pointers from NAME_data/NAME_at.
+// - Thread safety is up to the caller.
+//
+#ifndef DG_VEC_H
+#define DG_VEC_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef DG_VEC_REALLOC
+#  define DG_VEC_REALLOC(p,sz) realloc(p,sz)
+#endif
+#ifndef DG_VEC_FREE
+#  define DG_VEC_FREE(p) free(p)
+#endif
+
+// Capacity of the first allocation made by a push into an empty vector
+#ifndef DG_VEC_MIN_CAP
+#  define DG_VEC_MIN_CAP 8
+#endif
+
+// Declarations generator, also defines the inline hot paths
+#define DG_VEC_DECL(NAME, T) \
+    typedef struct NAME { \
+        T* data; \
+        size_t size; \
+        size_t cap; \
+    } NAME; \
+    int  NAME##_init(NAME* v, size_t initial_capacity); \
+    void NAME##_destroy(NAME* v); \
+    /* capacity of exactly n elements unless already larger */ \
+    int  NAME##_reserve(NAME* v, size_t n); \
+    /* new elements are zero-filled */ \
+    int  NAME##_resize(NAME* v, size_t n); \
+    int  NAME##_shrink_to_fit(NAME* v); \
+    /* copies n elements before pos (pos <= size); src may point into v, NULL zero-fills */ \
+    int  NAME##_insert_range(NAME* v, size_t pos, const T* src, size_t n); \
+    /* removes [first, last), keeps the order of the rest */ \
+    void NAME##_erase_range(NAME* v, size_t first, size_t last); \
+    int  NAME##__grow_(NAME* v, size_t min_cap); \
+    static inline size_t NAME##_size(const NAME* v) { return v->size; } \
+    static inline size_t NAME##_capacity(const NAME* v) { return v->cap; } \
+    static inline T* NAME##_data(NAME* v) { return v->data; } \
+    static inline T* NAME##_at(NAME* v, size_t i) { assert(i < v->size); return v->data + i; } \
+    static inline void NAME##_clear(NAME* v) { v->size = 0; } \
+    /* by value: pushing an element of v itself stays valid across growth */ \
+    static inline int NAME##_push(NAME* v, T val) { \
+        if (v->size == v->cap && !NAME##__grow_(v, v->size + 1)) return 0; \
+        v->data[v->size++] = val; \
+        return 1; \
+    } \
+    static inline int NAME##_pop(NAME* v, T* out) { \
+        if (!v->size) return 0; \
+        --v->size; \
+        if (out) *out = v->data[v->size]; \
+        return 1; \
+    }
+
+// Implementation generator
+#define DG_VEC_IMPL(NAME, T) \
+    /* reallocates to exactly cap elements, the vector is unchanged on failure */ \
+    static int NAME##__set_cap_(NAME* v, size_t cap) { \
+        if (cap > SIZE_MAX / sizeof(T)) return 0; \
+        T* p = (T*)DG_VEC_REALLOC(v->data, cap * sizeof(T)); \
+        if (!p && cap) return 0; \
+        v->data = p; \
+        v->cap = cap; \
+        return 1; \
+    } \
+    int NAME##__grow_(NAME* v, size_t min_cap) { \
+        size_t cap = v->cap * 2; \
+        if (cap < v->cap) cap = min_cap; /* wrapped */ \
+        if (cap < DG_VEC_MIN_CAP) cap = DG_VEC_MIN_CAP; \
+        if (cap < min_cap) cap = min_cap; \
+        return NAME##__set_cap_(v, cap); \
+    } \
+    int NAME##_init(NAME* v, size_t initial_capacity) { \
+        if (!v) return 0; \
+        memset(v, 0, sizeof(*v)); \
+        return initial_capacity ? NAME##__set_cap_(v, initial_capacity) : 1; \
+    } \
+    void NAME##_destroy(NAME* v) { \
+        if (!v) return; \
+        DG_VEC_FREE(v->data); \
+        memset(v, 0, sizeof(*v)); \
+    } \
+    int NAME##_reserve(NAME* v, size_t n) { \
+        return n <= v->cap ? 1 : NAME##__set_cap_(v, n); \
+    } \
+    int NAME##_resize(NAME* v, size_t n) { \
+        if (n > v->cap && !NAME##__grow_(v, n)) return 0; \
+        if (n > v->size) memset(v->data + v->size, 0, (n - v->size) * sizeof(T)); \
+        v->size = n; \
+        return 1; \
+    } \
+    int NAME##_shrink_to_fit(NAME* v) { \
+        if (v->size == v->cap) return 1; \
+        if (!v->size) { DG_VEC_FREE(v->data); v->data = NULL; v->cap = 0; return 1; } \
+        return NAME##__set_cap_(v, v->size); \
+    } \
+    int NAME##_insert_range(NAME* v, size_t pos, const T* src, size_t n) { \
+        assert(pos <= v->size); \
+        if (!n) return 1; \
+        if (n > SIZE_MAX - v->size) return 0; \
+        /* a source inside v moves with the buffer, keep it as an index */ \
+        uintptr_t ubeg = (uintptr_t)v->data, usrc = (uintptr_t)src; \
+        int alias = src && usrc >= ubeg && usrc < (uintptr_t)(v->data + v->size); \
+        size_t s = alias ? (size_t)(src - v->data) : 0; \
+        if (v->size + n > v->cap && !NAME##__grow_(v, v->size + n)) return 0; \
+        T* d = v->data; \
+        memmove(d + pos + n, d + pos, (v->size - pos) * sizeof(T)); \
+        if (!src) memset(d + pos, 0, n * sizeof(T)); \
+        else if (!alias) memcpy(d + pos, src, n * sizeof(T)); \
+        else if (s + n <= pos) memcpy(d + pos, d + s, n * sizeof(T)); \
+        else if (s >= pos) memcpy(d + pos, d + s + n, n * sizeof(T)); \
+        else { /* source straddles pos: head stayed, tail moved up by n */ \
+            size_t k = pos - s; \
+            memcpy(d + pos, d + s, k * sizeof(T)); \
+            memcpy(d + pos + k, d + pos + n, (n - k) * sizeof(T)); \
+        } \
+        v->size += n; \
+        return 1; \
+    } \
+    void NAME##_erase_range(NAME* v, size_t first, size_t last) { \
+        assert(first <= last && last <= v->size); \
+        if (first == last) return; \
+        memmove(v->data + first, v->data + last, (v->size - last) * sizeof(T)); \
+        v->size -= last - first; \
+    }
+
+#endif
@@ -1,8 +1,9 @@
 #include "dg_atomic.h"
+
+#if defined(_MSC_VER)
 #include <Windows.h>
 #include <intrin.h>
 
-#if defined(_MSC_VER)
 size_t dg_atomic_load(atomic_size_t* ptr)
 {
 #if defined(_M_X64)
@@ -44,10 +45,45 @@ size_t dg_atomic_fetch_sub(atomic_size_t* ptr, atomic_size_t val)
 #if defined(_M_X64)
   return ((size_t)InterlockedExchangeAdd64((volatile atomic_size_t*)(ptr), (atomic_size_t)(-val)));
 #else
-  return ((size_t)InterlockedExchangeAdd((volatile LONG*)(ptr), (LONG)(-val)))
+  return ((size_t)InterlockedExchangeAdd((volatile LONG*)(ptr), (LONG)(-val)));
 #endif
 }
 
+size_t dg_atomic_load_acquire(atomic_size_t* ptr)
+{
+#if defined(_M_ARM64)
+  return (size_t)__ldar64((unsigned __int64 volatile*)(ptr));
+#else
+  size_t val = (size_t)*ptr; /* x86 loads are not reordered with later loads/stores */
+  _ReadWriteBarrier();
+  return val;
+#endif
+}
+
+void dg_atomic_store_release(atomic_size_t* ptr, atomic_size_t val)
+{
+#if defined(_M_ARM64)
+  __stlr64((unsigned __int64 volatile*)(ptr), (unsigned __int64)(val));
+#else
+  _ReadWriteBarrier(); /* x86 stores are not reordered with earlier loads/stores */
+  *ptr = val;
+#endif
+}
+
+size_t dg_atomic_compare_exchange(atomic_size_t* ptr, atomic_size_t expected, atomic_size_t desired)
+{
+#if defined(_M_X64) || defined(_M_ARM64)
+  return ((size_t)InterlockedCompareExchange64((volatile atomic_size_t*)(ptr), (atomic_size_t)(desired), (atomic_size_t)(expected)));
+#else
+  return ((size_t)InterlockedCompareExchange((volatile LONG*)(ptr), (LONG)(desired), (LONG)(expected)));
+#endif
+}
+
+void dg_atomic_fence(void)
+{
+  MemoryBarrier();
+}
+
 #elif defined(__GNUC__) || defined(__clang__)
 size_t dg_atomic_load(atomic_size_t* ptr)
 {
@@ -56,7 +92,8 @@ size_t dg_atomic_load(atomic_size_t* ptr)
 
 size_t dg_atomic_store(atomic_size_t* ptr, atomic_size_t val)
 {
-  return __atomic_store_n(ptr, val, __ATOMIC_SEQ_CST);
+  __atomic_store_n(ptr, val, __ATOMIC_SEQ_CST);
+  return val;
 }
 
 size_t dg_atomic_exchange(atomic_size_t* ptr, atomic_size_t val)
@@ -74,4 +111,25 @@ size_t dg_atomic_fetch_sub(atomic_size_t* ptr, atomic_size_t val)
   return __atomic_fetch_add(ptr, -val, __ATOMIC_SEQ_CST);
 }
 
+size_t dg_atomic_load_acquire(atomic_size_t* ptr)
+{
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void dg_atomic_store_release(atomic_size_t* ptr, atomic_size_t val)
+{
+  __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+}
+
+size_t dg_atomic_compare_exchange(atomic_size_t* ptr, atomic_size_t expected, atomic_size_t desired)
+{
+  __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  return expected;
+}
+
+void dg_atomic_fence(void)
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
 #endif
\ No newline at end of file
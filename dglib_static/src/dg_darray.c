@@ -7,18 +7,57 @@
 
 #define darray_get_internal(pd, idx) ((pd)->pdata + (idx) * (pd)->elemsize)
 
-static bool try_ensure_capacity(dg_darray_t* pd, size_t newcap)
+/* capacity after growing to hold at least mincap elements */
+static size_t grow_capacity(const dg_darray_t* pd, size_t mincap)
 {
-  if (!pd->pdata || newcap > pd->capacity) {
-    if(newcap > pd->capacity)
-      pd->capacity = newcap + pd->reserve;
-
-    uint8_t* tmp = realloc(pd->pdata, pd->capacity * pd->elemsize); //FIXME: K.D. realloc freeing old memory!
-    if (!tmp)
-      return false;
-    
-    pd->pdata = tmp;
+  size_t cap = pd->capacity, newcap;
+  switch (pd->growth) {
+  case DGDARRAY_GROW_1_5X:
+    newcap = cap + cap / 2;
+    break;
+  case DGDARRAY_GROW_CHUNK:
+    newcap = mincap + pd->reserve;
+    break;
+  case DGDARRAY_GROW_CALLBACK:
+    newcap = pd->pgrow ? pd->pgrow(pd, mincap) : mincap;
+    break;
+  default:
+    newcap = cap * 2;
+    break;
   }
+  if (newcap < cap) /* wrapped */
+    newcap = mincap;
+  if (newcap < pd->reserve)
+    newcap = pd->reserve;
+  if (newcap < mincap)
+    newcap = mincap;
+  return newcap;
+}
+
+/* reallocates to exactly newcap elements, the capacity changes only on success */
+static bool set_capacity(dg_darray_t* pd, size_t newcap)
+{
+  if (newcap > SIZE_MAX / pd->elemsize)
+    return false;
+
+  uint8_t* tmp = realloc(pd->pdata, newcap * pd->elemsize);
+  if (!tmp)
+    return false;
+
+  pd->pdata = tmp;
+  pd->capacity = newcap;
+  return true;
+}
+
+static bool try_ensure_capacity(dg_darray_t* pd, size_t newcap)
+{
+  if (newcap > pd->capacity)
+    return set_capacity(pd, grow_capacity(pd, newcap));
+
+  /* first allocation of an initializer capacity */
+  if (!pd->pdata)
+    return set_capacity(pd, pd->capacity ? pd->capacity : 1);
+
   return true;
 }
 
@@ -52,13 +91,27 @@ int darray_realloc(dg_darray_t* pd, size_t newcap) {
   return DGERR_SUCCESS;
 }
 
-int darray_shrink_to_fit(dg_darray_t* pd)
+int darray_reserve_exact(dg_darray_t* pd, size_t count)
 {
   assert(pd && "pd is NULL");
   assert(pd->elemsize > 0 && "element size is zero");
-  if (pd->capacity > pd->size)
-    return darray_realloc(pd, pd->size);
+  if (count <= pd->capacity && pd->pdata)
+    return DGERR_SUCCESS;
 
+  if (!set_capacity(pd, count > pd->size ? count : pd->size))
+    return DGERR_OUT_OF_MEMORY;
+
+  return DGERR_SUCCESS;
+}
+
+int darray_shrink_to_fit(dg_darray_t* pd)
+{
+  assert(pd && "pd is NULL");
+  assert(pd->elemsize > 0 && "element size is zero");
+  if (pd->pdata && pd->capacity > pd->size && pd->size) {
+    if (!set_capacity(pd, pd->size))
+      return DGERR_OUT_OF_MEMORY;
+  }
   return DGERR_SUCCESS;
 }
 
@@ -71,6 +124,8 @@ void darray_move(dg_darray_t* dst, dg_darray_t* src)
   dst->pdata = src->pdata;
   dst->reserve = src->reserve;
   dst->size = src->size;
+  dst->growth = src->growth;
+  dst->pgrow = src->pgrow;
   darray_reset(src);
 }
 
@@ -83,6 +138,8 @@ int darray_copy(dg_darray_t* dst, const dg_darray_t* src)
 
   dst->elemsize = src->elemsize;
   dst->reserve = src->reserve;
+  dst->growth = src->growth;
+  dst->pgrow = src->pgrow;
   dst->capacity = src->capacity;
   dst->size = src->size;
   dst->pdata = malloc(src->capacity * src->elemsize);
@@ -105,7 +162,7 @@ void darray_remove_from(dg_darray_t* pdarray, size_t idxfrom)
     memmove(
       darray_get_internal(pdarray, idxfrom),
       darray_get_internal(pdarray, idxfrom + 1),
-      pdarray->elemsize
+      (pdarray->size - idxfrom - 1) * pdarray->elemsize
     );
     pdarray->size--;
   }
@@ -122,11 +179,11 @@ void darray_remove_from_fast(dg_darray_t* pdarray, size_t idxfrom)
 {
   assert(pdarray && "pdarray is NULL");
   assert(pdarray->elemsize > 0 && "element size is zero");
-  if (!pdarray->pdata || pdarray->size || pdarray->elemsize == 0)
+  if (!pdarray->pdata || !pdarray->size || pdarray->elemsize == 0)
     return;
 
   /* element in begin or mid in array? */
-  if (idxfrom < pdarray->size) {
+  if ((idxfrom + 1) < pdarray->size) {
     memcpy(
       darray_get_internal(pdarray, idxfrom),
       darray_get_internal(pdarray, pdarray->size - 1),
@@ -143,6 +200,101 @@ void darray_remove_from_fast(dg_darray_t* pdarray, size_t idxfrom)
   }
 }
 
+void darray_erase_range(dg_darray_t* pd, size_t from, size_t count)
+{
+  assert(pd && "pd is NULL");
+  assert(pd->elemsize > 0 && "element size is zero");
+  assert(from <= pd->size && count <= pd->size - from && "erase range out of bounds");
+  if (!count)
+    return;
+
+  /* one move of the tail */
+  memmove(
+    darray_get_internal(pd, from),
+    darray_get_internal(pd, from + count),
+    (pd->size - from - count) * pd->elemsize
+  );
+  pd->size -= count;
+}
+
+int darray_insert_range(dg_darray_t* pd, size_t at, const void* src, size_t count)
+{
+  size_t srcidx = 0, k;
+  bool alias;
+  uint8_t* p;
+  assert(pd && "pd is NULL");
+  assert(pd->elemsize > 0 && "element size is zero");
+  assert(at <= pd->size && "insert position out of bounds");
+  if (!count)
+    return DGERR_SUCCESS;
+  if (count > SIZE_MAX - pd->size)
+    return DGERR_OVERFLOWED;
+
+  /* a source inside the array moves with the buffer, keep it as an index */
+  alias = src && pd->pdata &&
+    (uintptr_t)src >= (uintptr_t)pd->pdata &&
+    (uintptr_t)src < (uintptr_t)(pd->pdata + pd->size * pd->elemsize);
+  if (alias)
+    srcidx = ((const uint8_t*)src - pd->pdata) / pd->elemsize;
+  if (!try_ensure_capacity(pd, pd->size + count))
+    return DGERR_OUT_OF_MEMORY;
+
+  p = pd->pdata;
+  memmove(
+    darray_get_internal(pd, at + count),
+    darray_get_internal(pd, at),
+    (pd->size - at) * pd->elemsize
+  );
+  if (!alias) {
+    if (src)
+      memcpy(p + at * pd->elemsize, src, count * pd->elemsize);
+  }
+  else if (srcidx + count <= at) {
+    memcpy(p + at * pd->elemsize, p + srcidx * pd->elemsize, count * pd->elemsize);
+  }
+  else if (srcidx >= at) {
+    memcpy(p + at * pd->elemsize, p + (srcidx + count) * pd->elemsize, count * pd->elemsize);
+  }
+  else {
+    /* source straddles at: its head stayed, its tail moved up by count */
+    k = at - srcidx;
+    memcpy(p + at * pd->elemsize, p + srcidx * pd->elemsize, k * pd->elemsize);
+    memcpy(p + (at + k) * pd->elemsize, p + (at + count) * pd->elemsize, (count - k) * pd->elemsize);
+  }
+  pd->size += count;
+  return DGERR_SUCCESS;
+}
+
+size_t darray_remove_if(dg_darray_t* pd, dg_darray_pred_proc pred, void* puserdata)
+{
+  size_t r, w, run, removed;
+  assert(pd && "pd is NULL");
+  assert(pd->elemsize > 0 && "element size is zero");
+  assert(pred && "pred is NULL");
+
+  /* skip the kept prefix, it stays in place */
+  for (r = 0; r < pd->size && !pred(darray_get_internal(pd, r), puserdata); r++);
+
+  /* r is at a removed element: move each following run of kept elements down at once */
+  w = r;
+  while (r < pd->size) {
+    r++;
+    for (run = r; run < pd->size && !pred(darray_get_internal(pd, run), puserdata); run++);
+    if (run > r) {
+      memmove(
+        darray_get_internal(pd, w),
+        darray_get_internal(pd, r),
+        (run - r) * pd->elemsize
+      );
+      w += run - r;
+    }
+    r = run;
+  }
+  removed = pd->size - w;
+  pd->size = w;
+  return removed;
+}
+
 void darray_insert_from(dg_darray_t* pd, const dg_darray_t* ps, size_t from, size_t count)
 {
   assert(ps && pd);
@@ -0,0 +1,290 @@
+#include "dg_darray_sort.h"
+#include "dg_alloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define darray_get_internal(pd, idx) ((pd)->pdata + (idx) * (pd)->elemsize)
+
+void darray_sort(dg_darray_t* pd, dg_darray_cmp_proc cmp)
+{
+  assert(pd && "pd is NULL");
+  assert(pd->elemsize > 0 && "element size is zero");
+  if (pd->size > 1)
+    qsort(pd->pdata, pd->size, pd->elemsize, cmp);
+}
+
+/* stable merge of a[0..na) and b[0..nb) into out, a first on ties */
+static void merge_runs(uint8_t* out, const uint8_t* a, size_t na, const uint8_t* b, size_t nb,
+  size_t es, dg_darray_cmp_proc cmp)
+{
+  const uint8_t* aend = a + na * es;
+  const uint8_t* bend = b + nb * es;
+  while (a < aend && b < bend) {
+    if (cmp(b, a) < 0) {
+      memcpy(out, b, es);
+      b += es;
+    }
+    else {
+      memcpy(out, a, es);
+      a += es;
+    }
+    out += es;
+  }
+  if (a < aend)
+    memcpy(out, a, (size_t)(aend - a));
+  if (b < bend)
+    memcpy(out, b, (size_t)(bend - b));
+}
+
+typedef struct sort_par_ctx_s {
+  uint8_t* src;
+  uint8_t* dst;
+  size_t   n, nparts, width, es;
+  dg_darray_cmp_proc cmp;
+} sort_par_ctx_t;
+
+static void sort_par_part_proc(void* puserdata, size_t begin, size_t end)
+{
+  sort_par_ctx_t* c = (sort_par_ctx_t*)puserdata;
+  for (size_t p = begin; p < end; p++) {
+    size_t lo = c->n * p / c->nparts, hi = c->n * (p + 1) / c->nparts;
+    qsort(c->src + lo * c->es, hi - lo, c->es, c->cmp);
+  }
+}
+
+/* piece q of the merge of runs [lo, mid) and [mid, hi), split by output position */
+static void sort_par_merge_proc(void* puserdata, size_t begin, size_t end)
+{
+  sort_par_ctx_t* c = (sort_par_ctx_t*)puserdata;
+  for (size_t t = begin; t < end; t++) {
+    size_t span = 2 * c->width, q = t % span, p0 = t / span * span;
+    size_t lo = c->n * p0 / c->nparts;
+    size_t mid = c->n * (p0 + c->width) / c->nparts;
+    size_t hi = c->n * (p0 + span) / c->nparts;
+    const uint8_t* a = c->src + lo * c->es;
+    const uint8_t* b = c->src + mid * c->es;
+    size_t na = mid - lo, nb = hi - mid, nout = hi - lo, ends[2], idx[2];
+    ends[0] = nout * q / span;
+    ends[1] = nout * (q + 1) / span;
+    /* co-rank: idx elements of a and ends - idx of b make the first ends outputs */
+    for (int e = 0; e < 2; e++) {
+      size_t d = ends[e], l = d > nb ? d - nb : 0, h = d < na ? d : na;
+      while (l < h) {
+        size_t i = l + (h - l) / 2;
+        if (c->cmp(b + (d - i - 1) * c->es, a + i * c->es) < 0)
+          h = i;
+        else
+          l = i + 1;
+      }
+      idx[e] = l;
+    }
+    merge_runs(c->dst + (lo + ends[0]) * c->es,
+      a + idx[0] * c->es, idx[1] - idx[0],
+      b + (ends[0] - idx[0]) * c->es, (ends[1] - idx[1]) - (ends[0] - idx[0]),
+      c->es, c->cmp);
+  }
+}
+
+int darray_sort_par(dg_darray_t* pd, dg_darray_cmp_proc cmp, dg_threadpool_t* ptp)
+{
+  sort_par_ctx_t c;
+  size_t nthreads = ptp ? darray_get_size(&ptp->workers) + 1 : 1;
+  assert(pd && "pd is NULL");
+  assert(pd->elemsize > 0 && "element size is zero");
+
+  /* power of two parts, so every merge round pairs all runs */
+  c.n = pd->size;
+  c.nparts = 1;
+  while (c.nparts < nthreads && c.n / (c.nparts * 2) >= DGDARRAY_SORT_MIN_PART)
+    c.nparts *= 2;
+  if (c.nparts == 1) {
+    darray_sort(pd, cmp);
+    return DGERR_SUCCESS;
+  }
+
+  /* same capacity as the array, so the buffers can trade places */
+  uint8_t* ptmp = (uint8_t*)malloc(pd->capacity * pd->elemsize);
+  if (!ptmp)
+    return DGERR_OUT_OF_MEMORY;
+
+  c.src = pd->pdata;
+  c.dst = ptmp;
+  c.es = pd->elemsize;
+  c.cmp = cmp;
+  int st = tp_parallel_for(ptp, c.nparts, c.nparts, sort_par_part_proc, &c);
+  for (c.width = 1; st == DGERR_SUCCESS && c.width < c.nparts; c.width *= 2) {
+    st = tp_parallel_for(ptp, c.nparts, c.nparts, sort_par_merge_proc, &c);
+    if (st == DGERR_SUCCESS) {
+      uint8_t* x = c.src;
+      c.src = c.dst;
+      c.dst = x;
+    }
+  }
+  if (st != DGERR_SUCCESS) {
+    /* the pool could not run a round: bring the runs back into the array and finish here */
+    if (c.src != pd->pdata)
+      memcpy(pd->pdata, c.src, c.n * c.es);
+    free(ptmp);
+    darray_sort(pd, cmp);
+    return DGERR_SUCCESS;
+  }
+  pd->pdata = c.src;
+  free(c.dst);
+  return DGERR_SUCCESS;
+}
+
+/* key bits mapped so that unsigned order is the key order */
+static inline uint64_t radix_key(const uint8_t* pkey, uint32_t keytype)
+{
+  uint32_t u32;
+  uint64_t u64;
+  switch (keytype) {
+  case DGDARRAY_KEY_U32:
+    memcpy(&u32, pkey, 4);
+    return u32;
+  case DGDARRAY_KEY_I32:
+    memcpy(&u32, pkey, 4);
+    return u32 ^ 0x80000000u;
+  case DGDARRAY_KEY_F32:
+    memcpy(&u32, pkey, 4);
+    return u32 ^ ((u32 >> 31) ? 0xFFFFFFFFu : 0x80000000u);
+  case DGDARRAY_KEY_U64:
+    memcpy(&u64, pkey, 8);
+    return u64;
+  case DGDARRAY_KEY_I64:
+    memcpy(&u64, pkey, 8);
+    return u64 ^ 0x8000000000000000ull;
+  default: /* DGDARRAY_KEY_F64 */
+    memcpy(&u64, pkey, 8);
+    return u64 ^ ((u64 >> 63) ? ~0ull : 0x8000000000000000ull);
+  }
+}
+
+/* one counting-sort pass by the digit at shift, keytype is a constant in every loop */
+#define RADIX_SCATTER_LOOP(KT) \
+  for (i = 0; i < n; i++) { \
+    const uint8_t* pe = src + i * es; \
+    uint8_t* pdst = dst + offs[(radix_key(pe + keyoffset, KT) >> shift) & 0xFF]++ * es; \
+    if (es == 8) \
+      memcpy(pdst, pe, 8); \
+    else if (es == 16) \
+      memcpy(pdst, pe, 16); \
+    else \
+      memcpy(pdst, pe, es); \
+  }
+
+static void radix_scatter(uint8_t* dst, const uint8_t* src, size_t n, size_t es,
+  size_t keyoffset, uint32_t keytype, unsigned shift, size_t* offs)
+{
+  size_t i;
+  switch (keytype) {
+  case DGDARRAY_KEY_U32: RADIX_SCATTER_LOOP(DGDARRAY_KEY_U32); break;
+  case DGDARRAY_KEY_I32: RADIX_SCATTER_LOOP(DGDARRAY_KEY_I32); break;
+  case DGDARRAY_KEY_F32: RADIX_SCATTER_LOOP(DGDARRAY_KEY_F32); break;
+  case DGDARRAY_KEY_U64: RADIX_SCATTER_LOOP(DGDARRAY_KEY_U64); break;
+  case DGDARRAY_KEY_I64: RADIX_SCATTER_LOOP(DGDARRAY_KEY_I64); break;
+  default:               RADIX_SCATTER_LOOP(DGDARRAY_KEY_F64); break;
+  }
+}
+
+int darray_radix_sort(dg_darray_t* pd, size_t keyoffset, uint32_t keytype)
+{
+  size_t (*hist)[256];
+  size_t i, es, nbytes;
+  assert(pd && "pd is NULL");
+  assert(pd->elemsize > 0 && "element size is zero");
+  if (keytype > DGDARRAY_KEY_F64)
+    return DGERR_INVALID_PARAM;
+  nbytes = (keytype == DGDARRAY_KEY_U32 || keytype == DGDARRAY_KEY_I32 || keytype == DGDARRAY_KEY_F32) ? 4 : 8;
+  es = pd->elemsize;
+  if (keyoffset > es || nbytes > es - keyoffset)
+    return DGERR_INVALID_PARAM;
+  if (pd->size < 2)
+    return DGERR_SUCCESS;
+
+  hist = (size_t(*)[256])calloc(nbytes, sizeof(*hist));
+  uint8_t* ptmp = (uint8_t*)malloc(pd->capacity * es);
+  if (!hist || !ptmp) {
+    free(hist);
+    free(ptmp);
+    return DGERR_OUT_OF_MEMORY;
+  }
+
+  /* all digit histograms in one pass */
+  for (i = 0; i < pd->size; i++) {
+    uint64_t k = radix_key(darray_get_internal(pd, i) + keyoffset, keytype);
+    for (size_t d = 0; d < nbytes; d++)
+      hist[d][(k >> (d * 8)) & 0xFF]++;
+  }
+
+  uint8_t* src = pd->pdata;
+  uint8_t* dst = ptmp;
+  for (size_t d = 0; d < nbytes; d++) {
+    size_t sum = 0, cnt;
+    /* one bucket holds every key: the pass would not move anything */
+    if (hist[d][(radix_key(src + keyoffset, keytype) >> (d * 8)) & 0xFF] == pd->size)
+      continue;
+    for (i = 0; i < 256; i++) {
+      cnt = hist[d][i];
+      hist[d][i] = sum;
+      sum += cnt;
+    }
+    radix_scatter(dst, src, pd->size, es, keyoffset, keytype, (unsigned)(d * 8), hist[d]);
+    uint8_t* x = src;
+    src = dst;
+    dst = x;
+  }
+  pd->pdata = src;
+  free(dst);
+  free(hist);
+  return DGERR_SUCCESS;
+}
+
+size_t darray_unique(dg_darray_t* pd, dg_darray_cmp_proc cmp)
+{
+  size_t r, w = 0;
+  assert(pd && "pd is NULL");
+  assert(pd->elemsize > 0 && "element size is zero");
+  for (r = 0; r < pd->size; r++) {
+    if (w && cmp(darray_get_internal(pd, w - 1), darray_get_internal(pd, r)) == 0)
+      continue;
+    if (w != r)
+      memcpy(darray_get_internal(pd, w), darray_get_internal(pd, r), pd->elemsize);
+    w++;
+  }
+  pd->size = w;
+  return w;
+}
+
+size_t darray_lower_bound(const dg_darray_t* pd, const void* pkey, dg_darray_cmp_proc cmp)
+{
+  size_t lo = 0, hi = pd->size;
+  assert(pd && "pd is NULL");
+  assert(pd->elemsize > 0 && "element size is zero");
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (cmp(darray_get_internal(pd, mid), pkey) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+int darray_merge(dg_darray_t* pdst, const dg_darray_t* pa, const dg_darray_t* pb, dg_darray_cmp_proc cmp)
+{
+  assert(pdst && pa && pb);
+  assert(pdst != pa && pdst != pb && "pdst must not be a source");
+  if (pa->elemsize != pb->elemsize || pdst->elemsize != pa->elemsize)
+    return DGERR_INVALID_PARAM;
+  /* darray_resize does not allocate while the size fits the initializer capacity */
+  size_t n = pa->size + pb->size;
+  if (n && darray_reserve_exact(pdst, n) != DGERR_SUCCESS)
+    return DGERR_OUT_OF_MEMORY;
+  if (darray_resize(pdst, n) != DGERR_SUCCESS)
+    return DGERR_OUT_OF_MEMORY;
+  merge_runs(pdst->pdata, pa->pdata, pa->size, pb->pdata, pb->size, pa->elemsize, cmp);
+  return DGERR_SUCCESS;
+}
@@ -1,6 +1,13 @@
 #include "dg_queue.h"
 #include "dg_alloc.h"
 
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
 static bool queue_allocate_if_needed(dg_queue_t* q) {
   if (!q->pdata) {
     q->pdata = malloc(q->capacity * q->elemsize);
@@ -159,46 +166,128 @@ bool mpmc_queue_free(dg_mtqueue_mpmc_t* q)
 
 bool mpmc_queue_add_back(dg_mtqueue_mpmc_t* q, const void* psrc)
 {
-  size_t pos = dg_atomic_fetch_add(&q->enqueue_pos, 1);
-  size_t idx = pos & q->mask;
-  // wait until slot is ready
-  size_t seq;
+  // claim a position only once its slot is free, a failed call leaves the queue untouched
+  size_t pos = dg_atomic_load(&q->enqueue_pos);
+  size_t idx;
   while (true) {
-    seq = dg_atomic_load(&q->seq[idx]);
-    if (seq == pos) break;           // free slot
-    if (seq < pos) return false;     // queue full
-    // otherwise spin
+    idx = pos & q->mask;
+    intptr_t diff = (intptr_t)dg_atomic_load_acquire(&q->seq[idx]) - (intptr_t)pos;
+    if (diff == 0) {
+      size_t prev = dg_atomic_compare_exchange(&q->enqueue_pos, pos, pos + 1);
+      if (prev == pos)
+        break;                       // slot claimed
+      pos = prev;                    // another producer won, retry at its position
+    }
+    else if (diff < 0) {
+      return false;                  // queue full
+    }
+    else {
+      pos = dg_atomic_load(&q->enqueue_pos); // stale position
+    }
   }
   // write data
   void* slot = q->pdata + (idx * q->elemsize);
   memcpy(slot, psrc, q->elemsize);
   // publish
-  dg_atomic_store(&q->seq[idx], pos + 1);
+  dg_atomic_store_release(&q->seq[idx], pos + 1);
   return true;
 }
 
 bool mpmc_queue_get_front(void *pdst, dg_mtqueue_mpmc_t* q)
 {
-  size_t pos = dg_atomic_fetch_add(&q->dequeue_pos, 1);
-  size_t idx = pos & q->mask;
-  // wait until data is ready
-  size_t seq;
+  size_t pos = dg_atomic_load(&q->dequeue_pos);
+  size_t idx;
   while (true) {
-    seq = dg_atomic_load(&q->seq[idx]);
-    if (seq == pos + 1)
-      break;       // data ready
-    if (seq < pos + 1)
-      return false; // queue empty
-    // otherwise spin
+    idx = pos & q->mask;
+    intptr_t diff = (intptr_t)dg_atomic_load_acquire(&q->seq[idx]) - (intptr_t)(pos + 1);
+    if (diff == 0) {
+      size_t prev = dg_atomic_compare_exchange(&q->dequeue_pos, pos, pos + 1);
+      if (prev == pos)
+        break;                       // data claimed
+      pos = prev;
+    }
+    else if (diff < 0) {
+      return false;                  // queue empty (or the slot is still being written)
+    }
+    else {
+      pos = dg_atomic_load(&q->dequeue_pos);
+    }
   }
   // read data
   void* slot = q->pdata + (idx * q->elemsize);
   memcpy(pdst, slot, q->elemsize);
   // mark slot free
-  dg_atomic_store(&q->seq[idx], pos + q->capacity);
+  dg_atomic_store_release(&q->seq[idx], pos + q->capacity);
   return true;
 }
 
+size_t mpmc_queue_add_back_n(dg_mtqueue_mpmc_t* q, const void* psrc, size_t count)
+{
+  size_t pos = dg_atomic_load(&q->enqueue_pos);
+  size_t n, first;
+  while (true) {
+    // run of slots free for this lap: slot pos + n is free when its sequence is pos + n
+    for (n = 0; n < count; n++) {
+      if (dg_atomic_load_acquire(&q->seq[(pos + n) & q->mask]) != pos + n)
+        break;
+    }
+    if (n) {
+      size_t prev = dg_atomic_compare_exchange(&q->enqueue_pos, pos, pos + n);
+      if (prev == pos)
+        break;                       // whole run claimed
+      pos = prev;
+    }
+    else if (!count || (intptr_t)dg_atomic_load_acquire(&q->seq[pos & q->mask]) - (intptr_t)pos < 0) {
+      return 0;                      // queue full
+    }
+    else {
+      pos = dg_atomic_load(&q->enqueue_pos);
+    }
+  }
+  // write data, at most two copies around the buffer end
+  first = q->capacity - (pos & q->mask);
+  if (first > n)
+    first = n;
+  memcpy(q->pdata + (pos & q->mask) * q->elemsize, psrc, first * q->elemsize);
+  memcpy(q->pdata, (const uint8_t*)psrc + first * q->elemsize, (n - first) * q->elemsize);
+  // publish slot by slot, consumers claim them in order
+  for (size_t i = 0; i < n; i++)
+    dg_atomic_store_release(&q->seq[(pos + i) & q->mask], pos + i + 1);
+  return n;
+}
+
+size_t mpmc_queue_get_front_n(void* pdst, dg_mtqueue_mpmc_t* q, size_t count)
+{
+  size_t pos = dg_atomic_load(&q->dequeue_pos);
+  size_t n, first;
+  while (true) {
+    for (n = 0; n < count; n++) {
+      if (dg_atomic_load_acquire(&q->seq[(pos + n) & q->mask]) != pos + n + 1)
+        break;
+    }
+    if (n) {
+      size_t prev = dg_atomic_compare_exchange(&q->dequeue_pos, pos, pos + n);
+      if (prev == pos)
+        break;
+      pos = prev;
+    }
+    else if (!count || (intptr_t)dg_atomic_load_acquire(&q->seq[pos & q->mask]) - (intptr_t)(pos + 1) < 0) {
+      return 0;                      // queue empty
+    }
+    else {
+      pos = dg_atomic_load(&q->dequeue_pos);
+    }
+  }
+  first = q->capacity - (pos & q->mask);
+  if (first > n)
+    first = n;
+  memcpy(pdst, q->pdata + (pos & q->mask) * q->elemsize, first * q->elemsize);
+  memcpy((uint8_t*)pdst + first * q->elemsize, q->pdata, (n - first) * q->elemsize);
+  for (size_t i = 0; i < n; i++)
+    dg_atomic_store_release(&q->seq[(pos + i) & q->mask], pos + i + q->capacity);
+  return n;
+}
+
 bool mpmc_queue_is_empty(dg_mtqueue_mpmc_t* q)
 {
   size_t enq = dg_atomic_load(&q->enqueue_pos);
@@ -213,9 +302,255 @@ bool mpmc_queue_is_full(dg_mtqueue_mpmc_t* q)
   return (enq - deq) >= q->capacity;
 }
 
+/**
+* MPMC blocking wrapper
+*/
+bool mpmc_queue_blocking_alloc(dg_mtqueue_mpmc_blocking_t* bq, size_t elemsize, size_t capacity)
+{
+  memset(bq, 0, sizeof(*bq));
+  if (!mpmc_queue_alloc(&bq->q, elemsize, capacity))
+    return false;
+
+  bq->mtx = mutex_alloc("dg_mtqueue_mpmc_blocking_t:mtx");
+  bq->not_full = cond_alloc("dg_mtqueue_mpmc_blocking_t:not_full");
+  bq->not_empty = cond_alloc("dg_mtqueue_mpmc_blocking_t:not_empty");
+  if (!bq->mtx || !bq->not_full || !bq->not_empty) {
+    mpmc_queue_blocking_free(bq);
+    return false;
+  }
+  return true;
+}
+
+bool mpmc_queue_blocking_free(dg_mtqueue_mpmc_blocking_t* bq)
+{
+  if (!bq)
+    return false;
+  mpmc_queue_free(&bq->q);
+  if (bq->mtx) {
+    mutex_free(bq->mtx);
+    bq->mtx = NULL;
+  }
+  if (bq->not_full) {
+    cond_free(bq->not_full);
+    bq->not_full = NULL;
+  }
+  if (bq->not_empty) {
+    cond_free(bq->not_empty);
+    bq->not_empty = NULL;
+  }
+  return true;
+}
+
+/* wakes one parked thread of the other side, if there is any */
+static void mpmc_blocking_wake(dg_mtqueue_mpmc_blocking_t* bq, atomic_size_t* pnwait, dg_cond_t hcond)
+{
+  // the slot update must be visible before the counter is read, pairs with the waiter's
+  // increment-then-retry: either the waiter sees the slot or this thread sees the waiter
+  dg_atomic_fence();
+  if (dg_atomic_load_acquire(pnwait)) {
+    mutex_lock(bq->mtx);
+    cond_signal(hcond);
+    mutex_unlock(bq->mtx);
+  }
+}
+
+void mpmc_queue_add_back_wait(dg_mtqueue_mpmc_blocking_t* bq, const void* psrc)
+{
+  bool added = false;
+  for (int i = 0; i < DGMPMC_SPIN_COUNT && !added; i++)
+    added = mpmc_queue_add_back(&bq->q, psrc);
+  if (!added) {
+    mutex_lock(bq->mtx);
+    dg_atomic_fetch_add(&bq->nwait_add, 1);
+    while (!mpmc_queue_add_back(&bq->q, psrc))
+      cond_wait(bq->not_full, bq->mtx);
+    dg_atomic_fetch_sub(&bq->nwait_add, 1);
+    mutex_unlock(bq->mtx);
+  }
+  mpmc_blocking_wake(bq, &bq->nwait_get, bq->not_empty);
+}
+
+void mpmc_queue_get_front_wait(void* pdst, dg_mtqueue_mpmc_blocking_t* bq)
+{
+  bool taken = false;
+  for (int i = 0; i < DGMPMC_SPIN_COUNT && !taken; i++)
+    taken = mpmc_queue_get_front(pdst, &bq->q);
+  if (!taken) {
+    mutex_lock(bq->mtx);
+    dg_atomic_fetch_add(&bq->nwait_get, 1);
+    while (!mpmc_queue_get_front(pdst, &bq->q))
+      cond_wait(bq->not_empty, bq->mtx);
+    dg_atomic_fetch_sub(&bq->nwait_get, 1);
+    mutex_unlock(bq->mtx);
+  }
+  mpmc_blocking_wake(bq, &bq->nwait_add, bq->not_full);
+}
+
+/**
+* SPSC ring
+*/
+bool spsc_ring_alloc(dg_spsc_ring_t* r, size_t elemsize, size_t capacity)
+{
+  if (!elemsize || !is_power_of_two(capacity))
+    return false;
+
+  memset(r, 0, sizeof(*r));
+  r->elemsize = elemsize;
+  r->capacity = capacity;
+  r->mask = capacity - 1;
+  r->pdata = malloc(elemsize * capacity);
+  return r->pdata != NULL;
+}
+
+bool spsc_ring_free(dg_spsc_ring_t* r)
+{
+  if (!r)
+    return false;
+  free(r->pdata);
+  r->pdata = NULL;
+  dg_atomic_store(&r->head, 0);
+  dg_atomic_store(&r->tail, 0);
+  r->head_cache = 0;
+  r->tail_cache = 0;
+  return true;
+}
+
+/* free slots seen by the producer, reloads head only when fewer than want are known */
+static inline size_t spsc_ring_free_slots(dg_spsc_ring_t* r, size_t tail, size_t want)
+{
+  size_t nfree = r->capacity - (tail - r->head_cache);
+  if (nfree < want) {
+    r->head_cache = dg_atomic_load_acquire(&r->head);
+    nfree = r->capacity - (tail - r->head_cache);
+  }
+  return nfree;
+}
+
+/* filled slots seen by the consumer, reloads tail only when fewer than want are known */
+static inline size_t spsc_ring_filled_slots(dg_spsc_ring_t* r, size_t head, size_t want)
+{
+  size_t nfilled = r->tail_cache - head;
+  if (nfilled < want) {
+    r->tail_cache = dg_atomic_load_acquire(&r->tail);
+    nfilled = r->tail_cache - head;
+  }
+  return nfilled;
+}
+
+bool spsc_ring_push(dg_spsc_ring_t* r, const void* psrc)
+{
+  size_t tail = r->tail; // only the producer writes tail
+  if (!spsc_ring_free_slots(r, tail, 1))
+    return false;
+  memcpy(r->pdata + (tail & r->mask) * r->elemsize, psrc, r->elemsize);
+  dg_atomic_store_release(&r->tail, tail + 1);
+  return true;
+}
+
+size_t spsc_ring_push_n(dg_spsc_ring_t* r, const void* psrc, size_t count)
+{
+  size_t tail = r->tail;
+  size_t n = spsc_ring_free_slots(r, tail, count);
+  if (n > count)
+    n = count;
+  if (!n)
+    return 0;
+
+  // at most two copies: up to the end of the buffer, then from its start
+  size_t idx = tail & r->mask;
+  size_t first = r->capacity - idx < n ? r->capacity - idx : n;
+  memcpy(r->pdata + idx * r->elemsize, psrc, first * r->elemsize);
+  memcpy(r->pdata, (const uint8_t*)psrc + first * r->elemsize, (n - first) * r->elemsize);
+  dg_atomic_store_release(&r->tail, tail + n);
+  return n;
+}
+
+void* spsc_ring_reserve(dg_spsc_ring_t* r, size_t count, size_t* pgranted)
+{
+  size_t tail = r->tail;
+  size_t idx = tail & r->mask;
+  size_t n = spsc_ring_free_slots(r, tail, count);
+  if (n > count)
+    n = count;
+  if (n > r->capacity - idx)
+    n = r->capacity - idx; // contiguous part only
+  *pgranted = n;
+  return n ? r->pdata + idx * r->elemsize : NULL;
+}
+
+void spsc_ring_commit(dg_spsc_ring_t* r, size_t count)
+{
+  assert(count <= r->capacity - (r->tail - r->head_cache) && "commit exceeds reserved slots");
+  dg_atomic_store_release(&r->tail, r->tail + count);
+}
+
+bool spsc_ring_pop(void* pdst, dg_spsc_ring_t* r)
+{
+  size_t head = r->head; // only the consumer writes head
+  if (!spsc_ring_filled_slots(r, head, 1))
+    return false;
+  memcpy(pdst, r->pdata + (head & r->mask) * r->elemsize, r->elemsize);
+  dg_atomic_store_release(&r->head, head + 1);
+  return true;
+}
+
+size_t spsc_ring_pop_n(void* pdst, dg_spsc_ring_t* r, size_t count)
+{
+  size_t head = r->head;
+  size_t n = spsc_ring_filled_slots(r, head, count);
+  if (n > count)
+    n = count;
+  if (!n)
+    return 0;
+
+  size_t idx = head & r->mask;
+  size_t first = r->capacity - idx < n ? r->capacity - idx : n;
+  memcpy(pdst, r->pdata + idx * r->elemsize, first * r->elemsize);
+  memcpy((uint8_t*)pdst + first * r->elemsize, r->pdata, (n - first) * r->elemsize);
+  dg_atomic_store_release(&r->head, head + n);
+  return n;
+}
+
+void* spsc_ring_peek(dg_spsc_ring_t* r, size_t count, size_t* pavail)
+{
+  size_t head = r->head;
+  size_t idx = head & r->mask;
+  size_t n = spsc_ring_filled_slots(r, head, count);
+  if (n > count)
+    n = count;
+  if (n > r->capacity - idx)
+    n = r->capacity - idx;
+  *pavail = n;
+  return n ? r->pdata + idx * r->elemsize : NULL;
+}
+
+void spsc_ring_release(dg_spsc_ring_t* r, size_t count)
+{
+  assert(count <= r->tail_cache - r->head && "release exceeds peeked slots");
+  dg_atomic_store_release(&r->head, r->head + count);
+}
+
+size_t spsc_ring_size(dg_spsc_ring_t* r)
+{
+  size_t head = dg_atomic_load_acquire(&r->head);
+  size_t tail = dg_atomic_load_acquire(&r->tail);
+  return tail - head < r->capacity ? tail - head : r->capacity; // both sides may move between the loads
+}
+
+bool spsc_ring_is_empty(dg_spsc_ring_t* r)
+{
+  return spsc_ring_size(r) == 0;
+}
+
+bool spsc_ring_is_full(dg_spsc_ring_t* r)
+{
+  return spsc_ring_size(r) == r->capacity;
+}
+
 /**
 * MT Queue
 */
+#if defined(_WIN32)
 bool mtqueue_alloc(dg_mtqueue_t* q, size_t elemsize, size_t capacity)
 {
   q->elemsize = elemsize;
@@ -260,17 +595,34 @@ bool mtqueue_free(dg_mtqueue_t* q)
   return true;
 }
 
-void mtqueue_add_back(dg_mtqueue_t* q, const void* src)
+/* slot already acquired from slots_sem */
+static void mtqueue_put_back(dg_mtqueue_t* q, const void* psrc)
 {
-  semaphore_wait(q->slots_sem);
   mutex_lock(q->tail_mtx);
-  memcpy(q->pdata + q->tail * q->elemsize, src, q->elemsize);
+  memcpy(q->pdata + q->tail * q->elemsize, psrc, q->elemsize);
   q->tail = (q->tail + 1) % q->capacity;
   dg_atomic_fetch_add(&q->count, 1);
   mutex_unlock(q->tail_mtx);
   semaphore_post(q->items_sem);
 }
 
+/* item already acquired from items_sem */
+static void mtqueue_take_front(void* pdst, dg_mtqueue_t* q)
+{
+  mutex_lock(q->head_mtx);
+  memcpy(pdst, q->pdata + q->head * q->elemsize, q->elemsize);
+  q->head = (q->head + 1) % q->capacity;
+  dg_atomic_fetch_sub(&q->count, 1);
+  mutex_unlock(q->head_mtx);
+  semaphore_post(q->slots_sem);
+}
+
+void mtqueue_add_back(dg_mtqueue_t* q, const void* src)
+{
+  semaphore_wait(q->slots_sem);
+  mtqueue_put_back(q, src);
+}
+
 void* mtqueue_get_back(dg_mtqueue_t* q)
 {
   semaphore_wait(q->items_sem);
@@ -310,12 +662,44 @@ bool mtqueue_try_add_back(dg_mtqueue_t* q, const void* psrc)
   if (!semaphore_trywait(q->slots_sem))
     return false;
 
-  mutex_lock(q->tail_mtx);
-  memcpy(q->pdata + q->tail * q->elemsize, psrc, q->elemsize);
-  q->tail = (q->tail + 1) % q->capacity;
-  dg_atomic_fetch_add(&q->count, 1);
-  mutex_unlock(q->tail_mtx);
-  semaphore_post(q->items_sem);
+  mtqueue_put_back(q, psrc);
+  return true;
+}
+
+bool mtqueue_add_back_timed(dg_mtqueue_t* q, const void* psrc, uint32_t timeout_ms)
+{
+  if (timeout_ms == DGMTQUEUE_WAIT_INFINITE)
+    semaphore_wait(q->slots_sem);
+  else if (!semaphore_timed_wait(q->slots_sem, (int)timeout_ms))
+    return false;
+
+  mtqueue_put_back(q, psrc);
+  return true;
+}
+
+void mtqueue_get_front_copy(void* pdst, dg_mtqueue_t* q)
+{
+  semaphore_wait(q->items_sem);
+  mtqueue_take_front(pdst, q);
+}
+
+bool mtqueue_try_get_front(void* pdst, dg_mtqueue_t* q)
+{
+  if (!semaphore_trywait(q->items_sem))
+    return false;
+
+  mtqueue_take_front(pdst, q);
+  return true;
+}
+
+bool mtqueue_get_front_timed(void* pdst, dg_mtqueue_t* q, uint32_t timeout_ms)
+{
+  if (timeout_ms == DGMTQUEUE_WAIT_INFINITE)
+    semaphore_wait(q->items_sem);
+  else if (!semaphore_timed_wait(q->items_sem, (int)timeout_ms))
+    return false;
+
+  mtqueue_take_front(pdst, q);
   return true;
 }
 
@@ -342,3 +726,148 @@ bool mtqueue_is_full(dg_mtqueue_t* pqueue)
 {
   return dg_atomic_load(&pqueue->count) >= pqueue->capacity;
 }
+
+#elif defined(__linux__)
+static inline void futex_wait(uint32_t* paddr, uint32_t expected, const struct timespec* prel)
+{
+  syscall(SYS_futex, paddr, FUTEX_WAIT_PRIVATE, expected, prel, NULL, 0);
+}
+
+static inline void futex_wake(uint32_t* paddr, int count)
+{
+  syscall(SYS_futex, paddr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+bool mtqueue_alloc(dg_mtqueue_t* q, size_t elemsize, size_t capacity)
+{
+  size_t cap = 1;
+  while (cap < capacity)
+    cap <<= 1;
+
+  memset(q, 0, sizeof(*q));
+  q->elemsize = elemsize;
+  q->capacity = cap;
+  return mpmc_queue_alloc(&q->ring, elemsize, cap);
+}
+
+bool mtqueue_free(dg_mtqueue_t* q)
+{
+  return mpmc_queue_free(&q->ring);
+}
+
+/* wakes one sleeper of a direction, no syscall while nobody sleeps */
+static void mtqueue_wake(atomic_size_t* pnwait, uint32_t* pseq)
+{
+  // the ring update must be visible before the counter is read, pairs with the waiter's
+  // increment-then-retry: either the waiter sees the update or this thread sees the waiter
+  dg_atomic_fence();
+  if (dg_atomic_load_acquire(pnwait)) {
+    __atomic_fetch_add(pseq, 1, __ATOMIC_RELEASE); // a waiter between its key load and FUTEX_WAIT returns at once
+    futex_wake(pseq, 1);
+  }
+}
+
+static inline bool mtqueue_try_op(dg_mtqueue_t* q, bool add, void* pelem)
+{
+  bool done = add ? mpmc_queue_add_back(&q->ring, pelem) : mpmc_queue_get_front(pelem, &q->ring);
+  if (done) {
+    if (add)
+      mtqueue_wake(&q->nwait_get, &q->items_seq);
+    else
+      mtqueue_wake(&q->nwait_add, &q->slots_seq);
+  }
+  return done;
+}
+
+/* add (pelem is the source) or get (pelem is the destination), spinning first, then sleeping */
+static bool mtqueue_wait_op(dg_mtqueue_t* q, bool add, void* pelem, uint32_t timeout_ms)
+{
+  atomic_size_t* pnwait = add ? &q->nwait_add : &q->nwait_get;
+  uint32_t* pseq = add ? &q->slots_seq : &q->items_seq;
+  struct timespec deadline, rel;
+
+  for (int i = 0; i < DGMPMC_SPIN_COUNT; i++) {
+    if (mtqueue_try_op(q, add, pelem))
+      return true;
+  }
+  if (!timeout_ms)
+    return false;
+  if (timeout_ms != DGMTQUEUE_WAIT_INFINITE) {
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+  }
+
+  while (true) {
+    uint32_t key = __atomic_load_n(pseq, __ATOMIC_ACQUIRE);
+    dg_atomic_fetch_add(pnwait, 1);
+    if (mtqueue_try_op(q, add, pelem)) {
+      dg_atomic_fetch_sub(pnwait, 1);
+      return true;
+    }
+    const struct timespec* prel = NULL;
+    if (timeout_ms != DGMTQUEUE_WAIT_INFINITE) {
+      clock_gettime(CLOCK_MONOTONIC, &rel);
+      rel.tv_sec = deadline.tv_sec - rel.tv_sec;
+      rel.tv_nsec = deadline.tv_nsec - rel.tv_nsec;
+      if (rel.tv_nsec < 0) {
+        rel.tv_sec--;
+        rel.tv_nsec += 1000000000L;
+      }
+      if (rel.tv_sec < 0) {
+        dg_atomic_fetch_sub(pnwait, 1);
+        return false;
+      }
+      prel = &rel;
+    }
+    futex_wait(pseq, key, prel);
+    dg_atomic_fetch_sub(pnwait, 1);
+  }
+}
+
+void mtqueue_add_back(dg_mtqueue_t* q, const void* psrc)
+{
+  mtqueue_wait_op(q, true, (void*)psrc, DGMTQUEUE_WAIT_INFINITE);
+}
+
+bool mtqueue_try_add_back(dg_mtqueue_t* q, const void* psrc)
+{
+  return mtqueue_try_op(q, true, (void*)psrc);
+}
+
+bool mtqueue_add_back_timed(dg_mtqueue_t* q, const void* psrc, uint32_t timeout_ms)
+{
+  return mtqueue_wait_op(q, true, (void*)psrc, timeout_ms);
+}
+
+void mtqueue_get_front_copy(void* pdst, dg_mtqueue_t* q)
+{
+  mtqueue_wait_op(q, false, pdst, DGMTQUEUE_WAIT_INFINITE);
+}
+
+bool mtqueue_try_get_front(void* pdst, dg_mtqueue_t* q)
+{
+  return mtqueue_try_op(q, false, pdst);
+}
+
+bool mtqueue_get_front_timed(void* pdst, dg_mtqueue_t* q, uint32_t timeout_ms)
+{
+  return mtqueue_wait_op(q, false, pdst, timeout_ms);
+}
+
+bool mtqueue_is_empty(dg_mtqueue_t* pqueue)
+{
+  return mpmc_queue_is_empty(&pqueue->ring);
+}
+
+bool mtqueue_is_full(dg_mtqueue_t* pqueue)
+{
+  return mpmc_queue_is_full(&pqueue->ring);
+}
+#else
+#error "dg_mtqueue_t is not implemented for this platform"
+#endif
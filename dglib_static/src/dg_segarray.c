@@ -0,0 +1,145 @@
+#include "dg_segarray.h"
+#include "dg_alloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/* appends chunks until nchunks chunks are allocated, the table grows geometrically */
+static bool add_chunks(dg_segarray_t* psa, size_t nchunks)
+{
+  size_t chunkbytes = psa->elemsize << psa->chunkshift;
+  if (nchunks > psa->tablecap) {
+    size_t newcap = psa->tablecap ? psa->tablecap * 2 : 8;
+    if (newcap < nchunks)
+      newcap = nchunks;
+    if (newcap > SIZE_MAX / sizeof(uint8_t*))
+      return false;
+    uint8_t** ptable = (uint8_t**)realloc(psa->pchunks, newcap * sizeof(uint8_t*));
+    if (!ptable)
+      return false;
+    psa->pchunks = ptable;
+    psa->tablecap = newcap;
+  }
+  while (psa->nchunks < nchunks) {
+    uint8_t* pchunk = (uint8_t*)malloc(chunkbytes);
+    if (!pchunk)
+      return false;
+    psa->pchunks[psa->nchunks++] = pchunk;
+  }
+  return true;
+}
+
+int segarray_init(dg_segarray_t* psa, size_t elemsize, size_t chunkelems)
+{
+  uint32_t shift = 0;
+  assert(psa && "psa is NULL");
+  if (!elemsize)
+    return DGERR_INVALID_PARAM;
+  if (!chunkelems)
+    chunkelems = elemsize < DGSEGARRAY_DEFAULT_CHUNK_BYTES ? DGSEGARRAY_DEFAULT_CHUNK_BYTES / elemsize : 1;
+  while (((size_t)1 << shift) < chunkelems) {
+    if (++shift >= sizeof(size_t) * 8 - 1)
+      return DGERR_INVALID_PARAM;
+  }
+  if (elemsize > (SIZE_MAX >> shift))
+    return DGERR_INVALID_PARAM;
+
+  memset(psa, 0, sizeof(*psa));
+  psa->elemsize = elemsize;
+  psa->chunkshift = shift;
+  return DGERR_SUCCESS;
+}
+
+void segarray_free(dg_segarray_t* psa)
+{
+  assert(psa && "psa is NULL");
+  for (size_t i = 0; i < psa->nchunks; i++)
+    free(psa->pchunks[i]);
+  free(psa->pchunks);
+  psa->pchunks = NULL;
+  psa->nchunks = 0;
+  psa->tablecap = 0;
+  psa->size = 0;
+}
+
+void segarray_clear(dg_segarray_t* psa)
+{
+  assert(psa && "psa is NULL");
+  psa->size = 0;
+}
+
+int segarray_reserve(dg_segarray_t* psa, size_t count)
+{
+  assert(psa && "psa is NULL");
+  size_t n = segarray_get_chunk_elems(psa);
+  if (count > SIZE_MAX - (n - 1))
+    return DGERR_OVERFLOWED;
+  if (!add_chunks(psa, (count + n - 1) >> psa->chunkshift))
+    return DGERR_OUT_OF_MEMORY;
+  return DGERR_SUCCESS;
+}
+
+void segarray_shrink_to_fit(dg_segarray_t* psa)
+{
+  assert(psa && "psa is NULL");
+  size_t used = segarray_get_chunk_count(psa);
+  while (psa->nchunks > used)
+    free(psa->pchunks[--psa->nchunks]);
+}
+
+void* segarray_add_back(dg_segarray_t* psa)
+{
+  assert(psa && psa->elemsize > 0 && "array is not initialized");
+  size_t ichunk = psa->size >> psa->chunkshift;
+  if (ichunk >= psa->nchunks && !add_chunks(psa, ichunk + 1))
+    return NULL;
+  return psa->pchunks[ichunk] + (psa->size++ & (segarray_get_chunk_elems(psa) - 1)) * psa->elemsize;
+}
+
+bool segarray_push_back(dg_segarray_t* psa, const void* psrc)
+{
+  void* pelem = segarray_add_back(psa);
+  if (pelem) {
+    memcpy(pelem, psrc, psa->elemsize);
+    return true;
+  }
+  return false;
+}
+
+int segarray_append(dg_segarray_t* psa, const void* psrc, size_t count)
+{
+  const uint8_t* p = (const uint8_t*)psrc;
+  size_t mask;
+  assert(psa && psa->elemsize > 0 && "array is not initialized");
+  mask = segarray_get_chunk_elems(psa) - 1;
+  if (count > SIZE_MAX - psa->size)
+    return DGERR_OVERFLOWED;
+
+  int st = segarray_reserve(psa, psa->size + count);
+  if (st != DGERR_SUCCESS)
+    return st;
+
+  while (count) {
+    size_t off = psa->size & mask;
+    size_t n = mask + 1 - off;
+    if (n > count)
+      n = count;
+    memcpy(psa->pchunks[psa->size >> psa->chunkshift] + off * psa->elemsize, p, n * psa->elemsize);
+    p += n * psa->elemsize;
+    psa->size += n;
+    count -= n;
+  }
+  return DGERR_SUCCESS;
+}
+
+bool segarray_pop_back(void* pdst, dg_segarray_t* psa)
+{
+  assert(psa && "psa is NULL");
+  if (psa->size == 0)
+    return false;
+  if (pdst)
+    memcpy(pdst, segarray_get_ex(psa, psa->size - 1), psa->elemsize);
+  psa->size--;
+  return true;
+}
@@ -1,8 +1,11 @@
 ﻿#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include <dg_darray.h>
+#include <dg_darray_sort.h>
+#include <dg_segarray.h>
 #include <dg_list.h>
 #include <dg_queue.h>
 #include <dg_cpuinfo.h>
@@ -15,6 +18,17 @@
 #include <dg_random.h>
 #include <dg_sys.h>
 #include <dg_filesystem.h>
+#include <dg_time.h>
+#include <dg_map.h>
+#include <dg_cmap.h>
+#include <dg_map_snapshot.h>
+#include <dg_map_build.h>
+#include <dg_hash.h>
+#include <dg_treemap.h>
+#include <dg_btree.h>
+#include <dg_skiplist.h>
+#include <dg_vec.h>
+#include <dg_soa.h>
 
 #define DG_MEMNOVERRIDE
 #include "dg_alloc.h"
@@ -42,6 +56,7 @@ bool test_cpuinfo()
   printf("vendor: \"%s\"\n", info.vendor);
   printf("num phys processors: %d\n", info.num_physical_processors);
   printf("num logical processors: %d\n", info.num_logical_processors);
+  printf("features: 0x%016llx\n", (unsigned long long)info.features);
 
   double freq_hz;
   while (1) {
@@ -763,6 +778,2725 @@ bool test_filesystem()
   return true;
 }
 
+/* dg_map benchmark instantiation (u64 -> u64) */
+static inline uint64_t bench_u64_hash(uint64_t k) { return dg_splitmix64_(k); }
+#define bench_u64_eq(a, b) ((a) == (b))
+#define u64map_KEY_FREE(k) ((void)0)
+#define u64map_VAL_FREE(v) ((void)0)
+DG_MAP_DECL(u64map, uint64_t, uint64_t)
+DG_MAP_IMPL(u64map, uint64_t, uint64_t, bench_u64_hash, bench_u64_eq)
+
+/* byte-at-a-time lookup (probing before control groups), same table layout */
+static int u64map_get_bytewise(const u64map* m, uint64_t key, uint64_t* pout, size_t* pprobes)
+{
+  uint64_t h = bench_u64_hash(key);
+  uint8_t meta = dg__h2meta(h);
+  size_t idx = (size_t)h & m->mask;
+  for (;;) {
+    (*pprobes)++;
+    uint8_t c = m->ctrl[idx];
+    if (c == DG__CTRL_EMPTY)
+      return 0;
+    if (c == meta && m->hash[idx] == h && m->keys[idx] == key) {
+      *pout = m->vals[idx];
+      return 1;
+    }
+    idx = (idx + 1) & m->mask;
+  }
+}
+
+/* counts 16-byte groups loaded by the group lookup */
+static size_t u64map_group_probes(const u64map* m, uint64_t key)
+{
+  uint64_t h = bench_u64_hash(key);
+  uint8_t meta = dg__h2meta(h);
+  size_t pos = (size_t)h & m->mask, ngroups = 0;
+  for (;;) {
+    const uint8_t* g = m->ctrl + pos;
+    ngroups++;
+    for (dg__gmask_t mm = dg__group_match_(g, meta); mm; mm &= mm - 1) {
+      size_t idx = (pos + dg__ctz32_(mm)) & m->mask;
+      if (m->hash[idx] == h && m->keys[idx] == key)
+        return ngroups;
+    }
+    if (dg__group_empty_(g))
+      return ngroups;
+    pos = (pos + DG__GROUP_WIDTH) & m->mask;
+  }
+}
+
+bool test_map_group_probing()
+{
+  enum { NLOOKUPS = 1 << 22 };
+  const size_t cap = (size_t)1 << 24;
+  const size_t count = cap * 84 / 100; /* ~84% load, right under the grow threshold */
+  u64map m;
+  dg_timer_t timer;
+  uint64_t v, sum = 0;
+  size_t i, found, byte_probes, group_probes;
+
+  if (!u64map_init(&m, 0)) {
+    printf("u64map_init() failed\n");
+    return false;
+  }
+  for (i = 0; i < count; i++) {
+    uint64_t key = i * 2; /* odd keys are guaranteed misses */
+    if (!u64map_set(&m, &key, &key, NULL)) {
+      printf("u64map_set() failed at %zd\n", i);
+      u64map_destroy(&m);
+      return false;
+    }
+  }
+  printf("---- dg_map group probing: %zd entries, cap %zd, load %.1f%% ----\n",
+    m.size, m.cap, 100.0 * (double)m.size / (double)m.cap);
+
+  for (int miss = 0; miss < 2; miss++) {
+    uint64_t rng = 0x1234567ull;
+    byte_probes = group_probes = 0;
+    for (i = 0; i < NLOOKUPS; i++) {
+      rng = dg_splitmix64_(rng);
+      uint64_t key = (rng % count) * 2 + miss;
+      u64map_get_bytewise(&m, key, &v, &byte_probes);
+      group_probes += u64map_group_probes(&m, key);
+    }
+
+    rng = 0x1234567ull;
+    found = 0;
+    size_t dummy = 0;
+    dg_timer_start(&timer);
+    for (i = 0; i < NLOOKUPS; i++) {
+      rng = dg_splitmix64_(rng);
+      uint64_t key = (rng % count) * 2 + miss;
+      if (u64map_get_bytewise(&m, key, &v, &dummy)) { found++; sum += v; }
+    }
+    dg_timer_stop(&timer);
+    double ns_bytes = timer_get_elapsed(&timer) * 1e9 / NLOOKUPS;
+    size_t found_bytes = found;
+
+    rng = 0x1234567ull;
+    found = 0;
+    dg_timer_start(&timer);
+    for (i = 0; i < NLOOKUPS; i++) {
+      rng = dg_splitmix64_(rng);
+      uint64_t key = (rng % count) * 2 + miss;
+      if (u64map_get(&m, &key, &v)) { found++; sum += v; }
+    }
+    dg_timer_stop(&timer);
+    double ns_groups = timer_get_elapsed(&timer) * 1e9 / NLOOKUPS;
+
+    if (found != found_bytes || found != (miss ? 0 : NLOOKUPS)) {
+      printf("lookup results differ: bytewise %zd, groups %zd\n", found_bytes, found);
+      u64map_destroy(&m);
+      return false;
+    }
+    printf("  %s: bytewise %.2f probes %.2f ns/lookup | groups %.2f probes %.2f ns/lookup\n",
+      miss ? "misses" : "hits  ",
+      (double)byte_probes / NLOOKUPS, ns_bytes,
+      (double)group_probes / NLOOKUPS, ns_groups);
+  }
+  printf("  (checksum %llu)\n", (unsigned long long)sum);
+  u64map_destroy(&m);
+  return true;
+}
+
+bool test_map_batch_lookup()
+{
+  enum { NLOOKUPS = 1 << 23 };
+  static const size_t sizes[] = { (size_t)1 << 20, (size_t)16 << 20, (size_t)64 << 20 };
+  uint64_t* keys = (uint64_t*)malloc(NLOOKUPS * sizeof(uint64_t));
+  uint64_t* vals = (uint64_t*)malloc(NLOOKUPS * sizeof(uint64_t));
+  uint8_t* found = (uint8_t*)malloc(NLOOKUPS);
+  dg_timer_t timer;
+  if (!keys || !vals || !found) {
+    printf("lookup buffers allocation failed\n");
+    free(keys); free(vals); free(found);
+    return false;
+  }
+
+  printf("---- dg_map scalar _get vs _get_batch ----\n");
+  for (size_t s = 0; s < DG_ARRSIZE(sizes); s++) {
+    size_t i, nscalar = 0, nbatch;
+    uint64_t sum_scalar = 0, sum_batch = 0, v;
+    u64map m;
+    u64map_init(&m, sizes[s]);
+    for (i = 0; i < sizes[s]; i++) {
+      uint64_t key = dg_splitmix64_(i);
+      if (!u64map_set(&m, &key, &i, NULL)) {
+        printf("u64map_set() failed at %zd\n", i);
+        u64map_destroy(&m);
+        free(keys); free(vals); free(found);
+        return false;
+      }
+    }
+    /* 3/4 hits, 1/4 misses in random order */
+    uint64_t rng = 42;
+    for (i = 0; i < NLOOKUPS; i++) {
+      rng = dg_splitmix64_(rng);
+      keys[i] = (rng & 3) ? dg_splitmix64_(rng % sizes[s]) : rng;
+    }
+
+    dg_timer_start(&timer);
+    for (i = 0; i < NLOOKUPS; i++) {
+      if (u64map_get(&m, &keys[i], &v)) {
+        nscalar++;
+        sum_scalar += v;
+      }
+    }
+    dg_timer_stop(&timer);
+    double ns_scalar = timer_get_elapsed(&timer) * 1e9 / NLOOKUPS;
+
+    dg_timer_start(&timer);
+    nbatch = u64map_get_batch(&m, keys, NLOOKUPS, vals, found);
+    dg_timer_stop(&timer);
+    double ns_batch = timer_get_elapsed(&timer) * 1e9 / NLOOKUPS;
+    for (i = 0; i < NLOOKUPS; i++)
+      if (found[i])
+        sum_batch += vals[i];
+
+    u64map_destroy(&m);
+    if (nscalar != nbatch || sum_scalar != sum_batch) {
+      printf("batch results differ: scalar %zd hits, batch %zd hits\n", nscalar, nbatch);
+      free(keys); free(vals); free(found);
+      return false;
+    }
+    printf("  %4zdM entries: _get %.2f ns/key | _get_batch %.2f ns/key (%.2fx)\n",
+      sizes[s] >> 20, ns_scalar, ns_batch, ns_scalar / ns_batch);
+  }
+  free(keys); free(vals); free(found);
+  return true;
+}
+
+/* dg_cmap scaling benchmark: 1 shard (== one global rwlock) vs sharded */
+#define u64cmap_smap_KEY_FREE(k) ((void)0)
+#define u64cmap_smap_VAL_FREE(v) ((void)0)
+DG_CMAP_DECL(u64cmap, uint64_t, uint64_t)
+DG_CMAP_IMPL(u64cmap, uint64_t, uint64_t, bench_u64_hash, bench_u64_eq)
+
+typedef struct cmap_bench_thrd_s {
+  u64cmap*      pmap;
+  atomic_size_t* pgo;
+  uint64_t      seed;
+  size_t        nkeys;
+  size_t        nops;
+  unsigned      read_pct;
+  size_t        nhits;
+} cmap_bench_thrd_t;
+
+int cmap_bench_thread_proc(struct dg_thrd_data_s* ptinfo)
+{
+  cmap_bench_thrd_t* pctx = (cmap_bench_thrd_t*)ptinfo->puserdata;
+  uint64_t rng = pctx->seed, v;
+  while (!dg_atomic_load(pctx->pgo));
+  for (size_t i = 0; i < pctx->nops; i++) {
+    rng = dg_splitmix64_(rng);
+    uint64_t key = dg_splitmix64_(rng % pctx->nkeys);
+    if ((unsigned)((rng >> 32) % 100) < pctx->read_pct) {
+      pctx->nhits += (size_t)u64cmap_get(pctx->pmap, &key, &v);
+    }
+    else {
+      u64cmap_set(pctx->pmap, &key, &rng, NULL);
+    }
+  }
+  return 0;
+}
+
+bool test_cmap_scaling()
+{
+  enum { NKEYS = 1 << 20, NOPS_TOTAL = 1 << 23, MAX_THREADS = 64 };
+  static const size_t shard_counts[] = { 1, 64 };
+  static const unsigned read_pcts[] = { 50, 90, 99 };
+  static const size_t thread_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+  cmap_bench_thrd_t ctx[MAX_THREADS];
+  dg_thrd_t threads[MAX_THREADS];
+  dg_timer_t timer;
+
+  printf("---- dg_cmap throughput (Mops/s), %d keys ----\n", NKEYS);
+  for (size_t r = 0; r < DG_ARRSIZE(read_pcts); r++) {
+    for (size_t s = 0; s < DG_ARRSIZE(shard_counts); s++) {
+      printf("  %2u%% reads, %2zd shard(s):", read_pcts[r], shard_counts[s]);
+      for (size_t t = 0; t < DG_ARRSIZE(thread_counts); t++) {
+        size_t i, nthreads = thread_counts[t];
+        atomic_size_t go = 0;
+        u64cmap m;
+        if (!u64cmap_init(&m, shard_counts[s], NKEYS)) {
+          printf("\nu64cmap_init() failed\n");
+          return false;
+        }
+        for (i = 0; i < NKEYS; i++) {
+          uint64_t key = dg_splitmix64_(i);
+          u64cmap_set(&m, &key, &i, NULL);
+        }
+        for (i = 0; i < nthreads; i++) {
+          ctx[i].pmap = &m;
+          ctx[i].pgo = &go;
+          ctx[i].seed = 0x9E3779B97F4A7C15ull * (i + 1);
+          ctx[i].nkeys = NKEYS;
+          ctx[i].nops = NOPS_TOTAL / nthreads;
+          ctx[i].read_pct = read_pcts[r];
+          ctx[i].nhits = 0;
+          threads[i] = thread_create(0, cmap_bench_thread_proc, &ctx[i]);
+          if (!threads[i]) {
+            printf("\nthread_create() failed\n");
+            dg_atomic_store(&go, 1);
+            while (i--) {
+              thread_join(threads[i]);
+              thread_close(threads[i]);
+            }
+            u64cmap_destroy(&m);
+            return false;
+          }
+        }
+        dg_timer_start(&timer);
+        dg_atomic_store(&go, 1);
+        for (i = 0; i < nthreads; i++) {
+          thread_join(threads[i]);
+          thread_close(threads[i]);
+        }
+        dg_timer_stop(&timer);
+        if (u64cmap_size(&m) != NKEYS) {
+          printf("\nsize mismatch: %zd != %d\n", u64cmap_size(&m), NKEYS);
+          u64cmap_destroy(&m);
+          return false;
+        }
+        u64cmap_destroy(&m);
+        printf(" %zdT=%.1f", nthreads, (double)NOPS_TOTAL / timer_get_elapsed(&timer) * 1e-6);
+      }
+      printf("\n");
+    }
+  }
+  return true;
+}
+
+bool test_map_incremental_rehash()
+{
+  enum { NKEYS = 1 << 23 };
+  static const size_t budgets[] = { 0, 16, 64 };
+  double freq = (double)dg_get_perf_frequency();
+
+  printf("---- dg_map growth stalls, %d inserts from empty ----\n", NKEYS);
+  for (size_t b = 0; b < DG_ARRSIZE(budgets); b++) {
+    uint64_t worst = 0, total = 0, t0, dt;
+    size_t i, nslow = 0;
+    u64map m;
+    u64map_init(&m, 0);
+    u64map_set_rehash_budget(&m, budgets[b]);
+    for (i = 0; i < NKEYS; i++) {
+      uint64_t key = dg_splitmix64_(i);
+      t0 = dg_get_perf_counter();
+      if (!u64map_set(&m, &key, &i, NULL)) {
+        printf("u64map_set() failed at %zd\n", i);
+        u64map_destroy(&m);
+        return false;
+      }
+      dt = dg_get_perf_counter() - t0;
+      total += dt;
+      if (dt > worst) worst = dt;
+      if (dt * 1e3 > freq) nslow++; /* > 1 ms */
+    }
+    /* everything must be reachable, including entries still in the old table */
+    for (i = 0; i < NKEYS; i++) {
+      uint64_t key = dg_splitmix64_(i), v;
+      if (!u64map_get(&m, &key, &v) || v != i) {
+        printf("key %zd lost (budget %zd)\n", i, budgets[b]);
+        u64map_destroy(&m);
+        return false;
+      }
+    }
+    size_t pending = u64map_rehash_step(&m, 0);
+    u64map_destroy(&m);
+    printf("  budget %3zd: total %.1f ms, worst _set %.3f ms, %zd sets > 1 ms, %zd buckets pending\n",
+      budgets[b], total * 1e3 / freq, worst * 1e3 / freq, nslow, pending);
+  }
+  return true;
+}
+
+/* same map with tombstone-free erase; DG_MAP_BACKSHIFT is read where DG_MAP_IMPL expands */
+#undef DG_MAP_BACKSHIFT
+#define DG_MAP_BACKSHIFT 1
+#define u64map_bs_KEY_FREE(k) ((void)0)
+#define u64map_bs_VAL_FREE(v) ((void)0)
+DG_MAP_DECL(u64map_bs, uint64_t, uint64_t)
+DG_MAP_IMPL(u64map_bs, uint64_t, uint64_t, bench_u64_hash, bench_u64_eq)
+#undef DG_MAP_BACKSHIFT
+#define DG_MAP_BACKSHIFT 0
+
+static int cmp_double(const void* a, const void* b)
+{
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+/* sliding window of NLIVE keys: every op erases the oldest key, inserts a new one and looks up a live one.
+   Latency is sampled per group of OPS_PER_SAMPLE ops, p50/p99 are reported for the first and last round. */
+#define MAP_CHURN_RUN(T, title) do {\
+  T m;\
+  size_t i, r, next = 0;\
+  uint64_t rng = 7, v;\
+  T##_init(&m, NLIVE);\
+  for (i = 0; i < NLIVE; i++, next++) {\
+    uint64_t key = dg_splitmix64_(next);\
+    T##_set(&m, &key, &next, NULL);\
+  }\
+  printf("  %-12s", title);\
+  for (r = 0; r < NROUNDS; r++) {\
+    for (i = 0; i < NSAMPLES; i++) {\
+      uint64_t t0 = dg_get_perf_counter();\
+      for (size_t j = 0; j < OPS_PER_SAMPLE; j++, next++) {\
+        uint64_t old_key = dg_splitmix64_(next - NLIVE), key = dg_splitmix64_(next);\
+        rng = dg_splitmix64_(rng);\
+        uint64_t probe = dg_splitmix64_(next - 1 - rng % (NLIVE - 1));\
+        if (!T##_erase(&m, &old_key) || !T##_set(&m, &key, &next, NULL) || !T##_get(&m, &probe, &v)) {\
+          printf("\n" #T " churn failed at op %zd\n", next);\
+          T##_destroy(&m);\
+          free(samples);\
+          return false;\
+        }\
+      }\
+      samples[i] = (double)(dg_get_perf_counter() - t0) * 1e9 / freq / OPS_PER_SAMPLE;\
+    }\
+    if (r == 0 || r == NROUNDS - 1) {\
+      qsort(samples, NSAMPLES, sizeof(double), cmp_double);\
+      printf(" | round %zd: p50 %.0f ns, p99 %.0f ns, max %.0f ns, tombs %zd",\
+        r, samples[NSAMPLES / 2], samples[NSAMPLES * 99 / 100], samples[NSAMPLES - 1], m.tombs);\
+    }\
+  }\
+  printf("\n");\
+  T##_destroy(&m);\
+} while (0)
+
+bool test_map_churn()
+{
+  enum { NLIVE = 1 << 20, NROUNDS = 8, NSAMPLES = 1 << 12, OPS_PER_SAMPLE = 256 };
+  double freq = (double)dg_get_perf_frequency();
+  double* samples = (double*)malloc(NSAMPLES * sizeof(double));
+  if (!samples) {
+    printf("samples allocation failed\n");
+    return false;
+  }
+  printf("---- dg_map churn, %d live keys, erase+set+get per op ----\n", NLIVE);
+  MAP_CHURN_RUN(u64map, "tombstones");
+  MAP_CHURN_RUN(u64map_bs, "backshift");
+  free(samples);
+  return true;
+}
+
+/* interleaved {key,val} slots without the stored hash; both knobs are read where DG_MAP_IMPL expands */
+#undef DG_MAP_SLOTS
+#undef DG_MAP_STORE_HASH
+#define DG_MAP_SLOTS 1
+#define DG_MAP_STORE_HASH 0
+#define u64map_packed_KEY_FREE(k) ((void)0)
+#define u64map_packed_VAL_FREE(v) ((void)0)
+DG_MAP_DECL(u64map_packed, uint64_t, uint64_t)
+DG_MAP_IMPL(u64map_packed, uint64_t, uint64_t, bench_u64_hash, bench_u64_eq)
+#undef DG_MAP_SLOTS
+#undef DG_MAP_STORE_HASH
+#define DG_MAP_SLOTS 0
+#define DG_MAP_STORE_HASH 1
+
+#define MAP_LAYOUT_RUN(T, title, slot_bytes) do {\
+  T m;\
+  size_t i, nfound = 0;\
+  uint64_t sum = 0, v;\
+  T##_init(&m, sizes[s]);\
+  for (i = 0; i < sizes[s]; i++) {\
+    uint64_t key = dg_splitmix64_(i);\
+    if (!T##_set(&m, &key, &i, NULL)) {\
+      printf(#T "_set() failed at %zd\n", i);\
+      T##_destroy(&m);\
+      free(keys);\
+      return false;\
+    }\
+  }\
+  dg_timer_start(&timer);\
+  for (i = 0; i < NLOOKUPS; i++) {\
+    if (T##_get(&m, &keys[i], &v)) {\
+      nfound++;\
+      sum += v;\
+    }\
+  }\
+  dg_timer_stop(&timer);\
+  printf("  %4zdM %-22s %6.2f ns/key, %2zd bytes/slot, %7.1f MB\n", sizes[s] >> 20, title,\
+    timer_get_elapsed(&timer) * 1e9 / NLOOKUPS, (size_t)(slot_bytes), (double)m.cap * (slot_bytes) / (1 << 20));\
+  T##_destroy(&m);\
+  if (nfound != NLOOKUPS) {\
+    printf(#T ": %zd of %d keys found\n", nfound, NLOOKUPS);\
+    free(keys);\
+    return false;\
+  }\
+  checksum += sum;\
+} while (0)
+
+bool test_map_layout()
+{
+  enum { NLOOKUPS = 1 << 23 };
+  static const size_t sizes[] = { (size_t)1 << 20, (size_t)16 << 20, (size_t)64 << 20 };
+  uint64_t* keys = (uint64_t*)malloc(NLOOKUPS * sizeof(uint64_t));
+  uint64_t checksum = 0;
+  dg_timer_t timer;
+  if (!keys) {
+    printf("lookup buffer allocation failed\n");
+    return false;
+  }
+  printf("---- dg_map layouts: parallel arrays + hash vs {key,val} slots without hash ----\n");
+  for (size_t s = 0; s < DG_ARRSIZE(sizes); s++) {
+    uint64_t rng = 11;
+    for (size_t i = 0; i < NLOOKUPS; i++) {
+      rng = dg_splitmix64_(rng);
+      keys[i] = dg_splitmix64_(rng % sizes[s]);
+    }
+    MAP_LAYOUT_RUN(u64map, "arrays + hash", 1 + sizeof(uint64_t) * 3);
+    MAP_LAYOUT_RUN(u64map_packed, "slots, no hash", 1 + sizeof(u64map_packed_slot));
+  }
+  printf("  checksum %llx\n", (unsigned long long)checksum);
+  free(keys);
+  return true;
+}
+
+/* dg_map snapshot: rebuild from scratch vs save once + map the file at start-up */
+DG_MAP_SNAPSHOT_IMPL(u64map, uint64_t, uint64_t, bench_u64_hash)
+
+bool test_map_snapshot()
+{
+  enum { NKEYS = 16 << 20, NLOOKUPS = 1 << 22 };
+  const wchar_t* fname = L"map_snapshot.dgms";
+  u64map m, mm;
+  dg_file_t fh;
+  dg_timer_t timer;
+  size_t i, nmismatch = 0;
+  uint64_t v, mv;
+  int res;
+
+  res = fs_add_search_path("cwd", L".", 0);
+  if (res != 0 && res != 1) {
+    printf("fs_add_search_path() returned %d\n", res);
+    return false;
+  }
+  dg_pathid_t pid = fs_get_path_id("cwd");
+
+  printf("---- dg_map snapshot: %d entries ----\n", NKEYS);
+  dg_timer_start(&timer);
+  u64map_init(&m, 0);
+  for (i = 0; i < NKEYS; i++) {
+    uint64_t key = dg_splitmix64_(i);
+    if (!u64map_set(&m, &key, &i, NULL)) {
+      printf("u64map_set() failed at %zd\n", i);
+      u64map_destroy(&m);
+      return false;
+    }
+  }
+  dg_timer_stop(&timer);
+  printf("  build:              %8.1f ms\n", timer_get_elapsed(&timer) * 1e3);
+
+  res = fs_open_file(&fh, pid, fname, FS_BIN, FS_W | FS_TRUNC);
+  if (res != 0) {
+    printf("fs_open_file(write) returned %d\n", res);
+    u64map_destroy(&m);
+    return false;
+  }
+  dg_timer_start(&timer);
+  res = u64map_save(&m, fh);
+  dg_timer_stop(&timer);
+  fs_close(fh);
+  if (res != 0) {
+    printf("u64map_save() returned %d\n", res);
+    u64map_destroy(&m);
+    return false;
+  }
+  printf("  save:               %8.1f ms\n", timer_get_elapsed(&timer) * 1e3);
+
+  dg_timer_start(&timer);
+  res = u64map_open_mapped(&mm, pid, fname, 0);
+  dg_timer_stop(&timer);
+  if (res != 0) {
+    printf("u64map_open_mapped() returned %d\n", res);
+    u64map_destroy(&m);
+    return false;
+  }
+  printf("  open_mapped:        %8.3f ms\n", timer_get_elapsed(&timer) * 1e3);
+
+  /* first touch pays the page faults */
+  uint64_t rng = 5;
+  dg_timer_start(&timer);
+  for (i = 0; i < NLOOKUPS; i++) {
+    rng = dg_splitmix64_(rng);
+    uint64_t key = dg_splitmix64_(rng % NKEYS);
+    int found = u64map_get(&mm, &key, &mv);
+    if (!found || !u64map_get(&m, &key, &v) || v != mv)
+      nmismatch++;
+  }
+  dg_timer_stop(&timer);
+  printf("  %d lookups (cold):  %8.1f ms\n", NLOOKUPS, timer_get_elapsed(&timer) * 1e3);
+
+  if (u64map_size(&mm) != u64map_size(&m) || u64map_set(&mm, &v, &v, NULL) || u64map_erase(&mm, &v))
+    nmismatch++;
+  u64map_destroy(&mm);
+
+  dg_timer_start(&timer);
+  res = u64map_open_mapped(&mm, pid, fname, DG_MAP_SNAP_VERIFY);
+  dg_timer_stop(&timer);
+  printf("  open_mapped+verify: %8.1f ms (%d)\n", timer_get_elapsed(&timer) * 1e3, res);
+  u64map_destroy(&mm);
+  u64map_destroy(&m);
+  fs_remove(pid, fname);
+
+  if (res != 0 || nmismatch) {
+    printf("snapshot mismatch: verify %d, %zd lookups differ\n", res, nmismatch);
+    return false;
+  }
+  return true;
+}
+
+/* dg_map bulk load: n x _set vs _build_from on a thread pool */
+DG_MAP_BUILD_IMPL(u64map, uint64_t, uint64_t, bench_u64_hash, bench_u64_eq)
+
+bool test_map_build()
+{
+  enum { NKEYS = 16 << 20 };
+  static const size_t nthreads[] = { 1, 2, 4, 8 };
+  uint64_t* keys = (uint64_t*)malloc(NKEYS * sizeof(uint64_t));
+  uint64_t* vals = (uint64_t*)malloc(NKEYS * sizeof(uint64_t));
+  dg_timer_t timer;
+  u64map ref, m;
+  size_t i;
+  if (!keys || !vals) {
+    printf("input buffers allocation failed\n");
+    free(keys);
+    free(vals);
+    return false;
+  }
+  /* every 8th key is a duplicate: the later value has to win */
+  for (i = 0; i < NKEYS; i++) {
+    keys[i] = dg_splitmix64_(i & 7 ? i : i / 8);
+    vals[i] = i;
+  }
+
+  printf("---- dg_map bulk load: %d pairs ----\n", NKEYS);
+  u64map_init(&ref, 0);
+  dg_timer_start(&timer);
+  for (i = 0; i < NKEYS; i++)
+    u64map_set(&ref, &keys[i], &vals[i], NULL);
+  dg_timer_stop(&timer);
+  printf("  %zd x _set:         %8.1f ms\n", (size_t)NKEYS, timer_get_elapsed(&timer) * 1e3);
+
+  bool ok = true;
+  for (size_t t = 0; t < DG_ARRSIZE(nthreads) && ok; t++) {
+    u64map_init(&m, 0);
+    dg_timer_start(&timer);
+    ok = u64map_build_from(&m, keys, vals, NKEYS, nthreads[t]) != 0;
+    dg_timer_stop(&timer);
+    printf("  build_from, %zd threads: %6.1f ms\n", nthreads[t], timer_get_elapsed(&timer) * 1e3);
+    ok = ok && u64map_size(&m) == u64map_size(&ref);
+    for (i = 0; i < NKEYS && ok; i++) {
+      uint64_t a, b;
+      ok = u64map_get(&m, &keys[i], &a) && u64map_get(&ref, &keys[i], &b) && a == b;
+    }
+    u64map_destroy(&m);
+    if (!ok)
+      printf("build_from(%zd threads) differs from _set at key %zd\n", nthreads[t], i);
+  }
+  u64map_destroy(&ref);
+  free(keys);
+  free(vals);
+  return ok;
+}
+
+/* the previous dg_hash_bytes (one SplitMix64 round per 8-byte word), kept as the baseline */
+static uint64_t hash_bytes_splitmix(const void* data, size_t len)
+{
+  const uint8_t* p = (const uint8_t*)data;
+  uint64_t h = 0xA0761D6478BD642Full ^ (uint64_t)len;
+  while (len >= 8) {
+    uint64_t k;
+    memcpy(&k, p, 8);
+    h = dg_splitmix64_(h ^ k);
+    p += 8; len -= 8;
+  }
+  uint64_t tail = 0;
+  for (size_t i = 0; i < len; ++i) tail |= (uint64_t)p[i] << (i * 8);
+  return dg_splitmix64_(h ^ tail);
+}
+
+/* hashes keys of length len taken from a 64 KB buffer (cache resident), returns ns per hash.
+   impl -2 is the old hash, -1 the inlined dg_hash_bytes, otherwise hash_bytes with impl selected */
+static double hash_bench_run(int impl, const uint8_t* buf, size_t len, size_t niters, uint64_t* psink)
+{
+  dg_timer_t timer;
+  uint64_t sink = 0;
+  size_t mask = (64 << 10) - 4096 - 1;
+  dg_timer_start(&timer);
+  if (impl == -2) {
+    for (size_t i = 0; i < niters; i++)
+      sink += hash_bytes_splitmix(buf + ((i * 61) & mask), len);
+  }
+  else if (impl == -1) {
+    for (size_t i = 0; i < niters; i++)
+      sink += dg_hash_bytes(buf + ((i * 61) & mask), len);
+  }
+  else {
+    for (size_t i = 0; i < niters; i++)
+      sink += hash_bytes(buf + ((i * 61) & mask), len);
+  }
+  dg_timer_stop(&timer);
+  *psink ^= sink;
+  return timer_get_elapsed(&timer) * 1e9 / (double)niters;
+}
+
+bool test_hash_throughput()
+{
+  static const size_t lens[] = { 4, 8, 16, 32, 64, 128, 256, 1024, 4096 };
+  uint8_t* buf = (uint8_t*)malloc(64 << 10);
+  uint64_t sink = 0;
+  int impl;
+  if (!buf) {
+    printf("buffer allocation failed\n");
+    return false;
+  }
+  for (size_t i = 0; i < (64 << 10); i++)
+    buf[i] = (uint8_t)dg_splitmix64_(i);
+
+  printf("---- byte hash throughput, ns/hash (GB/s) ----\n");
+  printf("  %6s %18s %18s", "len", "splitmix(old)", "dg_hash_bytes");
+  for (impl = 0; impl < DGHASH_IMPL_AUTO; impl++)
+    if (hash_impl_supported(impl))
+      printf(" %18s", hash_impl_name(impl));
+  printf("\n");
+
+  for (size_t l = 0; l < DG_ARRSIZE(lens); l++) {
+    size_t niters = ((size_t)256 << 20) / lens[l];
+    if (niters > ((size_t)16 << 20))
+      niters = (size_t)16 << 20;
+    double ns = hash_bench_run(-2, buf, lens[l], niters, &sink);
+    printf("  %6zd %8.2f (%6.2f)", lens[l], ns, lens[l] / ns);
+    ns = hash_bench_run(-1, buf, lens[l], niters, &sink);
+    printf(" %8.2f (%6.2f)", ns, lens[l] / ns);
+    for (impl = 0; impl < DGHASH_IMPL_AUTO; impl++) {
+      if (hash_select_impl(impl) != DGERR_SUCCESS)
+        continue;
+      ns = hash_bench_run(impl, buf, lens[l], niters, &sink);
+      printf(" %8.2f (%6.2f)", ns, lens[l] / ns);
+    }
+    printf("\n");
+  }
+  hash_select_impl(DGHASH_IMPL_AUTO);
+  printf("  auto selects: %s (sink %llx)\n", hash_impl_name(hash_get_impl()), (unsigned long long)sink);
+  free(buf);
+  return true;
+}
+
+/* key sets for the hash quality test, returns key length written to pkey (at most 128 bytes) */
+enum { HQ_DECIMAL, HQ_PATHS, HQ_COUNTER, HQ_SPARSE, HQ_ZEROS, HQ_COUNT };
+static const char* hq_names[HQ_COUNT] = { "decimal", "paths", "counter@60/100", "sparse 1-2 bits/64", "zeros 0..128" };
+static const size_t hq_sizes[HQ_COUNT] = { 1 << 20, 1 << 20, 1 << 20, 512 + 512 * 511 / 2, 129 };
+
+static size_t hash_quality_key(int set, size_t i, uint8_t* pkey)
+{
+  switch (set) {
+  case HQ_DECIMAL:
+    return (size_t)sprintf((char*)pkey, "%zu", i);
+  case HQ_PATHS:
+    return (size_t)sprintf((char*)pkey, "/usr/share/assets/textures/terrain/tile_%zu.dds", i);
+  case HQ_COUNTER: {
+    uint32_t v = (uint32_t)i;
+    memset(pkey, 0, 100);
+    memcpy(pkey + 60, &v, 4);
+    return 100;
+  }
+  case HQ_SPARSE:
+    memset(pkey, 0, 64);
+    if (i < 512) {
+      pkey[i / 8] |= (uint8_t)(1 << (i % 8));
+    }
+    else {
+      size_t a = 0, k = i - 512;
+      while (k >= 511 - a) k -= 511 - a++;
+      size_t b = a + 1 + k;
+      pkey[a / 8] |= (uint8_t)(1 << (a % 8));
+      pkey[b / 8] |= (uint8_t)(1 << (b % 8));
+    }
+    return 64;
+  default:
+    memset(pkey, 0, i);
+    return i;
+  }
+}
+
+static int cmp_u64(const void* a, const void* b)
+{
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+bool test_hash_quality()
+{
+  enum { AV_SAMPLES = 2000, AV_MAXLEN = 128 };
+  static const size_t av_lens[] = { 4, 16, 24, 40, 128 };
+  uint64_t* hs = (uint64_t*)malloc(((size_t)1 << 20) * sizeof(uint64_t));
+  uint32_t* buckets = (uint32_t*)malloc(65536 * sizeof(uint32_t));
+  uint32_t* flips = (uint32_t*)malloc(AV_MAXLEN * 8 * 64 * sizeof(uint32_t));
+  uint8_t key[256];
+  bool ok = hs && buckets && flips;
+  if (!ok)
+    printf("buffers allocation failed\n");
+
+  printf("---- byte hash quality ----\n");
+  for (int impl = 0; impl < DGHASH_IMPL_AUTO && ok; impl++) {
+    if (hash_select_impl(impl) != DGERR_SUCCESS)
+      continue;
+    printf("  %s:\n", hash_impl_name(impl));
+
+    /* short keys must not depend on the implementation */
+    for (size_t len = 0; len <= 32 && ok; len++) {
+      for (size_t i = 0; i < len; i++)
+        key[i] = (uint8_t)(i * 37 + len);
+      ok = hash_bytes(key, len) == dg_hash_bytes(key, len) && hash_bytes_seed(key, len, 5) == dg_hash_bytes_seed(key, len, 5);
+      if (!ok)
+        printf("    %zd-byte key hashes differently from dg_hash_bytes\n", len);
+    }
+
+    /* full 64-bit collisions (none expected at 2^20 keys) and chi-square of the low 16 bits */
+    for (int set = 0; set < HQ_COUNT && ok; set++) {
+      size_t n = hq_sizes[set], ncoll = 0;
+      memset(buckets, 0, 65536 * sizeof(uint32_t));
+      for (size_t i = 0; i < n; i++) {
+        hs[i] = hash_bytes(key, hash_quality_key(set, i, key));
+        buckets[hs[i] & 0xffff]++;
+      }
+      qsort(hs, n, sizeof(uint64_t), cmp_u64);
+      for (size_t i = 1; i < n; i++)
+        ncoll += hs[i] == hs[i - 1];
+      printf("    %-20s %8zd keys, %zd collisions", hq_names[set], n, ncoll);
+      if (n >= 65536) {
+        double e = (double)n / 65536.0, chi2 = 0.0;
+        for (size_t b = 0; b < 65536; b++)
+          chi2 += ((double)buckets[b] - e) * ((double)buckets[b] - e) / e;
+        double z = (chi2 - 65535.0) / sqrt(2.0 * 65535.0);
+        printf(", low 16 bits chi2 z = %+.2f", z);
+        ok = z > -6.0 && z < 6.0;
+      }
+      printf("\n");
+      ok = ok && ncoll == 0;
+    }
+
+    /* avalanche: every input bit flip should flip each output bit with probability 1/2 */
+    for (size_t l = 0; l < DG_ARRSIZE(av_lens) && ok; l++) {
+      size_t len = av_lens[l], nbits = len * 8;
+      double total = 0.0, maxbias = 0.0;
+      memset(flips, 0, nbits * 64 * sizeof(uint32_t));
+      for (size_t s = 0; s < AV_SAMPLES; s++) {
+        for (size_t i = 0; i < len; i++)
+          key[i] = (uint8_t)dg_splitmix64_(s * 1000003 + i);
+        uint64_t h0 = hash_bytes(key, len);
+        for (size_t bit = 0; bit < nbits; bit++) {
+          key[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+          uint64_t d = hash_bytes(key, len) ^ h0;
+          key[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+          for (int k = 0; k < 64; k++)
+            flips[bit * 64 + k] += (uint32_t)((d >> k) & 1);
+        }
+      }
+      for (size_t c = 0; c < nbits * 64; c++) {
+        double p = (double)flips[c] / AV_SAMPLES;
+        double bias = p > 0.5 ? p - 0.5 : 0.5 - p;
+        total += flips[c];
+        if (bias > maxbias)
+          maxbias = bias;
+      }
+      double avg = total / ((double)AV_SAMPLES * nbits);
+      printf("    avalanche %4zd bytes: %.2f bits flipped, worst bit bias %.3f\n", len, avg, maxbias);
+      ok = avg > 31.5 && avg < 32.5 && maxbias < 0.1;
+    }
+  }
+  hash_select_impl(DGHASH_IMPL_AUTO);
+  free(hs);
+  free(buckets);
+  free(flips);
+  return ok;
+}
+
+/* owned C string keys; lookups by dg_strview come from DG_MAP_HETERO_IMPL */
+static inline uint64_t bench_str_hash(const char* s) { return dg_hash_str(s); }
+#define bench_str_eq(a, b) (strcmp((a), (b)) == 0)
+#define strmap_KEY_FREE(k) free((void*)*(k))
+#define strmap_VAL_FREE(v) ((void)0)
+DG_MAP_DECL(strmap, const char*, uint32_t)
+DG_MAP_IMPL(strmap, const char*, uint32_t, bench_str_hash, bench_str_eq)
+DG_MAP_HETERO_IMPL(strmap, const char*, uint32_t, view, dg_strview, dg_hash_strview, dg_str_eq_view)
+
+/* the same keys probed in NMAPS maps: _get per map vs one hash + _get_hashed per map;
+   space separated tokens of a text buffer: NUL-terminated copy + _get vs _get_view */
+bool test_map_hashed_lookup()
+{
+  enum { NWORDS = 1 << 18, NMAPS = 4, NROUNDS = 4 };
+  static const char* dirs[] = { "textures", "meshes", "sounds/ambient", "scripts/ai/behaviour", "ui" };
+  const char** words = (const char**)malloc(NWORDS * sizeof(char*));
+  char* text = (char*)malloc((size_t)NWORDS * 64);
+  strmap maps[NMAPS];
+  dg_timer_t timer;
+  size_t i, j, r, tlen = 0;
+  uint64_t sum0 = 0, sum1 = 0;
+  bool ok = words && text;
+  if (!ok) {
+    printf("buffers allocation failed\n");
+    free(words);
+    free(text);
+    return false;
+  }
+  for (j = 0; j < NMAPS; j++)
+    strmap_init(&maps[j], NWORDS);
+  for (i = 0; i < NWORDS; i++) {
+    char buf[64];
+    int len = sprintf(buf, "assets/%s/%08x.bin", dirs[i % DG_ARRSIZE(dirs)], (uint32_t)dg_splitmix64_(i));
+    char* word = (char*)malloc((size_t)len + 1);
+    memcpy(word, buf, (size_t)len + 1);
+    words[i] = word;
+    memcpy(text + tlen, buf, (size_t)len);
+    tlen += (size_t)len;
+    text[tlen++] = ' ';
+    /* map j holds every (j + 1)-th word, keys are owned copies */
+    for (j = 0; j < NMAPS; j++) {
+      if (i % (j + 1) == 0) {
+        char* copy = (char*)malloc((size_t)len + 1);
+        const char* key = copy;
+        uint32_t v = (uint32_t)(i * NMAPS + j);
+        memcpy(copy, buf, (size_t)len + 1);
+        ok = ok && strmap_set_hashed(&maps[j], dg_hash_strview(dg_strview_make(buf, (size_t)len)), &key, &v, NULL);
+      }
+    }
+  }
+
+  printf("---- dg_map precomputed hash / heterogeneous lookup: %d keys, %d maps ----\n", NWORDS, NMAPS);
+  dg_timer_start(&timer);
+  for (r = 0; r < NROUNDS; r++) {
+    for (i = 0; i < NWORDS; i++) {
+      for (j = 0; j < NMAPS; j++) {
+        uint32_t v;
+        if (strmap_get(&maps[j], &words[i], &v))
+          sum0 += v;
+      }
+    }
+  }
+  dg_timer_stop(&timer);
+  printf("  _get per map:            %8.1f ns/key\n", timer_get_elapsed(&timer) * 1e9 / (NROUNDS * NWORDS));
+  dg_timer_start(&timer);
+  for (r = 0; r < NROUNDS; r++) {
+    for (i = 0; i < NWORDS; i++) {
+      uint64_t h = bench_str_hash(words[i]);
+      for (j = 0; j < NMAPS; j++) {
+        uint32_t v;
+        if (strmap_get_hashed(&maps[j], h, &words[i], &v))
+          sum1 += v;
+      }
+    }
+  }
+  dg_timer_stop(&timer);
+  printf("  hash once + _get_hashed: %8.1f ns/key\n", timer_get_elapsed(&timer) * 1e9 / (NROUNDS * NWORDS));
+  ok = ok && sum0 == sum1;
+
+  sum0 = sum1 = 0;
+  dg_timer_start(&timer);
+  for (r = 0; r < NROUNDS; r++) {
+    for (const char* p = text; p < text + tlen;) {
+      char tmp[64];
+      const char* e = (const char*)memchr(p, ' ', (size_t)(text + tlen - p));
+      const char* key = tmp;
+      uint32_t v;
+      memcpy(tmp, p, (size_t)(e - p));
+      tmp[e - p] = '\0';
+      if (strmap_get(&maps[0], &key, &v))
+        sum0 += v;
+      p = e + 1;
+    }
+  }
+  dg_timer_stop(&timer);
+  printf("  token copy + _get:       %8.1f ns/token\n", timer_get_elapsed(&timer) * 1e9 / (NROUNDS * NWORDS));
+  dg_timer_start(&timer);
+  for (r = 0; r < NROUNDS; r++) {
+    for (const char* p = text; p < text + tlen;) {
+      const char* e = (const char*)memchr(p, ' ', (size_t)(text + tlen - p));
+      uint32_t v;
+      if (strmap_get_view(&maps[0], dg_strview_make(p, (size_t)(e - p)), &v))
+        sum1 += v;
+      p = e + 1;
+    }
+  }
+  dg_timer_stop(&timer);
+  printf("  _get_view:               %8.1f ns/token\n", timer_get_elapsed(&timer) * 1e9 / (NROUNDS * NWORDS));
+  ok = ok && sum0 == sum1;
+
+  /* a prefix or an extension of a stored key must not match */
+  ok = ok && !strmap_get_view(&maps[0], dg_strview_make(words[0], strlen(words[0]) - 1), NULL);
+  ok = ok && !strmap_get_view(&maps[0], dg_strview_make(text, strlen(words[0]) + 1), NULL);
+  for (i = 0; i < NWORDS && ok; i += 2) {
+    ok = strmap_erase_view(&maps[1], dg_strview_make(words[i], strlen(words[i])));
+    ok = ok && !strmap_get_ref_view(&maps[1], dg_strview_make(words[i], strlen(words[i])));
+  }
+  ok = ok && strmap_size(&maps[1]) == 0;
+  if (!ok)
+    printf("hashed/heterogeneous lookups disagree with _get\n");
+
+  for (j = 0; j < NMAPS; j++)
+    strmap_destroy(&maps[j]);
+  for (i = 0; i < NWORDS; i++)
+    free((void*)words[i]);
+  free(words);
+  free(text);
+  return ok;
+}
+
+/* dg_treemap instantiation (u64 -> u64) */
+static inline int bench_u64_cmp(uint64_t a, uint64_t b) { return (a > b) - (a < b); }
+DG_TMAP_DECL(u64tmap, uint64_t, uint64_t)
+DG_TMAP_IMPL(u64tmap, uint64_t, uint64_t, bench_u64_cmp)
+
+/* red-black invariants below node n; returns black height or -1 */
+static int u64tmap_check(const u64tmap* m, uint32_t n, uint32_t parent)
+{
+  if (!n)
+    return 1;
+  const u64tmap_node* N = m->nodes;
+  if (u64tmap__par_(N, n) != parent)
+    return -1;
+  if (u64tmap__red_(N, n) && (u64tmap__red_(N, N[n].left) || u64tmap__red_(N, N[n].right)))
+    return -1;
+  if ((N[n].left && N[N[n].left].key >= N[n].key) || (N[n].right && N[N[n].right].key <= N[n].key))
+    return -1;
+  int hl = u64tmap_check(m, N[n].left, n), hr = u64tmap_check(m, N[n].right, n);
+  if (hl < 0 || hl != hr)
+    return -1;
+  return hl + !u64tmap__red_(N, n);
+}
+
+static double u64tmap_iter_ns(const u64tmap* m, uint64_t* psum)
+{
+  dg_timer_t timer;
+  uint64_t sum = 0;
+  dg_timer_start(&timer);
+  for (u64tmap_it it = u64tmap_iter_begin(m); it; it = u64tmap_iter_next(m, it))
+    sum += *u64tmap_iter_val(m, it);
+  dg_timer_stop(&timer);
+  *psum = sum;
+  return timer_get_elapsed(&timer) * 1e9 / (double)u64tmap_size(m);
+}
+
+/* index-linked nodes: insert/lookup/iteration cost, in-order iteration after _compact, free list reuse */
+bool test_tmap_nodes()
+{
+  enum { NKEYS = 1 << 22 };
+  u64tmap m;
+  dg_timer_t timer;
+  uint64_t i, v, sum0, sum1;
+  bool ok = true;
+
+  printf("---- dg_treemap index nodes: %d keys, %zd bytes per node ----\n", NKEYS, sizeof(u64tmap_node));
+  u64tmap_init(&m);
+  dg_timer_start(&timer);
+  for (i = 0; i < NKEYS; i++) {
+    v = i;
+    ok = ok && u64tmap_insert(&m, dg_splitmix64_(i), &v, NULL);
+  }
+  dg_timer_stop(&timer);
+  printf("  random insert:        %8.1f ns/key\n", timer_get_elapsed(&timer) * 1e9 / NKEYS);
+  dg_timer_start(&timer);
+  for (i = 0; i < NKEYS && ok; i++)
+    ok = u64tmap_get(&m, dg_splitmix64_(i), &v) && v == i;
+  dg_timer_stop(&timer);
+  printf("  random lookup:        %8.1f ns/key\n", timer_get_elapsed(&timer) * 1e9 / NKEYS);
+  printf("  in-order iteration:   %8.1f ns/key\n", u64tmap_iter_ns(&m, &sum0));
+  dg_timer_start(&timer);
+  ok = ok && u64tmap_compact(&m);
+  dg_timer_stop(&timer);
+  printf("  _compact:             %8.1f ms\n", timer_get_elapsed(&timer) * 1e3);
+  printf("  iteration, compacted: %8.1f ns/key\n", u64tmap_iter_ns(&m, &sum1));
+  ok = ok && sum0 == sum1 && u64tmap_check(&m, m.root, 0) > 0;
+
+  /* erase every other key while iterating, then reinsert: erased slots are reused */
+  uint64_t prev = 0;
+  size_t k = 0;
+  for (u64tmap_it it = u64tmap_iter_begin(&m); it && ok; k++) {
+    ok = k == 0 || *u64tmap_iter_key(&m, it) > prev;
+    prev = *u64tmap_iter_key(&m, it);
+    it = (k & 1) ? u64tmap_erase_at(&m, it) : u64tmap_iter_next(&m, it);
+  }
+  uint32_t used = m.used;
+  ok = ok && u64tmap_size(&m) == NKEYS / 2 && u64tmap_check(&m, m.root, 0) > 0;
+  for (i = 0; i < NKEYS && ok; i++) {
+    v = i;
+    ok = u64tmap_insert(&m, dg_splitmix64_(i), &v, NULL);
+  }
+  ok = ok && u64tmap_size(&m) == NKEYS && m.used == used && u64tmap_check(&m, m.root, 0) > 0;
+  for (i = 0; i < NKEYS && ok; i++)
+    ok = u64tmap_erase(&m, dg_splitmix64_(i));
+  ok = ok && u64tmap_size(&m) == 0 && m.root == 0;
+  if (!ok)
+    printf("tree map check failed\n");
+  u64tmap_destroy(&m);
+  return ok;
+}
+
+/* rebuilding from a sorted dump: insert loop vs _build_sorted, merging two halves vs inserting one into the other */
+bool test_tmap_build()
+{
+  enum { NKEYS = 1 << 22 };
+  u64tmap m, h;
+  dg_timer_t timer;
+  uint64_t *keys, *vals, v;
+  size_t i;
+  bool ok = true;
+
+  printf("---- dg_treemap bulk build: %d sorted keys ----\n", NKEYS);
+  keys = (uint64_t*)malloc(NKEYS * sizeof(uint64_t));
+  vals = (uint64_t*)malloc(NKEYS * sizeof(uint64_t));
+  if (!keys || !vals) {
+    free(keys);
+    free(vals);
+    return false;
+  }
+  for (i = 0; i < NKEYS; i++) {
+    keys[i] = i * 2 + 1;
+    vals[i] = i;
+  }
+  u64tmap_init(&m);
+  u64tmap_init(&h);
+  dg_timer_start(&timer);
+  for (i = 0; i < NKEYS; i++)
+    ok = ok && u64tmap_insert(&m, keys[i], &vals[i], NULL);
+  dg_timer_stop(&timer);
+  printf("  insert loop:   %8.1f ns/key\n", timer_get_elapsed(&timer) * 1e9 / NKEYS);
+  u64tmap_destroy(&m);
+  u64tmap_init(&m);
+  dg_timer_start(&timer);
+  ok = ok && u64tmap_build_sorted(&m, keys, vals, NKEYS);
+  dg_timer_stop(&timer);
+  printf("  _build_sorted: %8.1f ns/key\n", timer_get_elapsed(&timer) * 1e9 / NKEYS);
+  ok = ok && u64tmap_size(&m) == NKEYS && u64tmap_check(&m, m.root, 0) > 0;
+  for (i = 0; i < NKEYS && ok; i += 97)
+    ok = u64tmap_get(&m, keys[i], &v) && v == i;
+
+  /* second tree holds the even keys and one duplicate, whose value must win */
+  for (i = 0; i < NKEYS; i++)
+    keys[i] = i * 2;
+  v = ~0ull;
+  ok = ok && u64tmap_build_sorted(&h, keys, vals, NKEYS) && u64tmap_insert(&h, 1, &v, NULL);
+  dg_timer_start(&timer);
+  ok = ok && u64tmap_merge(&m, &h);
+  dg_timer_stop(&timer);
+  printf("  _merge:        %8.1f ns/key\n", timer_get_elapsed(&timer) * 1e9 / (2.0 * NKEYS));
+  ok = ok && u64tmap_size(&m) == 2 * NKEYS && u64tmap_size(&h) == 0 && u64tmap_check(&m, m.root, 0) > 0;
+  ok = ok && u64tmap_get(&m, 1, &v) && v == ~0ull;
+  uint64_t expect = 0;
+  for (u64tmap_it it = u64tmap_iter_begin(&m); it && ok; it = u64tmap_iter_next(&m, it))
+    ok = *u64tmap_iter_key(&m, it) == expect++;
+
+  /* unsorted input is rejected and leaves the map alone */
+  keys[0] = 5;
+  keys[1] = 5;
+  ok = ok && !u64tmap_build_sorted(&m, keys, vals, 2) && u64tmap_size(&m) == 2 * NKEYS;
+  if (!ok)
+    printf("tree map bulk build check failed\n");
+  u64tmap_destroy(&h);
+  u64tmap_destroy(&m);
+  free(vals);
+  free(keys);
+  return ok;
+}
+
+/* dg_treemap with order statistics (u64 -> u64) */
+DG_TMAP_DECL_OS(u64ostmap, uint64_t, uint64_t)
+DG_TMAP_IMPL_OS(u64ostmap, uint64_t, uint64_t, bench_u64_cmp)
+
+/* subtree counters below node n; returns the subtree size or -1 */
+static int u64ostmap_check(const u64ostmap* m, uint32_t n)
+{
+  if (!n)
+    return 0;
+  const u64ostmap_node* N = m->nodes;
+  int l = u64ostmap_check(m, N[n].left), r = u64ostmap_check(m, N[n].right);
+  if (l < 0 || r < 0 || (int)N[n].count != l + r + 1)
+    return -1;
+  return l + r + 1;
+}
+
+/* percentiles and range counts: iterator walks vs _select/_rank/_count_range, cost of keeping the counters */
+bool test_tmap_order_stats()
+{
+  enum { NKEYS = 1 << 20, NQUERIES = 1 << 16, NWALKS = 64 };
+  u64tmap p;
+  u64ostmap m;
+  dg_timer_t timer;
+  uint64_t i, v, sum0 = 0, sum1 = 0;
+  size_t n0 = 0, n1 = 0;
+  bool ok = true;
+
+  printf("---- dg_treemap order statistics: %d keys, %zd/%zd bytes per node ----\n", NKEYS, sizeof(u64tmap_node), sizeof(u64ostmap_node));
+  u64tmap_init(&p);
+  u64ostmap_init(&m);
+  dg_timer_start(&timer);
+  for (i = 0; i < NKEYS; i++) {
+    v = i;
+    ok = ok && u64tmap_insert(&p, dg_splitmix64_(i), &v, NULL);
+  }
+  dg_timer_stop(&timer);
+  printf("  insert, plain:         %8.1f ns/key\n", timer_get_elapsed(&timer) * 1e9 / NKEYS);
+  dg_timer_start(&timer);
+  for (i = 0; i < NKEYS; i++) {
+    v = i;
+    ok = ok && u64ostmap_insert(&m, dg_splitmix64_(i), &v, NULL);
+  }
+  dg_timer_stop(&timer);
+  printf("  insert, counted:       %8.1f ns/key\n", timer_get_elapsed(&timer) * 1e9 / NKEYS);
+
+  /* k-th key by walking from the first one vs _select */
+  dg_timer_start(&timer);
+  for (i = 0; i < NWALKS; i++) {
+    size_t k = (size_t)(dg_splitmix64_(i) % NKEYS);
+    u64tmap_it it = u64tmap_iter_begin(&p);
+    while (k--)
+      it = u64tmap_iter_next(&p, it);
+    sum0 += *u64tmap_iter_key(&p, it);
+  }
+  dg_timer_stop(&timer);
+  printf("  k-th key, walk:        %8.1f us\n", timer_get_elapsed(&timer) * 1e6 / NWALKS);
+  dg_timer_start(&timer);
+  for (i = 0; i < NQUERIES; i++) {
+    u64ostmap_it it = u64ostmap_select(&m, (size_t)(dg_splitmix64_(i % NWALKS) % NKEYS));
+    if (i < NWALKS)
+      sum1 += *u64ostmap_iter_key(&m, it);
+  }
+  dg_timer_stop(&timer);
+  printf("  k-th key, _select:     %8.1f us\n", timer_get_elapsed(&timer) * 1e6 / NQUERIES);
+  ok = ok && sum0 == sum1;
+
+  /* keys in [lo, lo + span) by walking from lower_bound vs _count_range */
+  const uint64_t span = UINT64_MAX / 64;
+  dg_timer_start(&timer);
+  for (i = 0; i < NWALKS; i++) {
+    uint64_t lo = dg_splitmix64_(i + NKEYS);
+    for (u64tmap_it it = u64tmap_lower_bound(&p, lo); it && *u64tmap_iter_key(&p, it) - lo < span; it = u64tmap_iter_next(&p, it))
+      n0++;
+  }
+  dg_timer_stop(&timer);
+  printf("  range count, walk:     %8.1f us\n", timer_get_elapsed(&timer) * 1e6 / NWALKS);
+  dg_timer_start(&timer);
+  for (i = 0; i < NQUERIES; i++) {
+    uint64_t lo = dg_splitmix64_(i % NWALKS + NKEYS);
+    size_t cnt = lo > UINT64_MAX - span ? u64ostmap_size(&m) - u64ostmap_rank(&m, lo) : u64ostmap_count_range(&m, lo, lo + span);
+    if (i < NWALKS)
+      n1 += cnt;
+  }
+  dg_timer_stop(&timer);
+  printf("  range count, _rank:    %8.1f us\n", timer_get_elapsed(&timer) * 1e6 / NQUERIES);
+  ok = ok && n0 == n1;
+
+  /* counters survive erase rebalancing, _select and _rank are inverse */
+  for (i = 0; i < NKEYS && ok; i += 3)
+    ok = u64ostmap_erase(&m, dg_splitmix64_(i));
+  ok = ok && u64ostmap_check(&m, m.root) == (int)u64ostmap_size(&m);
+  for (i = 0; i < NQUERIES && ok; i++) {
+    size_t k = (size_t)(dg_splitmix64_(i) % u64ostmap_size(&m));
+    ok = u64ostmap_rank(&m, *u64ostmap_iter_key(&m, u64ostmap_select(&m, k))) == k;
+  }
+  ok = ok && u64ostmap_select(&m, u64ostmap_size(&m)) == 0;
+  if (!ok)
+    printf("tree map order statistics check failed\n");
+  u64ostmap_destroy(&m);
+  u64tmap_destroy(&p);
+  return ok;
+}
+
+/* dg_btree instantiation (u64 -> u64), same comparator as u64tmap */
+DG_BTREE_DECL(u64btree, uint64_t, uint64_t)
+DG_BTREE_IMPL(u64btree, uint64_t, uint64_t, bench_u64_cmp)
+
+/* the same steps for both ordered maps: random bulk insert, point lookups and 100-key range scans */
+#define ORDERED_BENCH_RUN(T, title, nkeys, bytes) do {\
+  T m;\
+  uint64_t v, sum = 0;\
+  size_t i, nfound = 0;\
+  T##_init(&m);\
+  dg_timer_start(&timer);\
+  for (i = 0; i < nkeys; i++) {\
+    v = i;\
+    T##_insert(&m, dg_splitmix64_(i), &v, NULL);\
+  }\
+  dg_timer_stop(&timer);\
+  printf("  %-8s insert %8.1f ns", title, timer_get_elapsed(&timer) * 1e9 / nkeys);\
+  dg_timer_start(&timer);\
+  for (i = 0; i < NLOOKUPS; i++)\
+    nfound += T##_get(&m, dg_splitmix64_((i * 7919) % nkeys), &v);\
+  dg_timer_stop(&timer);\
+  printf(", lookup %8.1f ns", timer_get_elapsed(&timer) * 1e9 / NLOOKUPS);\
+  dg_timer_start(&timer);\
+  for (i = 0; i < NSCANS; i++) {\
+    size_t k = 0;\
+    for (T##_it it = T##_lower_bound(&m, dg_splitmix64_(i)); it && k < SCAN_LEN; it = T##_iter_next(&m, it), k++)\
+      sum += *T##_iter_val(&m, it);\
+  }\
+  dg_timer_stop(&timer);\
+  printf(", scan %6.1f ns/key, %5.1f bytes/key\n", timer_get_elapsed(&timer) * 1e9 / ((double)NSCANS * SCAN_LEN), (double)(bytes) / nkeys);\
+  ok = ok && nfound == NLOOKUPS && T##_size(&m) == nkeys;\
+  scan_sum = scan_sum ? scan_sum : sum;\
+  ok = ok && sum == scan_sum;\
+  T##_destroy(&m);\
+} while (0)
+
+bool test_btree_vs_tmap()
+{
+  enum { NLOOKUPS = 1 << 20, NSCANS = 1 << 14, SCAN_LEN = 100 };
+  static const size_t sizes[] = { 1000000, 10000000, 100000000 };
+  dg_timer_t timer;
+  bool ok = true;
+
+  printf("---- dg_btree vs dg_treemap: %d-byte nodes, %d keys per leaf ----\n", DG_BTREE_NODE_BYTES, u64btree_LEAF_CAP);
+  for (size_t s = 0; s < DG_ARRSIZE(sizes) && ok; s++) {
+    size_t nkeys = sizes[s];
+    uint64_t scan_sum = 0;
+    printf(" %zd keys:\n", nkeys);
+    ORDERED_BENCH_RUN(u64tmap, "treemap", nkeys, (size_t)m.cap * sizeof(u64tmap_node));
+    ORDERED_BENCH_RUN(u64btree, "btree", nkeys, (size_t)m.leaf_cap * sizeof(u64btree_leaf) + (size_t)m.inner_cap * sizeof(u64btree_inner));
+  }
+  if (!ok)
+    printf("btree and treemap results differ\n");
+  return ok;
+}
+
+/* dg_skiplist scaling benchmark: lock-free skip list vs dg_treemap behind one dg_rwlock_t */
+DG_SKIPLIST_DECL(u64sl, uint64_t, uint64_t)
+DG_SKIPLIST_IMPL(u64sl, uint64_t, uint64_t, bench_u64_cmp)
+
+typedef struct ordered_bench_thrd_s {
+  u64sl*         psl; /* skip list, or */
+  u64tmap*       ptm; /* tree map guarded by lock */
+  dg_rwlock_t    lock;
+  atomic_size_t* pgo;
+  uint64_t       seed;
+  size_t         nkeys;
+  size_t         nops;
+  unsigned       read_pct;
+  size_t         nhits;
+} ordered_bench_thrd_t;
+
+/* reads are point lookups, writes insert or erase a random key of a 2 * nkeys universe */
+int ordered_bench_thread_proc(struct dg_thrd_data_s* ptinfo)
+{
+  ordered_bench_thrd_t* pctx = (ordered_bench_thrd_t*)ptinfo->puserdata;
+  u64sl_handle* h = pctx->psl ? u64sl_attach(pctx->psl) : NULL;
+  uint64_t rng = pctx->seed, v;
+  if (pctx->psl && !h)
+    return 1;
+  while (!dg_atomic_load(pctx->pgo));
+  for (size_t i = 0; i < pctx->nops; i++) {
+    rng = dg_splitmix64_(rng);
+    uint64_t key = dg_splitmix64_(rng % (2 * pctx->nkeys));
+    int read = (unsigned)((rng >> 32) % 100) < pctx->read_pct, ins = (rng >> 31) & 1;
+    if (h) {
+      if (read)
+        pctx->nhits += (size_t)u64sl_get(h, key, &v);
+      else if (ins)
+        u64sl_insert(h, key, &rng);
+      else
+        u64sl_erase(h, key);
+    }
+    else if (read) {
+      rwlock_rdlock(pctx->lock);
+      pctx->nhits += (size_t)u64tmap_get(pctx->ptm, key, &v);
+      rwlock_rdunlock(pctx->lock);
+    }
+    else {
+      rwlock_wrlock(pctx->lock);
+      if (ins)
+        u64tmap_insert(pctx->ptm, key, &rng, NULL);
+      else
+        u64tmap_erase(pctx->ptm, key);
+      rwlock_wrunlock(pctx->lock);
+    }
+  }
+  if (h)
+    u64sl_detach(h);
+  return 0;
+}
+
+/* one thread inserts ascending keys, the other erases each one right after it (event queue) */
+typedef struct skiplist_pc_thrd_s {
+  u64sl*         psl;
+  atomic_size_t* perased; /* keys erased so far */
+  size_t         nkeys;
+  size_t         window; /* max keys the inserter runs ahead */
+  int            erase;
+} skiplist_pc_thrd_t;
+
+int skiplist_pc_thread_proc(struct dg_thrd_data_s* ptinfo)
+{
+  skiplist_pc_thrd_t* pctx = (skiplist_pc_thrd_t*)ptinfo->puserdata;
+  u64sl_handle* h = u64sl_attach(pctx->psl);
+  if (!h)
+    return 1;
+  for (uint64_t k = 1; k <= pctx->nkeys; k++) {
+    if (pctx->erase) {
+      while (!u64sl_erase(h, k))
+        dg_delay_ms(0);
+      dg_atomic_store_release(pctx->perased, (size_t)k);
+    }
+    else {
+      while (k - dg_atomic_load_acquire(pctx->perased) > pctx->window)
+        dg_delay_ms(0);
+      u64sl_insert(h, k, &k);
+    }
+  }
+  u64sl_detach(h);
+  return 0;
+}
+
+bool test_skiplist_scaling()
+{
+  enum { NKEYS = 1 << 18, NOPS_TOTAL = 1 << 22, MAX_THREADS = 32 };
+  static const unsigned read_pcts[] = { 50, 90, 99 };
+  static const size_t thread_counts[] = { 1, 2, 4, 8, 16, 32 };
+  ordered_bench_thrd_t ctx[MAX_THREADS];
+  dg_thrd_t threads[MAX_THREADS];
+  dg_timer_t timer;
+  bool ok = true;
+
+  printf("---- dg_skiplist vs rwlock + dg_treemap throughput (Mops/s), %d keys ----\n", NKEYS);
+  for (size_t r = 0; r < DG_ARRSIZE(read_pcts) && ok; r++) {
+    for (int use_sl = 0; use_sl < 2 && ok; use_sl++) {
+      printf("  %2u%% reads, %-8s:", read_pcts[r], use_sl ? "skiplist" : "treemap");
+      for (size_t t = 0; t < DG_ARRSIZE(thread_counts) && ok; t++) {
+        size_t i, nthreads = thread_counts[t];
+        atomic_size_t go = 0;
+        u64sl sl;
+        u64tmap tm;
+        dg_rwlock_t lock = rwlock_alloc(NULL);
+        if (!lock || !u64sl_init(&sl)) {
+          printf("\ninit failed\n");
+          return false;
+        }
+        u64tmap_init(&tm);
+        u64sl_handle* h = u64sl_attach(&sl);
+        for (i = 0; i < NKEYS; i++) {
+          uint64_t key = dg_splitmix64_(i * 2);
+          if (use_sl)
+            u64sl_insert(h, key, &i);
+          else
+            u64tmap_insert(&tm, key, &i, NULL);
+        }
+        for (i = 0; i < nthreads; i++) {
+          ctx[i].psl = use_sl ? &sl : NULL;
+          ctx[i].ptm = &tm;
+          ctx[i].lock = lock;
+          ctx[i].pgo = &go;
+          ctx[i].seed = 0x9E3779B97F4A7C15ull * (i + 1);
+          ctx[i].nkeys = NKEYS;
+          ctx[i].nops = NOPS_TOTAL / nthreads;
+          ctx[i].read_pct = read_pcts[r];
+          ctx[i].nhits = 0;
+          threads[i] = thread_create(0, ordered_bench_thread_proc, &ctx[i]);
+          if (!threads[i]) {
+            printf("\nthread_create() failed\n");
+            nthreads = i;
+            ok = false;
+            break;
+          }
+        }
+        dg_timer_start(&timer);
+        dg_atomic_store(&go, 1);
+        for (i = 0; i < nthreads; i++) {
+          thread_join(threads[i]);
+          thread_close(threads[i]);
+        }
+        dg_timer_stop(&timer);
+
+        /* every handle is detached: the skip list must be sorted and match its counters */
+        if (use_sl) {
+          size_t n = 0;
+          uint64_t prev = 0;
+          u64sl_enter(h);
+          for (u64sl_it it = u64sl_iter_begin(h); it && ok; it = u64sl_iter_next(h, it), n++) {
+            ok = n == 0 || *u64sl_iter_key(it) > prev;
+            prev = *u64sl_iter_key(it);
+          }
+          u64sl_leave(h);
+          ok = ok && n == u64sl_size(&sl);
+        }
+        else {
+          ok = ok && u64tmap_check(&tm, tm.root, 0) > 0;
+        }
+        u64sl_detach(h);
+        u64sl_destroy(&sl);
+        u64tmap_destroy(&tm);
+        rwlock_free(lock);
+        printf(" %zdT=%.1f", nthreads, (double)NOPS_TOTAL / timer_get_elapsed(&timer) * 1e-6);
+      }
+      printf("\n");
+    }
+  }
+
+  /* nodes erased through one handle must be reused by the inserting one, not piled up */
+  if (ok) {
+    enum { PC_KEYS = 1 << 20, PC_WINDOW = 4096, PC_MAX_CHUNKS = 64 };
+    skiplist_pc_thrd_t pc[2];
+    atomic_size_t erased = 0;
+    size_t i, nchunks = 0;
+    u64sl sl;
+    if (!u64sl_init(&sl)) {
+      printf("init failed\n");
+      return false;
+    }
+    for (i = 0; i < 2; i++) {
+      pc[i].psl = &sl;
+      pc[i].perased = &erased;
+      pc[i].nkeys = PC_KEYS;
+      pc[i].window = PC_WINDOW;
+      pc[i].erase = i == 0;
+      threads[i] = thread_create(0, skiplist_pc_thread_proc, &pc[i]);
+      if (!threads[i]) {
+        printf("thread_create() failed\n");
+        ok = false;
+        /* the running eraser waits for every key: insert them on this thread */
+        if (i == 1) {
+          dg_thrd_data_t tdata = { 0 };
+          tdata.puserdata = &pc[i];
+          skiplist_pc_thread_proc(&tdata);
+        }
+        break;
+      }
+    }
+    for (size_t t = 0; t < i; t++) {
+      thread_join(threads[t]);
+      thread_close(threads[t]);
+    }
+    for (size_t c = sl.chunks; c; c = *(size_t*)c)
+      nchunks++;
+    ok = ok && u64sl_size(&sl) == 0 && nchunks <= PC_MAX_CHUNKS;
+    printf("  insert/erase threads: %zd node chunks after %d keys\n", nchunks, PC_KEYS);
+    u64sl_destroy(&sl);
+  }
+  if (!ok)
+    printf("skip list check failed\n");
+  return ok;
+}
+
+/* dg_darray growth policies: push loop cost and number of reallocations */
+static size_t darray_grow_4x(const dg_darray_t* pd, size_t mincap)
+{
+  return pd->capacity * 4 > mincap ? pd->capacity * 4 : mincap;
+}
+
+static bool darray_push_bench_run(const char* title, uint32_t growth, size_t reserve, size_t n)
+{
+  dg_darray_t arr = darray_init(uint64_t, 1, 1, 0);
+  dg_timer_t timer;
+  size_t nreallocs = 0, cap = 0;
+  bool ok = true;
+
+  arr.reserve = reserve;
+  if (growth == DGDARRAY_GROW_CALLBACK)
+    darray_set_growth_proc(&arr, darray_grow_4x);
+  else
+    darray_set_growth(&arr, growth);
+  dg_timer_start(&timer);
+  for (uint64_t i = 0; i < n && ok; i++) {
+    ok = darray_push_back(&arr, &i);
+    if (arr.capacity != cap) {
+      cap = arr.capacity;
+      nreallocs++;
+    }
+  }
+  dg_timer_stop(&timer);
+  for (size_t i = 0; i < n && ok; i += 4099)
+    ok = darray_get(&arr, i, uint64_t) == i;
+  printf("  %-18s %9zd pushes: %7.2f ns/push, %8zd reallocs, capacity %zd\n",
+    title, n, timer_get_elapsed(&timer) * 1e9 / (double)n, nreallocs, arr.capacity);
+  darray_free(&arr);
+  return ok;
+}
+
+bool test_darray_growth()
+{
+  enum { NPUSH = 10000000, NPUSH_CHUNK = 200000 };
+  dg_darray_t arr = darray_init(uint64_t, 1, 1, 0);
+  bool ok = true;
+
+  printf("---- dg_darray push_back growth policies ----\n");
+  ok = ok && darray_push_bench_run("2x", DGDARRAY_GROW_2X, 1, NPUSH);
+  ok = ok && darray_push_bench_run("1.5x", DGDARRAY_GROW_1_5X, 1, NPUSH);
+  ok = ok && darray_push_bench_run("callback 4x", DGDARRAY_GROW_CALLBACK, 1, NPUSH);
+  ok = ok && darray_push_bench_run("chunk 4096", DGDARRAY_GROW_CHUNK, 4096, NPUSH);
+  ok = ok && darray_push_bench_run("chunk 1 (old)", DGDARRAY_GROW_CHUNK, 1, NPUSH_CHUNK);
+
+  /* reserve_exact leaves no slack, shrink_to_fit trims growth slack */
+  uint64_t i;
+  ok = ok && darray_reserve_exact(&arr, 1000) == DGERR_SUCCESS && arr.capacity == 1000;
+  for (i = 0; i < 1000 && ok; i++)
+    ok = darray_push_back(&arr, &i);
+  ok = ok && arr.capacity == 1000 && darray_push_back(&arr, &i) && arr.capacity == 2000;
+  ok = ok && darray_shrink_to_fit(&arr) == DGERR_SUCCESS && arr.capacity == 1001 && darray_get(&arr, 1000, uint64_t) == 1000;
+  darray_free(&arr);
+  if (!ok)
+    printf("darray growth check failed\n");
+  return ok;
+}
+
+/* DG_VEC vs dg_darray_t: push, sequential sum, random access */
+DG_VEC_DECL(u64vec, uint64_t)
+DG_VEC_IMPL(u64vec, uint64_t)
+
+bool test_vec_vs_darray()
+{
+  enum { N = 10000000, NRAND = 10000000 };
+  dg_darray_t arr = darray_init(uint64_t, 1, 1, 0);
+  dg_timer_t timer;
+  uint64_t i, rng, sum_a = 0, sum_v = 0;
+  double t_push[2], t_iter[2], t_rand[2];
+  u64vec v;
+  bool ok = u64vec_init(&v, 0) != 0;
+
+  dg_timer_start(&timer);
+  for (i = 0; i < N && ok; i++)
+    ok = darray_push_back(&arr, &i);
+  dg_timer_stop(&timer);
+  t_push[0] = timer_get_elapsed(&timer);
+  dg_timer_start(&timer);
+  for (i = 0; i < N && ok; i++)
+    ok = u64vec_push(&v, i);
+  dg_timer_stop(&timer);
+  t_push[1] = timer_get_elapsed(&timer);
+
+  dg_timer_start(&timer);
+  for (size_t j = 0; j < darray_get_size(&arr); j++)
+    sum_a += darray_get(&arr, j, uint64_t);
+  dg_timer_stop(&timer);
+  t_iter[0] = timer_get_elapsed(&timer);
+  dg_timer_start(&timer);
+  const uint64_t* pv = u64vec_data(&v);
+  for (size_t j = 0; j < u64vec_size(&v); j++)
+    sum_v += pv[j];
+  dg_timer_stop(&timer);
+  t_iter[1] = timer_get_elapsed(&timer);
+  ok = ok && sum_a == sum_v && sum_v == (uint64_t)N * (N - 1) / 2;
+
+  sum_a = sum_v = 0;
+  rng = 1;
+  dg_timer_start(&timer);
+  for (i = 0; i < NRAND; i++) {
+    rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+    sum_a += darray_get(&arr, (rng >> 33) % N, uint64_t);
+  }
+  dg_timer_stop(&timer);
+  t_rand[0] = timer_get_elapsed(&timer);
+  rng = 1;
+  dg_timer_start(&timer);
+  for (i = 0; i < NRAND; i++) {
+    rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+    sum_v += *u64vec_at(&v, (rng >> 33) % N);
+  }
+  dg_timer_stop(&timer);
+  t_rand[1] = timer_get_elapsed(&timer);
+  ok = ok && sum_a == sum_v;
+
+  printf("---- DG_VEC vs dg_darray_t, %d uint64_t (ns/element) ----\n", N);
+  printf("  %-10s push %6.2f  iterate %6.2f  random %6.2f\n", "darray",
+    t_push[0] * 1e9 / N, t_iter[0] * 1e9 / N, t_rand[0] * 1e9 / NRAND);
+  printf("  %-10s push %6.2f  iterate %6.2f  random %6.2f\n", "DG_VEC",
+    t_push[1] * 1e9 / N, t_iter[1] * 1e9 / N, t_rand[1] * 1e9 / NRAND);
+  darray_free(&arr);
+
+  /* range ops, including a source inside the vector itself */
+  u64vec_clear(&v);
+  for (i = 0; i < 8 && ok; i++)
+    ok = u64vec_push(&v, i);
+  ok = ok && u64vec_insert_range(&v, 2, u64vec_data(&v) + 5, 3); /* 0 1 5 6 7 2 3 4 5 6 7 */
+  ok = ok && u64vec_insert_range(&v, 4, u64vec_data(&v) + 3, 2); /* 0 1 5 6 6 7 7 2 3 4 5 6 7 */
+  static const uint64_t expect[] = { 0, 1, 5, 6, 6, 7, 7, 2, 3, 4, 5, 6, 7 };
+  ok = ok && u64vec_size(&v) == DG_ARRSIZE(expect) && !memcmp(u64vec_data(&v), expect, sizeof(expect));
+  u64vec_erase_range(&v, 2, 7);
+  for (i = 0; i < 8 && ok; i++)
+    ok = *u64vec_at(&v, i) == i;
+  ok = ok && u64vec_size(&v) == 8 && u64vec_insert_range(&v, 8, NULL, 2) && *u64vec_at(&v, 9) == 0;
+  ok = ok && u64vec_shrink_to_fit(&v) && u64vec_capacity(&v) == 10;
+  u64vec_destroy(&v);
+  if (!ok)
+    printf("DG_VEC check failed\n");
+  return ok;
+}
+
+/* dg_darray range edits: erase_range/insert_range/remove_if vs per-element calls */
+static bool darray_pred_odd(const void* pelem, void* puserdata)
+{
+  (*(size_t*)puserdata)++;
+  return (*(const uint64_t*)pelem & 1) != 0;
+}
+
+static bool darray_check_seq(const dg_darray_t* pd, const uint64_t* pexpect, size_t n)
+{
+  return pd->size == n && !memcmp(pd->pdata, pexpect, n * sizeof(uint64_t));
+}
+
+bool test_darray_ranges()
+{
+  enum { N = 1000000, K = 1000 };
+  dg_darray_t arr = darray_init(uint64_t, 1, 1, 0);
+  dg_timer_t timer;
+  size_t ncalls = 0;
+  uint64_t i;
+  double t_one, t_range;
+  bool ok = true;
+
+  /* single element removes */
+  for (i = 0; i < 8 && ok; i++)
+    ok = darray_push_back(&arr, &i);
+  darray_remove_from(&arr, 2);
+  static const uint64_t exp_rm[] = { 0, 1, 3, 4, 5, 6, 7 };
+  ok = ok && darray_check_seq(&arr, exp_rm, DG_ARRSIZE(exp_rm));
+  darray_remove_from_fast(&arr, 1);
+  static const uint64_t exp_rmf[] = { 0, 7, 3, 4, 5, 6 };
+  ok = ok && darray_check_seq(&arr, exp_rmf, DG_ARRSIZE(exp_rmf));
+
+  /* range insert, also from inside the array */
+  darray_clear(&arr);
+  for (i = 0; i < 8 && ok; i++)
+    ok = darray_push_back(&arr, &i);
+  static const uint64_t ins[] = { 100, 101 };
+  ok = ok && darray_insert_range(&arr, 0, ins, 2) == DGERR_SUCCESS;          /* 100 101 0..7 */
+  ok = ok && darray_insert_range(&arr, 10, ins, 2) == DGERR_SUCCESS;         /* 100 101 0..7 100 101 */
+  ok = ok && darray_insert_range(&arr, 3, arr.pdata + 7 * 8, 3) == DGERR_SUCCESS; /* source after at */
+  ok = ok && darray_insert_range(&arr, 2, arr.pdata + 1 * 8, 2) == DGERR_SUCCESS; /* source straddles at */
+  static const uint64_t exp_ins[] = { 100, 101, 101, 0, 0, 5, 6, 7, 1, 2, 3, 4, 5, 6, 7, 100, 101 };
+  ok = ok && darray_check_seq(&arr, exp_ins, DG_ARRSIZE(exp_ins));
+
+  /* range erase and stable remove_if */
+  darray_erase_range(&arr, 0, 5);
+  darray_erase_range(&arr, 10, 2);
+  darray_erase_range(&arr, 3, 0);
+  static const uint64_t exp_er[] = { 5, 6, 7, 1, 2, 3, 4, 5, 6, 7 };
+  ok = ok && darray_check_seq(&arr, exp_er, DG_ARRSIZE(exp_er));
+  ok = ok && darray_remove_if(&arr, darray_pred_odd, &ncalls) == 6 && ncalls == DG_ARRSIZE(exp_er);
+  static const uint64_t exp_rif[] = { 6, 2, 4, 6 };
+  ok = ok && darray_check_seq(&arr, exp_rif, DG_ARRSIZE(exp_rif));
+
+  /* K elements out of the middle of N: K remove_from calls vs one erase_range */
+  darray_clear(&arr);
+  for (i = 0; i < N && ok; i++)
+    ok = darray_push_back(&arr, &i);
+  dg_timer_start(&timer);
+  for (i = 0; i < K; i++)
+    darray_remove_from(&arr, N / 4);
+  dg_timer_stop(&timer);
+  t_one = timer_get_elapsed(&timer);
+  ok = ok && arr.size == N - K && darray_get(&arr, N / 4, uint64_t) == N / 4 + K;
+  ok = ok && darray_insert_range(&arr, N / 4, NULL, K) == DGERR_SUCCESS;
+  dg_timer_start(&timer);
+  darray_erase_range(&arr, N / 4, K);
+  dg_timer_stop(&timer);
+  t_range = timer_get_elapsed(&timer);
+  ok = ok && arr.size == N - K && darray_get(&arr, N / 4, uint64_t) == N / 4 + K;
+  ncalls = 0;
+  dg_timer_start(&timer);
+  ok = ok && darray_remove_if(&arr, darray_pred_odd, &ncalls) == (N - K) / 2;
+  dg_timer_stop(&timer);
+  ok = ok && darray_get(&arr, arr.size - 1, uint64_t) == N - 2;
+  printf("---- dg_darray erase %d of %d elements ----\n", K, N);
+  printf("  remove_from x%d: %8.3f ms\n  erase_range:     %8.3f ms\n  remove_if (odd): %8.3f ms\n",
+    K, t_one * 1e3, t_range * 1e3, timer_get_elapsed(&timer) * 1e3);
+  darray_free(&arr);
+  if (!ok)
+    printf("darray range check failed\n");
+  return ok;
+}
+
+/* dg_segarray: stable addresses, chunk-wise iteration, push cost vs dg_darray_t */
+bool test_segarray()
+{
+  enum { N = 10000000, NCHUNK = 4096 };
+  dg_segarray_t sa;
+  dg_darray_t arr = darray_init(uint64_t, 1, 1, 0);
+  dg_timer_t timer;
+  uint64_t i, sum = 0, *pfirst, *pmid = NULL;
+  double t_sa, t_da, t_iter;
+  bool ok = segarray_init(&sa, sizeof(uint64_t), NCHUNK - 1) == DGERR_SUCCESS;
+
+  ok = ok && segarray_get_chunk_elems(&sa) == NCHUNK;
+  pfirst = ok ? (uint64_t*)segarray_add_back(&sa) : NULL;
+  ok = ok && pfirst;
+  if (ok)
+    *pfirst = 0;
+  dg_timer_start(&timer);
+  for (i = 1; i < N && ok; i++) {
+    ok = segarray_push_back(&sa, &i);
+    if (i == N / 2)
+      pmid = segarray_getptr(&sa, i, uint64_t);
+  }
+  dg_timer_stop(&timer);
+  t_sa = timer_get_elapsed(&timer);
+  dg_timer_start(&timer);
+  for (i = 0; i < N && ok; i++)
+    ok = darray_push_back(&arr, &i);
+  dg_timer_stop(&timer);
+  t_da = timer_get_elapsed(&timer);
+  darray_free(&arr);
+
+  /* addresses handed out before growth still point at the same elements */
+  ok = ok && pfirst == segarray_getptr(&sa, 0, uint64_t) && *pfirst == 0;
+  ok = ok && pmid == segarray_getptr(&sa, N / 2, uint64_t) && *pmid == N / 2;
+  ok = ok && segarray_get_size(&sa) == N && segarray_get(&sa, N - 1, uint64_t) == N - 1;
+
+  dg_timer_start(&timer);
+  for (size_t c = 0; c < segarray_get_chunk_count(&sa); c++) {
+    size_t n;
+    const uint64_t* p = (const uint64_t*)segarray_get_chunk(&sa, c, &n);
+    for (size_t j = 0; j < n; j++)
+      sum += p[j];
+  }
+  dg_timer_stop(&timer);
+  t_iter = timer_get_elapsed(&timer);
+  ok = ok && sum == (uint64_t)N * (N - 1) / 2;
+
+  /* bulk append across chunk boundaries, pop, shrink */
+  static uint64_t buf[3 * NCHUNK];
+  for (i = 0; i < DG_ARRSIZE(buf); i++)
+    buf[i] = N + i;
+  ok = ok && segarray_append(&sa, buf, DG_ARRSIZE(buf)) == DGERR_SUCCESS;
+  for (i = 0; i < DG_ARRSIZE(buf) && ok; i += 997)
+    ok = segarray_get(&sa, N + i, uint64_t) == N + i;
+  ok = ok && segarray_pop_back(&i, &sa) && i == N + DG_ARRSIZE(buf) - 1;
+  segarray_clear(&sa);
+  ok = ok && segarray_push_back(&sa, &i) && segarray_getptr(&sa, 0, uint64_t) == pfirst;
+  segarray_shrink_to_fit(&sa);
+  ok = ok && segarray_get_capacity(&sa) == NCHUNK && *pfirst == i;
+
+  printf("---- dg_segarray %d uint64_t, %d per chunk ----\n", N, NCHUNK);
+  printf("  push: segarray %6.2f ns, darray %6.2f ns; chunk-wise sum %6.2f ns/element\n",
+    t_sa * 1e9 / N, t_da * 1e9 / N, t_iter * 1e9 / N);
+  segarray_free(&sa);
+  if (!ok)
+    printf("segarray check failed\n");
+  return ok;
+}
+
+/* DG_SOA vs array of structs in dg_darray_t: sweeps over one or two fields */
+typedef struct soa_bench_entity_s {
+  float    px, py, pz;
+  float    vx, vy, vz;
+  float    mass;
+  uint32_t flags;
+  uint64_t id;
+  float    color[4];
+  uint8_t  pad[8];
+} soa_bench_entity_t;
+
+#define SOA_BENCH_FIELDS (float, px), (float, py), (float, pz), (float, vx), (float, vy), (float, vz), \
+  (float, mass), (uint32_t, flags), (uint64_t, id)
+DG_SOA_DECL(soa_ents, SOA_BENCH_FIELDS)
+DG_SOA_IMPL(soa_ents, SOA_BENCH_FIELDS)
+
+bool test_soa_sweep()
+{
+  enum { N = 1 << 22, NREP = 10 };
+  const float dt = 1.0f / 64.0f;
+  dg_darray_t aos = darray_init(soa_bench_entity_t, 1, 1, 0);
+  soa_ents soa;
+  dg_timer_t timer;
+  double t_aos[2], t_soa[2];
+  double mass_aos = 0, mass_soa = 0;
+  bool ok = soa_ents_init(&soa, 0) != 0;
+
+  for (uint32_t i = 0; i < N && ok; i++) {
+    soa_bench_entity_t e = { 0 };
+    e.px = (float)i; e.vx = 1.0f; e.mass = (float)(i & 7); e.id = i;
+    soa_ents_row r = { .px = e.px, .vx = e.vx, .mass = e.mass, .id = e.id };
+    ok = darray_push_back(&aos, &e) && soa_ents_push(&soa, &r);
+  }
+  ok = ok && ((uintptr_t)soa.px % DG_SOA_ALIGN) == 0 && ((uintptr_t)soa.id % DG_SOA_ALIGN) == 0;
+
+  /* integrate x: two fields read, one written */
+  soa_bench_entity_t* pe = darray_get_data_ptr_as(&aos, soa_bench_entity_t);
+  dg_timer_start(&timer);
+  for (int rep = 0; rep < NREP; rep++)
+    for (size_t i = 0; i < N; i++)
+      pe[i].px += pe[i].vx * dt;
+  dg_timer_stop(&timer);
+  t_aos[0] = timer_get_elapsed(&timer);
+  float* px = soa.px;
+  const float* vx = soa.vx;
+  dg_timer_start(&timer);
+  for (int rep = 0; rep < NREP; rep++)
+    for (size_t i = 0; i < N; i++)
+      px[i] += vx[i] * dt;
+  dg_timer_stop(&timer);
+  t_soa[0] = timer_get_elapsed(&timer);
+
+  /* reduce one field */
+  dg_timer_start(&timer);
+  for (int rep = 0; rep < NREP; rep++) {
+    float sum = 0;
+    for (size_t i = 0; i < N; i++)
+      sum += pe[i].mass;
+    mass_aos += sum;
+  }
+  dg_timer_stop(&timer);
+  t_aos[1] = timer_get_elapsed(&timer);
+  const float* mass = soa.mass;
+  dg_timer_start(&timer);
+  for (int rep = 0; rep < NREP; rep++) {
+    float sum = 0;
+    for (size_t i = 0; i < N; i++)
+      sum += mass[i];
+    mass_soa += sum;
+  }
+  dg_timer_stop(&timer);
+  t_soa[1] = timer_get_elapsed(&timer);
+
+  printf("---- DG_SOA vs AoS dg_darray_t, %d entities (%zd-byte struct), ns/entity ----\n",
+    N, sizeof(soa_bench_entity_t));
+  printf("  integrate px: AoS %6.3f  SoA %6.3f\n", t_aos[0] * 1e9 / ((double)N * NREP), t_soa[0] * 1e9 / ((double)N * NREP));
+  printf("  sum mass:     AoS %6.3f  SoA %6.3f\n", t_aos[1] * 1e9 / ((double)N * NREP), t_soa[1] * 1e9 / ((double)N * NREP));
+  for (size_t i = 0; i < N && ok; i += 4093)
+    ok = pe[i].px == soa.px[i];
+  ok = ok && mass_aos == mass_soa;
+
+  /* row access and erase by swap */
+  soa_ents_row r;
+  soa_ents_get(&soa, N - 1, &r);
+  soa_ents_erase_swap(&soa, 5);
+  ok = ok && soa_ents_size(&soa) == N - 1 && soa.id[5] == N - 1 && soa.px[5] == r.px;
+  soa_ents_swap(&soa, 0, 5);
+  ok = ok && soa.id[0] == N - 1 && soa.id[5] == 0;
+  r.id = 77;
+  soa_ents_set(&soa, 1, &r);
+  ok = ok && soa.id[1] == 77 && soa.mass[1] == r.mass;
+  ok = ok && soa_ents_reserve(&soa, 3 * N) && soa.id[1] == 77 && soa.id[N - 2] == N - 2;
+  soa_ents_destroy(&soa);
+  darray_free(&aos);
+  if (!ok)
+    printf("DG_SOA check failed\n");
+  return ok;
+}
+
+/* dg_darray3d row-major vs 8x8x8 bricks: 7-point stencil sweep and random 3x3x3 neighborhoods */
+static void darray3d_bench_fill(dg_darray3d_t* pd)
+{
+  for (size_t i = 0; i < pd->dim0; i++)
+    for (size_t j = 0; j < pd->dim1; j++)
+      for (size_t k = 0; k < pd->dim2; k++)
+        darray3d_get(pd, i, j, k, float) = (float)((i * 7 + j * 3 + k) & 255);
+}
+
+/* dst = mean of the 6 face neighbors of src on interior points, brick at a time */
+static void darray3d_bench_stencil_bricks(const dg_darray3d_t* psrc, dg_darray3d_t* pdst)
+{
+  dg_darray3d_brick_t bs, bd;
+  bool more = darray3d_brick_first(psrc, &bs) && darray3d_brick_first(pdst, &bd);
+  for (; more; more = darray3d_brick_next(psrc, &bs) && darray3d_brick_next(pdst, &bd)) {
+    for (size_t a = 0; a < bs.n0; a++) {
+      size_t i = bs.i0 + a;
+      if (i == 0 || i + 1 == psrc->dim0)
+        continue;
+      for (size_t b = 0; b < bs.n1; b++) {
+        size_t j = bs.j0 + b;
+        if (j == 0 || j + 1 == psrc->dim1)
+          continue;
+        for (size_t c = 0; c < bs.n2; c++) {
+          size_t k = bs.k0 + c;
+          if (k == 0 || k + 1 == psrc->dim2)
+            continue;
+          const float* p = &darray3d_brick_get(&bs, a, b, c, float);
+          float s0 = a > 0 ? p[-(ptrdiff_t)bs.stride0] : darray3d_get(psrc, i - 1, j, k, float);
+          float s1 = a + 1 < bs.n0 ? p[bs.stride0] : darray3d_get(psrc, i + 1, j, k, float);
+          float s2 = b > 0 ? p[-(ptrdiff_t)bs.stride1] : darray3d_get(psrc, i, j - 1, k, float);
+          float s3 = b + 1 < bs.n1 ? p[bs.stride1] : darray3d_get(psrc, i, j + 1, k, float);
+          float s4 = c > 0 ? p[-1] : darray3d_get(psrc, i, j, k - 1, float);
+          float s5 = c + 1 < bs.n2 ? p[1] : darray3d_get(psrc, i, j, k + 1, float);
+          darray3d_brick_get(&bd, a, b, c, float) = (s0 + s1 + s2 + s3 + s4 + s5) * (1.0f / 6.0f);
+        }
+      }
+    }
+  }
+}
+
+static double darray3d_bench_checksum(const dg_darray3d_t* pd)
+{
+  double sum = 0;
+  for (size_t i = 1; i + 1 < pd->dim0; i++)
+    for (size_t j = 1; j + 1 < pd->dim1; j++)
+      for (size_t k = 1; k + 1 < pd->dim2; k++)
+        sum += darray3d_get(pd, i, j, k, float) * (double)((i ^ j ^ k) & 15);
+  return sum;
+}
+
+static double darray3d_bench_neighborhoods(const dg_darray3d_t* pd, size_t nqueries)
+{
+  uint64_t rng = 1;
+  double sum = 0;
+  for (size_t q = 0; q < nqueries; q++) {
+    rng = dg_splitmix64_(rng);
+    size_t i = 1 + (size_t)(rng % (pd->dim0 - 2));
+    size_t j = 1 + (size_t)((rng >> 20) % (pd->dim1 - 2));
+    size_t k = 1 + (size_t)((rng >> 40) % (pd->dim2 - 2));
+    float s = 0;
+    for (size_t a = i - 1; a <= i + 1; a++)
+      for (size_t b = j - 1; b <= j + 1; b++)
+        for (size_t c = k - 1; c <= k + 1; c++)
+          s += darray3d_get(pd, a, b, c, float);
+    sum += s;
+  }
+  return sum;
+}
+
+bool test_darray3d_tiled()
+{
+  enum { DIM = 512, NQUERIES = 2000000 };
+  dg_timer_t timer;
+  double t_loops = 0, t_bricks[2], t_nbh[2], csum[3], nsum[2];
+  bool ok = true;
+
+  /* layouts agree on odd sizes, bricks cover every element once */
+  {
+    dg_darray3d_t a = darray3d_init(13, 21, 10, uint32_t);
+    dg_darray3d_t b = darray3d_init_tiled(13, 21, 10, uint32_t, 2);
+    dg_darray2d_t c = darray2d_init_tiled(13, 21, uint32_t, 3);
+    dg_darray3d_brick_t br;
+    dg_darray2d_tile_t tl;
+    size_t n = 0;
+    ok = darray3d_alloc(&a, true) && darray3d_alloc(&b, true) && darray2d_alloc(&c, true);
+    ok = ok && darray3d_get_alloc_count(&b) == 16 * 24 * 12 && darray2d_get_alloc_count(&c) == 16 * 24;
+    for (bool more = ok && darray3d_brick_first(&b, &br); more; more = darray3d_brick_next(&b, &br))
+      for (size_t i = 0; i < br.n0; i++)
+        for (size_t j = 0; j < br.n1; j++)
+          for (size_t k = 0; k < br.n2; k++, n++)
+            darray3d_brick_get(&br, i, j, k, uint32_t) += (uint32_t)(((br.i0 + i) * 21 + br.j0 + j) * 10 + br.k0 + k + 1);
+    for (bool more = ok && darray3d_brick_first(&a, &br); more; more = darray3d_brick_next(&a, &br))
+      for (size_t i = 0; i < br.n0; i++)
+        for (size_t j = 0; j < br.n1; j++)
+          for (size_t k = 0; k < br.n2; k++)
+            darray3d_brick_get(&br, i, j, k, uint32_t) = darray3d_get(&b, br.i0 + i, br.j0 + j, br.k0 + k, uint32_t);
+    ok = ok && n == 13 * 21 * 10;
+    for (size_t i = 0; i < 13 * 21 * 10 && ok; i++)
+      ok = ((uint32_t*)a.pdata)[i] == i + 1;
+    n = 0;
+    for (bool more = ok && darray2d_tile_first(&c, &tl); more; more = darray2d_tile_next(&c, &tl))
+      for (size_t i = 0; i < tl.n0; i++)
+        for (size_t j = 0; j < tl.n1; j++, n++)
+          darray2d_tile_get(&tl, i, j, uint32_t) = (uint32_t)((tl.i0 + i) * 21 + tl.j0 + j);
+    for (size_t i = 0; i < 13 && ok; i++)
+      for (size_t j = 0; j < 21 && ok; j++)
+        ok = darray2d_get(&c, i, j, uint32_t) == i * 21 + j;
+    ok = ok && n == 13 * 21;
+    darray3d_free(&a);
+    darray3d_free(&b);
+    darray2d_free(&c);
+  }
+
+  for (int tiled = 0; tiled < 2 && ok; tiled++) {
+    dg_darray3d_t src = darray3d_init(DIM, DIM, DIM, float);
+    dg_darray3d_t dst = darray3d_init(DIM, DIM, DIM, float);
+    if (tiled) {
+      src.layout = dst.layout = DGDARRAY_LAYOUT_TILED;
+      src.tileshift = dst.tileshift = DGDARRAY_TILE_SHIFT;
+    }
+    if (!darray3d_alloc(&src, false) || !darray3d_alloc(&dst, true)) {
+      printf("darray3d_alloc() failed\n");
+      darray3d_free(&src);
+      return false;
+    }
+    darray3d_bench_fill(&src);
+    if (!tiled) {
+      /* row-major reference: plain index arithmetic */
+      const float* s = (const float*)src.pdata;
+      float* d = (float*)dst.pdata;
+      const size_t sj = DIM, si = (size_t)DIM * DIM;
+      dg_timer_start(&timer);
+      for (size_t i = 1; i + 1 < DIM; i++)
+        for (size_t j = 1; j + 1 < DIM; j++)
+          for (size_t k = 1; k + 1 < DIM; k++) {
+            size_t x = i * si + j * sj + k;
+            d[x] = (s[x - si] + s[x + si] + s[x - sj] + s[x + sj] + s[x - 1] + s[x + 1]) * (1.0f / 6.0f);
+          }
+      dg_timer_stop(&timer);
+      t_loops = timer_get_elapsed(&timer);
+      csum[2] = darray3d_bench_checksum(&dst);
+    }
+    dg_timer_start(&timer);
+    darray3d_bench_stencil_bricks(&src, &dst);
+    dg_timer_stop(&timer);
+    t_bricks[tiled] = timer_get_elapsed(&timer);
+    csum[tiled] = darray3d_bench_checksum(&dst);
+    dg_timer_start(&timer);
+    nsum[tiled] = darray3d_bench_neighborhoods(&src, NQUERIES);
+    dg_timer_stop(&timer);
+    t_nbh[tiled] = timer_get_elapsed(&timer);
+    darray3d_free(&src);
+    darray3d_free(&dst);
+  }
+  ok = ok && csum[0] == csum[2] && csum[1] == csum[2] && nsum[0] == nsum[1];
+
+  const double npts = (double)(DIM - 2) * (DIM - 2) * (DIM - 2);
+  printf("---- dg_darray3d %d^3 float, row-major vs %dx%dx%d bricks ----\n", DIM,
+    1 << DGDARRAY_TILE_SHIFT, 1 << DGDARRAY_TILE_SHIFT, 1 << DGDARRAY_TILE_SHIFT);
+  printf("  stencil, row-major loops:    %6.2f ns/point\n", t_loops * 1e9 / npts);
+  printf("  stencil, row-major bricks:   %6.2f ns/point\n", t_bricks[0] * 1e9 / npts);
+  printf("  stencil, tiled bricks:       %6.2f ns/point\n", t_bricks[1] * 1e9 / npts);
+  printf("  3x3x3 random, row-major:     %6.2f ns/query\n", t_nbh[0] * 1e9 / NQUERIES);
+  printf("  3x3x3 random, tiled:         %6.2f ns/query\n", t_nbh[1] * 1e9 / NQUERIES);
+  if (!ok)
+    printf("darray3d tiled check failed\n");
+  return ok;
+}
+
+/* dg_darray sorting: qsort-based, typed introsort, parallel merge sort, radix sort */
+#define U64_LESS(a, b) ((a) < (b))
+DG_DARRAY_SORT_IMPL(u64arr, uint64_t, U64_LESS)
+
+typedef struct sort_bench_rec_s {
+  double   ts;
+  uint32_t src;
+  uint32_t kind;
+} sort_bench_rec_t;
+
+static int sort_bench_cmp_u64(const void* pa, const void* pb)
+{
+  uint64_t a = *(const uint64_t*)pa, b = *(const uint64_t*)pb;
+  return (a > b) - (a < b);
+}
+
+static int sort_bench_cmp_rec(const void* pa, const void* pb)
+{
+  const sort_bench_rec_t* a = (const sort_bench_rec_t*)pa;
+  const sort_bench_rec_t* b = (const sort_bench_rec_t*)pb;
+  return (a->ts > b->ts) - (a->ts < b->ts);
+}
+
+static bool sort_bench_fill(dg_darray_t* pd, size_t n, uint64_t mod)
+{
+  darray_clear(pd);
+  for (uint64_t i = 0; i < n; i++) {
+    uint64_t v = dg_splitmix64_(i) % mod;
+    if (!darray_push_back(pd, &v))
+      return false;
+  }
+  return true;
+}
+
+static bool sort_bench_is_sorted(const dg_darray_t* pd)
+{
+  const uint64_t* p = darray_get_data_ptr_as(pd, uint64_t);
+  for (size_t i = 1; i < pd->size; i++)
+    if (p[i - 1] > p[i])
+      return false;
+  return true;
+}
+
+bool test_darray_sort()
+{
+  enum { N = 10000000, NTHREADS = 8 };
+  dg_darray_t arr = darray_init(uint64_t, 1, 1, 0);
+  dg_darray_t ref = darray_init(uint64_t, 1, 1, 0);
+  dg_darray_t a = darray_init(uint64_t, 1, 1, 0), b = darray_init(uint64_t, 1, 1, 0);
+  dg_darray_t merged = darray_init(uint64_t, 1, 1, 0);
+  dg_threadpool_t pool;
+  dg_timer_t timer;
+  double t[6];
+  size_t i;
+  bool ok;
+
+  if (tp_init(&pool, NTHREADS - 1) != DGERR_SUCCESS) {
+    printf("tp_init() failed\n");
+    return false;
+  }
+  ok = sort_bench_fill(&ref, N, UINT64_MAX) && darray_copy(&arr, &ref) == DGERR_SUCCESS;
+
+  /* every variant sorts the same input to the same result */
+#define SORT_BENCH_RUN(slot, expr) do { \
+    ok = ok && darray_copy(&arr, &ref) == DGERR_SUCCESS; \
+    dg_timer_start(&timer); \
+    ok = ok && (expr); \
+    dg_timer_stop(&timer); \
+    t[slot] = timer_get_elapsed(&timer); \
+    ok = ok && sort_bench_is_sorted(&arr); \
+    darray_free(&arr); \
+  } while (0)
+
+  darray_free(&arr);
+  SORT_BENCH_RUN(0, (darray_sort(&arr, sort_bench_cmp_u64), true));
+  SORT_BENCH_RUN(1, darray_sort_par(&arr, sort_bench_cmp_u64, &pool) == DGERR_SUCCESS);
+  SORT_BENCH_RUN(2, (u64arr_sort(&arr), true));
+  SORT_BENCH_RUN(3, u64arr_sort_par(&arr, &pool) == DGERR_SUCCESS);
+  SORT_BENCH_RUN(4, darray_radix_sort(&arr, 0, DGDARRAY_KEY_U64) == DGERR_SUCCESS);
+#undef SORT_BENCH_RUN
+  printf("---- dg_darray sort, %d random uint64_t, %d threads (ns/element) ----\n", N, NTHREADS);
+  printf("  darray_sort (qsort):  %6.2f\n  darray_sort_par:      %6.2f\n", t[0] * 1e9 / N, t[1] * 1e9 / N);
+  printf("  typed sort:           %6.2f\n  typed sort_par:       %6.2f\n", t[2] * 1e9 / N, t[3] * 1e9 / N);
+  printf("  radix sort:           %6.2f\n", t[4] * 1e9 / N);
+
+  /* unique, lower_bound, merge against the generic versions */
+  ok = ok && sort_bench_fill(&arr, 100000, 5000) && darray_copy(&a, &arr) == DGERR_SUCCESS;
+  u64arr_sort(&arr);
+  darray_sort(&a, sort_bench_cmp_u64);
+  ok = ok && !memcmp(arr.pdata, a.pdata, arr.size * sizeof(uint64_t));
+  for (i = 0; i < 6000 && ok; i += 7) {
+    uint64_t key = i;
+    size_t lb = u64arr_lower_bound(&arr, key);
+    ok = lb == darray_lower_bound(&arr, &key, sort_bench_cmp_u64);
+    ok = ok && (lb == arr.size || darray_get(&arr, lb, uint64_t) >= key) && (lb == 0 || darray_get(&arr, lb - 1, uint64_t) < key);
+  }
+  ok = ok && u64arr_unique(&arr) == darray_unique(&a, sort_bench_cmp_u64) && arr.size <= 5000;
+  ok = ok && !memcmp(arr.pdata, a.pdata, arr.size * sizeof(uint64_t));
+  ok = ok && sort_bench_fill(&b, 70000, 1000000) && (u64arr_sort(&b), true);
+  ok = ok && u64arr_merge(&merged, &a, &b) == DGERR_SUCCESS && merged.size == a.size + b.size && sort_bench_is_sorted(&merged);
+  darray_clear(&arr);
+  ok = ok && darray_merge(&arr, &a, &b, sort_bench_cmp_u64) == DGERR_SUCCESS;
+  ok = ok && !memcmp(arr.pdata, merged.pdata, arr.size * sizeof(uint64_t));
+
+  /* destinations without storage yet: the merged size fits the initializer capacity */
+  {
+    dg_darray_t one = darray_init_default(uint64_t), none = darray_init_default(uint64_t);
+    dg_darray_t d1 = darray_init_default(uint64_t), d2 = darray_init_default(uint64_t);
+    uint64_t v = 42;
+    ok = ok && darray_push_back(&one, &v);
+    ok = ok && darray_merge(&d1, &one, &none, sort_bench_cmp_u64) == DGERR_SUCCESS && d1.size == 1 && darray_get(&d1, 0, uint64_t) == 42;
+    ok = ok && u64arr_merge(&d2, &none, &one) == DGERR_SUCCESS && d2.size == 1 && darray_get(&d2, 0, uint64_t) == 42;
+    darray_free(&d1);
+    ok = ok && darray_merge(&d1, &one, &none, sort_bench_cmp_u64) == DGERR_SUCCESS && darray_get(&d1, 0, uint64_t) == 42;
+    darray_free(&one);
+    darray_free(&d1);
+    darray_free(&d2);
+  }
+
+  /* radix sort is stable and orders signed/float keys numerically */
+  dg_darray_t recs = darray_init(sort_bench_rec_t, 1, 1, 0);
+  for (i = 0; i < 50000 && ok; i++) {
+    sort_bench_rec_t r = { (double)((int64_t)(dg_splitmix64_(i) % 2001) - 1000) * 0.5, (uint32_t)i, 0 };
+    ok = darray_push_back(&recs, &r);
+  }
+  ok = ok && darray_radix_sort(&recs, offsetof(sort_bench_rec_t, ts), DGDARRAY_KEY_F64) == DGERR_SUCCESS;
+  for (i = 1; i < recs.size && ok; i++) {
+    const sort_bench_rec_t* p = darray_getptr(&recs, i - 1, sort_bench_rec_t);
+    ok = sort_bench_cmp_rec(p, p + 1) < 0 || (p->ts == p[1].ts && p->src < p[1].src);
+  }
+  ok = ok && darray_radix_sort(&recs, 12, DGDARRAY_KEY_F64) == DGERR_INVALID_PARAM;
+
+  darray_free(&recs);
+  darray_free(&arr);
+  darray_free(&ref);
+  darray_free(&a);
+  darray_free(&b);
+  darray_free(&merged);
+  tp_deinit(&pool);
+  if (!ok)
+    printf("darray sort check failed\n");
+  return ok;
+}
+
+/* dg_spsc_ring: wrap-around checks, then throughput and ping-pong latency vs the MPMC and mutex queues */
+static bool spsc_ring_check_single()
+{
+  dg_spsc_ring_t r;
+  uint64_t buf[16], v = 0, expect = 0;
+  size_t n;
+  bool ok = spsc_ring_alloc(&r, sizeof(uint64_t), 8) && !spsc_ring_alloc(&(dg_spsc_ring_t){0}, 8, 6);
+
+  /* fill, drain part, then batches that wrap around the buffer end */
+  while (ok && spsc_ring_push(&r, &v))
+    v++;
+  ok = ok && v == 8 && spsc_ring_is_full(&r);
+  for (int i = 0; i < 5 && ok; i++)
+    ok = spsc_ring_pop(buf, &r) && buf[0] == expect++;
+  for (int i = 0; i < 5; i++)
+    buf[i] = v + i;
+  ok = ok && spsc_ring_push_n(&r, buf, 5) == 5 && spsc_ring_push_n(&r, buf, 1) == 0;
+  v += 5;
+  ok = ok && spsc_ring_pop_n(buf, &r, 16) == 8;
+  for (int i = 0; i < 8 && ok; i++)
+    ok = buf[i] == expect++;
+  ok = ok && spsc_ring_is_empty(&r) && !spsc_ring_pop(buf, &r) && !spsc_ring_peek(&r, 4, &n);
+
+  /* zero-copy: head is at 13, only 3 slots are contiguous before the wrap */
+  uint64_t* pw = (uint64_t*)spsc_ring_reserve(&r, 8, &n);
+  ok = ok && pw && n == 3;
+  for (size_t i = 0; ok && i < n; i++)
+    pw[i] = v++;
+  spsc_ring_commit(&r, n);
+  pw = (uint64_t*)spsc_ring_reserve(&r, 8, &n);
+  ok = ok && pw && n == 5 && (uint8_t*)pw == r.pdata;
+  for (size_t i = 0; ok && i < n; i++)
+    pw[i] = v++;
+  spsc_ring_commit(&r, 2);
+  ok = ok && spsc_ring_size(&r) == 5;
+  const uint64_t* pr = (const uint64_t*)spsc_ring_peek(&r, 8, &n);
+  ok = ok && pr && n == 3 && pr[0] == expect;
+  spsc_ring_release(&r, n);
+  expect += 3;
+  pr = (const uint64_t*)spsc_ring_peek(&r, 8, &n);
+  ok = ok && pr && n == 2 && pr[0] == expect && pr[1] == expect + 1;
+  spsc_ring_release(&r, 1);
+  ok = ok && spsc_ring_pop(buf, &r) && buf[0] == expect + 1 && spsc_ring_is_empty(&r);
+  spsc_ring_free(&r);
+  return ok;
+}
+
+enum { QBENCH_SINGLE, QBENCH_BATCH, QBENCH_ZEROCOPY };
+#define QBENCH_BATCH_SIZE 64
+
+typedef struct queue_bench_ops_s {
+  const char* name;
+  bool (*push)(void* q, const uint64_t* pv);
+  bool (*pop)(void* q, uint64_t* pv);
+} queue_bench_ops_t;
+
+static bool qbench_spsc_push(void* q, const uint64_t* pv) { return spsc_ring_push((dg_spsc_ring_t*)q, pv); }
+static bool qbench_spsc_pop(void* q, uint64_t* pv) { return spsc_ring_pop(pv, (dg_spsc_ring_t*)q); }
+static bool qbench_mpmc_push(void* q, const uint64_t* pv) { return mpmc_queue_add_back((dg_mtqueue_mpmc_t*)q, pv); }
+static bool qbench_mpmc_pop(void* q, uint64_t* pv) { return mpmc_queue_get_front(pv, (dg_mtqueue_mpmc_t*)q); }
+static bool qbench_mtq_push(void* q, const uint64_t* pv) { mtqueue_add_back((dg_mtqueue_t*)q, pv); return true; }
+static bool qbench_mtq_pop(void* q, uint64_t* pv) { mtqueue_get_front_copy(pv, (dg_mtqueue_t*)q); return true; }
+
+static const queue_bench_ops_t qbench_ops[] = {
+  { "dg_spsc_ring_t", qbench_spsc_push, qbench_spsc_pop },
+  { "dg_mtqueue_mpmc_t", qbench_mpmc_push, qbench_mpmc_pop },
+  { "dg_mtqueue_t", qbench_mtq_push, qbench_mtq_pop }
+};
+
+typedef struct queue_bench_thrd_s {
+  const queue_bench_ops_t* ops;
+  void*  q[2];   /* q[0] carries values to the other side, q[1] carries echoes back */
+  size_t n;
+  int    mode;
+} queue_bench_thrd_t;
+
+/* spin a little, then give the other side the core */
+static inline void qbench_backoff(unsigned* pspins)
+{
+  if (++*pspins >= 64) {
+    dg_delay_ms(0);
+    *pspins = 0;
+  }
+}
+
+/* pushes 0..n-1 into q[0] */
+int queue_bench_producer_proc(struct dg_thrd_data_s* ptinfo)
+{
+  queue_bench_thrd_t* pctx = (queue_bench_thrd_t*)ptinfo->puserdata;
+  uint64_t i = 0, buf[QBENCH_BATCH_SIZE];
+  unsigned spins = 0;
+  while (i < pctx->n) {
+    size_t k = pctx->n - i < QBENCH_BATCH_SIZE ? (size_t)(pctx->n - i) : QBENCH_BATCH_SIZE, done = 0;
+    if (pctx->mode == QBENCH_SINGLE) {
+      done = pctx->ops->push(pctx->q[0], &i);
+    }
+    else if (pctx->mode == QBENCH_BATCH) {
+      for (size_t j = 0; j < k; j++)
+        buf[j] = i + j;
+      done = spsc_ring_push_n((dg_spsc_ring_t*)pctx->q[0], buf, k);
+    }
+    else {
+      uint64_t* p = (uint64_t*)spsc_ring_reserve((dg_spsc_ring_t*)pctx->q[0], k, &done);
+      for (size_t j = 0; j < done; j++)
+        p[j] = i + j;
+      if (done)
+        spsc_ring_commit((dg_spsc_ring_t*)pctx->q[0], done);
+    }
+    if (done)
+      i += done;
+    else
+      qbench_backoff(&spins);
+  }
+  return 0;
+}
+
+/* sends every value from q[0] back through q[1] */
+int queue_bench_echo_proc(struct dg_thrd_data_s* ptinfo)
+{
+  queue_bench_thrd_t* pctx = (queue_bench_thrd_t*)ptinfo->puserdata;
+  unsigned spins = 0;
+  for (size_t i = 0; i < pctx->n; i++) {
+    uint64_t v;
+    while (!pctx->ops->pop(pctx->q[0], &v))
+      qbench_backoff(&spins);
+    while (!pctx->ops->push(pctx->q[1], &v))
+      qbench_backoff(&spins);
+  }
+  return 0;
+}
+
+/* consumes n values from q[0], returns false if any value is out of order */
+static bool queue_bench_consume(queue_bench_thrd_t* pctx)
+{
+  uint64_t expect = 0, buf[QBENCH_BATCH_SIZE];
+  unsigned spins = 0;
+  bool ok = true;
+  while (expect < pctx->n) {
+    size_t done = 0;
+    if (pctx->mode == QBENCH_SINGLE) {
+      done = pctx->ops->pop(pctx->q[0], buf);
+    }
+    else if (pctx->mode == QBENCH_BATCH) {
+      done = spsc_ring_pop_n(buf, (dg_spsc_ring_t*)pctx->q[0], QBENCH_BATCH_SIZE);
+    }
+    else {
+      const uint64_t* p = (const uint64_t*)spsc_ring_peek((dg_spsc_ring_t*)pctx->q[0], QBENCH_BATCH_SIZE, &done);
+      for (size_t j = 0; j < done; j++)
+        buf[j] = p[j];
+      if (done)
+        spsc_ring_release((dg_spsc_ring_t*)pctx->q[0], done);
+    }
+    if (!done)
+      qbench_backoff(&spins);
+    /* keep draining after a mismatch, a blocked producer would never be joined */
+    for (size_t j = 0; j < done; j++)
+      ok = ok && buf[j] == expect + j;
+    expect += done;
+  }
+  return ok;
+}
+
+/* allocates a queue of the kind given by the ops entry */
+static void* queue_bench_alloc(const queue_bench_ops_t* ops, size_t capacity)
+{
+  void* q = NULL;
+  if (ops->push == qbench_spsc_push) {
+    q = malloc(sizeof(dg_spsc_ring_t));
+    if (q && !spsc_ring_alloc((dg_spsc_ring_t*)q, sizeof(uint64_t), capacity))
+      q = (free(q), NULL);
+  }
+  else if (ops->push == qbench_mpmc_push) {
+    q = malloc(sizeof(dg_mtqueue_mpmc_t));
+    if (q && !mpmc_queue_alloc((dg_mtqueue_mpmc_t*)q, sizeof(uint64_t), capacity))
+      q = (free(q), NULL);
+  }
+  else {
+    q = calloc(1, sizeof(dg_mtqueue_t));
+    if (q && !mtqueue_alloc((dg_mtqueue_t*)q, sizeof(uint64_t), capacity)) {
+      mtqueue_free((dg_mtqueue_t*)q);
+      q = (free(q), NULL);
+    }
+  }
+  return q;
+}
+
+static void queue_bench_free(const queue_bench_ops_t* ops, void* q)
+{
+  if (!q)
+    return;
+  if (ops->push == qbench_spsc_push)
+    spsc_ring_free((dg_spsc_ring_t*)q);
+  else if (ops->push == qbench_mpmc_push)
+    mpmc_queue_free((dg_mtqueue_mpmc_t*)q);
+  else
+    mtqueue_free((dg_mtqueue_t*)q);
+  free(q);
+}
+
+/* one producer thread, the calling thread consumes; returns ns per element or -1 */
+static double queue_bench_throughput(const queue_bench_ops_t* ops, int mode, size_t n)
+{
+  queue_bench_thrd_t ctx = { ops, { queue_bench_alloc(ops, 1024), NULL }, n, mode };
+  dg_timer_t timer;
+  bool ok = false;
+  if (ctx.q[0]) {
+    dg_timer_start(&timer);
+    dg_thrd_t hthread = thread_create(0, queue_bench_producer_proc, &ctx);
+    if (hthread) {
+      ok = queue_bench_consume(&ctx);
+      thread_join(hthread);
+      thread_close(hthread);
+    }
+    dg_timer_stop(&timer);
+  }
+  queue_bench_free(ops, ctx.q[0]);
+  return ok ? timer_get_elapsed(&timer) * 1e9 / (double)n : -1.0;
+}
+
+/* round trips through an echo thread; returns ns per round trip or -1 */
+static double queue_bench_latency(const queue_bench_ops_t* ops, size_t n)
+{
+  queue_bench_thrd_t ctx = { ops, { queue_bench_alloc(ops, 64), queue_bench_alloc(ops, 64) }, n, QBENCH_SINGLE };
+  dg_timer_t timer;
+  bool ok = false;
+  if (ctx.q[0] && ctx.q[1]) {
+    dg_thrd_t hthread = thread_create(0, queue_bench_echo_proc, &ctx);
+    if (hthread) {
+      unsigned spins = 0;
+      ok = true;
+      dg_timer_start(&timer);
+      for (uint64_t i = 0; i < n; i++) {
+        uint64_t v;
+        while (!ops->push(ctx.q[0], &i))
+          qbench_backoff(&spins);
+        while (!ops->pop(ctx.q[1], &v))
+          qbench_backoff(&spins);
+        ok = ok && v == i;
+      }
+      dg_timer_stop(&timer);
+      thread_join(hthread);
+      thread_close(hthread);
+    }
+  }
+  queue_bench_free(ops, ctx.q[0]);
+  queue_bench_free(ops, ctx.q[1]);
+  return ok ? timer_get_elapsed(&timer) * 1e9 / (double)n : -1.0;
+}
+
+bool test_spsc_ring()
+{
+  enum { NITEMS = 1 << 22, NROUNDTRIPS = 1 << 16 };
+  static const char* mode_names[] = { "push/pop", "push_n/pop_n", "reserve/peek" };
+  bool ok = spsc_ring_check_single();
+  if (!ok) {
+    printf("spsc ring single-thread check failed\n");
+    return false;
+  }
+
+  printf("---- queue throughput, 1 producer + 1 consumer, %d uint64_t (ns/element) ----\n", NITEMS);
+  for (size_t k = 0; k < DG_ARRSIZE(qbench_ops) && ok; k++) {
+    /* batch and zero-copy calls exist on the SPSC ring only */
+    for (int mode = QBENCH_SINGLE; mode <= (k == 0 ? QBENCH_ZEROCOPY : QBENCH_SINGLE) && ok; mode++) {
+      double ns = queue_bench_throughput(&qbench_ops[k], mode, NITEMS);
+      ok = ns >= 0.0;
+      printf("  %-18s %-13s %8.2f\n", qbench_ops[k].name, mode_names[mode], ns);
+    }
+  }
+  printf("---- queue ping-pong latency, %d round trips (ns/round trip) ----\n", NROUNDTRIPS);
+  for (size_t k = 0; k < DG_ARRSIZE(qbench_ops) && ok; k++) {
+    double ns = queue_bench_latency(&qbench_ops[k], NROUNDTRIPS);
+    ok = ns >= 0.0;
+    printf("  %-18s %10.1f\n", qbench_ops[k].name, ns);
+  }
+  if (!ok)
+    printf("queue benchmark lost or reordered a value\n");
+  return ok;
+}
+
+/* dg_mtqueue_mpmc_t batch claims and the blocking wrapper, N producers + N consumers */
+static bool mpmc_queue_check_batch()
+{
+  dg_mtqueue_mpmc_t q;
+  uint64_t buf[16], v = 0, expect = 0;
+  size_t n;
+  bool ok = mpmc_queue_alloc(&q, sizeof(uint64_t), 8);
+
+  /* positions must not share a line with each other or with the read-only fields */
+  ok = ok && offsetof(dg_mtqueue_mpmc_t, dequeue_pos) - offsetof(dg_mtqueue_mpmc_t, enqueue_pos) >= DG_CACHE_LINE_SIZE;
+  ok = ok && offsetof(dg_mtqueue_mpmc_t, enqueue_pos) - offsetof(dg_mtqueue_mpmc_t, pdata) >= DG_CACHE_LINE_SIZE;
+  for (int i = 0; i < 16; i++)
+    buf[i] = v + i;
+  ok = ok && mpmc_queue_add_back_n(&q, buf, 5) == 5;
+  v += 5;
+  ok = ok && mpmc_queue_get_front_n(buf, &q, 3) == 3 && buf[0] == 0 && buf[2] == 2;
+  expect += 3;
+  /* 2 queued, 6 free slots wrapping around the end */
+  for (int i = 0; i < 16; i++)
+    buf[i] = v + i;
+  ok = ok && mpmc_queue_add_back_n(&q, buf, 16) == 6 && mpmc_queue_is_full(&q);
+  v += 6;
+  ok = ok && !mpmc_queue_add_back(&q, buf) && mpmc_queue_add_back_n(&q, buf, 4) == 0;
+  n = mpmc_queue_get_front_n(buf, &q, 16);
+  ok = ok && n == 8;
+  for (size_t i = 0; i < n && ok; i++)
+    ok = buf[i] == expect++;
+  ok = ok && mpmc_queue_is_empty(&q) && mpmc_queue_get_front_n(buf, &q, 4) == 0 && !mpmc_queue_get_front(buf, &q);
+  /* failed calls above must not have consumed positions */
+  ok = ok && mpmc_queue_add_back(&q, &v) && mpmc_queue_get_front(buf, &q) && buf[0] == v;
+  mpmc_queue_free(&q);
+  return ok;
+}
+
+enum { MPMC_BENCH_SINGLE, MPMC_BENCH_BATCH, MPMC_BENCH_BLOCKING };
+#define MPMC_BENCH_BATCH_SIZE 16
+
+typedef struct mpmc_bench_thrd_s {
+  dg_mtqueue_mpmc_blocking_t* pbq;
+  atomic_size_t* pgo;
+  atomic_size_t* psum;
+  uint64_t first;    /* producers push first..first+n-1 */
+  size_t   n;
+  int      mode;
+  int      producer;
+} mpmc_bench_thrd_t;
+
+int mpmc_bench_thread_proc(struct dg_thrd_data_s* ptinfo)
+{
+  mpmc_bench_thrd_t* pctx = (mpmc_bench_thrd_t*)ptinfo->puserdata;
+  dg_mtqueue_mpmc_t* q = &pctx->pbq->q;
+  uint64_t buf[MPMC_BENCH_BATCH_SIZE], sum = 0;
+  unsigned spins = 0;
+  size_t i = 0;
+  while (!dg_atomic_load(pctx->pgo));
+  while (i < pctx->n) {
+    size_t k = pctx->n - i < MPMC_BENCH_BATCH_SIZE ? pctx->n - i : MPMC_BENCH_BATCH_SIZE, done;
+    if (pctx->producer) {
+      for (size_t j = 0; j < k; j++)
+        buf[j] = pctx->first + i + j;
+      if (pctx->mode == MPMC_BENCH_SINGLE)
+        done = mpmc_queue_add_back(q, buf);
+      else if (pctx->mode == MPMC_BENCH_BATCH)
+        done = mpmc_queue_add_back_n(q, buf, k);
+      else
+        done = (mpmc_queue_add_back_wait(pctx->pbq, buf), 1);
+    }
+    else {
+      if (pctx->mode == MPMC_BENCH_SINGLE)
+        done = mpmc_queue_get_front(buf, q);
+      else if (pctx->mode == MPMC_BENCH_BATCH)
+        done = mpmc_queue_get_front_n(buf, q, k);
+      else
+        done = (mpmc_queue_get_front_wait(buf, pctx->pbq), 1);
+      for (size_t j = 0; j < done; j++)
+        sum += buf[j];
+    }
+    if (done)
+      i += done;
+    else
+      qbench_backoff(&spins);
+  }
+  if (!pctx->producer)
+    dg_atomic_fetch_add(pctx->psum, (atomic_size_t)sum);
+  return 0;
+}
+
+bool test_mpmc_queue_batch()
+{
+  enum { NITEMS = 1 << 21, MAX_PAIRS = 8 };
+  static const char* mode_names[] = { "add/get", "add_n/get_n", "blocking" };
+  static const size_t pair_counts[] = { 1, 2, 4, 8 };
+  mpmc_bench_thrd_t ctx[MAX_PAIRS * 2];
+  dg_thrd_t threads[MAX_PAIRS * 2];
+  dg_timer_t timer;
+  bool ok = mpmc_queue_check_batch();
+  if (!ok) {
+    printf("mpmc batch check failed\n");
+    return false;
+  }
+
+  printf("---- dg_mtqueue_mpmc_t throughput, %d uint64_t, capacity 1024 (Mops/s) ----\n", NITEMS);
+  for (int mode = MPMC_BENCH_SINGLE; mode <= MPMC_BENCH_BLOCKING && ok; mode++) {
+    printf("  %-12s:", mode_names[mode]);
+    for (size_t p = 0; p < DG_ARRSIZE(pair_counts) && ok; p++) {
+      size_t i, npairs = pair_counts[p], nthreads = 0, per = NITEMS / npairs;
+      atomic_size_t go = 0, sum = 0;
+      dg_mtqueue_mpmc_blocking_t bq;
+      if (!mpmc_queue_blocking_alloc(&bq, sizeof(uint64_t), 1024)) {
+        printf("\nmpmc_queue_blocking_alloc() failed\n");
+        return false;
+      }
+      for (i = 0; i < npairs * 2; i++) {
+        ctx[i].pbq = &bq;
+        ctx[i].pgo = &go;
+        ctx[i].psum = &sum;
+        ctx[i].first = (uint64_t)(i / 2) * per;
+        ctx[i].n = per;
+        ctx[i].mode = mode;
+        ctx[i].producer = (int)(i & 1);
+        threads[i] = thread_create(0, mpmc_bench_thread_proc, &ctx[i]);
+        if (!threads[i]) {
+          printf("\nthread_create() failed\n");
+          ok = false;
+          /* a consumer without its producer would never finish: produce on this thread */
+          if (i & 1) {
+            dg_thrd_data_t tdata = { 0 };
+            tdata.puserdata = &ctx[i];
+            dg_atomic_store(&go, 1);
+            mpmc_bench_thread_proc(&tdata);
+          }
+          break;
+        }
+        nthreads++;
+      }
+      dg_timer_start(&timer);
+      dg_atomic_store(&go, 1);
+      for (i = 0; i < nthreads; i++) {
+        thread_join(threads[i]);
+        thread_close(threads[i]);
+      }
+      dg_timer_stop(&timer);
+      /* every value 0..npairs*per-1 was taken exactly once */
+      uint64_t total = (uint64_t)npairs * per;
+      ok = ok && (uint64_t)dg_atomic_load(&sum) == total * (total - 1) / 2 && mpmc_queue_is_empty(&bq.q);
+      mpmc_queue_blocking_free(&bq);
+      printf(" %zdP+%zdC=%.1f", npairs, npairs, (double)total / timer_get_elapsed(&timer) * 1e-6);
+    }
+    printf("\n");
+  }
+  if (!ok)
+    printf("mpmc queue lost or duplicated a value\n");
+  return ok;
+}
+
+/* task dispatch through tp_task_add: wake-up latency of an idle worker and queue throughput */
+typedef struct tp_dispatch_ctx_s {
+  atomic_size_t started; /* perf counter read by the task, 0 until it runs */
+  atomic_size_t ndone;
+} tp_dispatch_ctx_t;
+
+static void tp_dispatch_latency_task(dg_task_t* ptask)
+{
+  tp_dispatch_ctx_t* pctx = (tp_dispatch_ctx_t*)ptask->puserdata;
+  dg_atomic_store_release(&pctx->started, (atomic_size_t)dg_get_perf_counter());
+}
+
+static void tp_dispatch_count_task(dg_task_t* ptask)
+{
+  dg_atomic_fetch_add(&((tp_dispatch_ctx_t*)ptask->puserdata)->ndone, 1);
+}
+
+static int tp_dispatch_cmp_double(const void* pa, const void* pb)
+{
+  double a = *(const double*)pa, b = *(const double*)pb;
+  return (a > b) - (a < b);
+}
+
+bool test_tp_dispatch_latency()
+{
+  enum { NWORKERS = 4, NSAMPLES = 20000, NTASKS = 1 << 20 };
+  static double samples[NSAMPLES];
+  double freq = (double)dg_get_perf_frequency();
+  tp_dispatch_ctx_t ctx;
+  dg_threadpool_t pool;
+  dg_timer_t timer;
+  unsigned spins = 0;
+  bool ok = true;
+
+  if (tp_init(&pool, NWORKERS) != DGERR_SUCCESS) {
+    printf("tp_init() failed\n");
+    return false;
+  }
+
+  /* one task in flight: submit-to-start time, the worker is asleep in the queue each time */
+  for (size_t i = 0; i < NSAMPLES && ok; i++) {
+    dg_atomic_store(&ctx.started, 0);
+    uint64_t t0 = dg_get_perf_counter();
+    ok = tp_task_add(&pool, tp_dispatch_latency_task, NULL, DGTASKPRIOR_MIDDLE, &ctx, 0.) == DGERR_SUCCESS;
+    size_t t1;
+    while (ok && !(t1 = dg_atomic_load_acquire(&ctx.started)))
+      qbench_backoff(&spins);
+    samples[i] = ok ? (double)(t1 - t0) * 1e9 / freq : 0.0;
+  }
+  qsort(samples, NSAMPLES, sizeof(samples[0]), tp_dispatch_cmp_double);
+  printf("---- tp_task_add dispatch, %d workers ----\n", NWORKERS);
+  printf("  latency (ns): p50=%.0f p90=%.0f p99=%.0f max=%.0f\n", samples[NSAMPLES / 2],
+    samples[NSAMPLES * 9 / 10], samples[NSAMPLES * 99 / 100], samples[NSAMPLES - 1]);
+
+  /* empty tasks back to back, a full queue is retried */
+  dg_atomic_store(&ctx.ndone, 0);
+  dg_timer_start(&timer);
+  for (size_t i = 0; i < NTASKS && ok; ) {
+    int st = tp_task_add(&pool, tp_dispatch_count_task, NULL, DGTASKPRIOR_MIDDLE, &ctx, 0.);
+    if (st == DGERR_SUCCESS)
+      i++;
+    else if (st == DGERR_OVERFLOWED)
+      qbench_backoff(&spins);
+    else
+      ok = false;
+  }
+  while (ok && dg_atomic_load(&ctx.ndone) != NTASKS)
+    qbench_backoff(&spins);
+  dg_timer_stop(&timer);
+  printf("  throughput: %d tasks, %.1f ns/task\n", NTASKS, timer_get_elapsed(&timer) * 1e9 / NTASKS);
+
+  tp_deinit(&pool);
+  if (!ok)
+    printf("tp_task_add() failed\n");
+  return ok;
+}
+
 #define RUN_TEST(func, failmsg) do {\
 	if(!func()) {\
 		printf(failmsg "\n");\
@@ -789,6 +3523,32 @@ int main()
   //RUN_TEST(test_threadpool, "threads pool testing failed!")
   //RUN_TEST(test_strings, "string testing failed!")
   //RUN_TEST(test_sys, "sys testing failed!")
+  //RUN_TEST(test_map_group_probing, "map group probing benchmark failed!")
+  //RUN_TEST(test_map_batch_lookup, "map batch lookup benchmark failed!")
+  //RUN_TEST(test_cmap_scaling, "concurrent map scaling benchmark failed!")
+  //RUN_TEST(test_map_incremental_rehash, "map incremental rehash benchmark failed!")
+  //RUN_TEST(test_map_churn, "map churn benchmark failed!")
+  //RUN_TEST(test_map_layout, "map layout benchmark failed!")
+  //RUN_TEST(test_map_snapshot, "map snapshot testing failed!")
+  //RUN_TEST(test_map_build, "map bulk load benchmark failed!")
+  //RUN_TEST(test_hash_throughput, "hash throughput benchmark failed!")
+  //RUN_TEST(test_hash_quality, "hash quality testing failed!")
+  //RUN_TEST(test_map_hashed_lookup, "map hashed lookup benchmark failed!")
+  //RUN_TEST(test_tmap_nodes, "tree map nodes benchmark failed!")
+  //RUN_TEST(test_btree_vs_tmap, "btree benchmark failed!")
+  //RUN_TEST(test_tmap_build, "tree map bulk build benchmark failed!")
+  //RUN_TEST(test_tmap_order_stats, "tree map order statistics benchmark failed!")
+  //RUN_TEST(test_skiplist_scaling, "skip list scaling benchmark failed!")
+  //RUN_TEST(test_darray_growth, "darray growth benchmark failed!")
+  //RUN_TEST(test_vec_vs_darray, "DG_VEC benchmark failed!")
+  //RUN_TEST(test_darray_ranges, "darray range edits failed!")
+  //RUN_TEST(test_segarray, "segarray testing failed!")
+  //RUN_TEST(test_soa_sweep, "DG_SOA benchmark failed!")
+  //RUN_TEST(test_darray3d_tiled, "darray3d tiled benchmark failed!")
+  //RUN_TEST(test_darray_sort, "darray sort benchmark failed!")
+  //RUN_TEST(test_spsc_ring, "spsc ring benchmark failed!")
+  //RUN_TEST(test_mpmc_queue_batch, "mpmc queue benchmark failed!")
+  //RUN_TEST(test_tp_dispatch_latency, "threadpool dispatch benchmark failed!")
   RUN_TEST(test_filesystem, "filesystem testing failed!")
   dg_deinitialize();
   return 0;